@@ -0,0 +1,49 @@
+/** @file async.h
+ * @brief Public interface for asynchronous (non-blocking) connection.
+ */
+
+#ifndef _faux_async_h
+#define _faux_async_h
+
+#include <faux/faux.h>
+#include <faux/eloop.h>
+
+typedef struct faux_async_s faux_async_t;
+
+// Read callback. It gets all buffered input data and returns number of
+// consumed bytes. Unconsumed data stays within input buffer. Negative
+// return value means error. The connection will be closed then.
+typedef ssize_t faux_async_read_cb_f(faux_async_t *async,
+	const void *data, size_t len, void *user_data);
+
+// Write completion, drain (low watermark) and close callbacks. The close
+// callback gets errno value or 0 on EOF.
+typedef void faux_async_write_cb_f(faux_async_t *async, void *user_data);
+typedef void faux_async_close_cb_f(faux_async_t *async, int err,
+	void *user_data);
+
+C_DECL_BEGIN
+
+faux_async_t *faux_async_new(faux_eloop_t *eloop, int fd);
+void faux_async_free(faux_async_t *async);
+int faux_async_fd(const faux_async_t *async);
+bool_t faux_async_is_active(const faux_async_t *async);
+void faux_async_set_read_cb(faux_async_t *async,
+	faux_async_read_cb_f *read_cb, void *user_data);
+void faux_async_set_close_cb(faux_async_t *async,
+	faux_async_close_cb_f *close_cb, void *user_data);
+void faux_async_set_drain_cb(faux_async_t *async,
+	faux_async_write_cb_f *drain_cb, void *user_data);
+bool_t faux_async_set_read_limit(faux_async_t *async, size_t max);
+bool_t faux_async_set_watermarks(faux_async_t *async,
+	size_t low, size_t high);
+bool_t faux_async_pause_read(faux_async_t *async, bool_t pause);
+bool_t faux_async_write(faux_async_t *async, const void *data, size_t len,
+	faux_async_write_cb_f *done_cb, void *user_data);
+size_t faux_async_out_len(const faux_async_t *async);
+bool_t faux_async_is_full(const faux_async_t *async);
+size_t faux_async_in_len(const faux_async_t *async);
+
+C_DECL_END
+
+#endif
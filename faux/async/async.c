@@ -0,0 +1,812 @@
+/** @file async.c
+ * @brief Asynchronous (non-blocking) connection driven by event loop.
+ *
+ * The faux_net_t class implements blocking I/O with timeouts. So single
+ * slow peer blocks the whole thread. The faux_async_t object registers
+ * descriptor within event loop and makes partial non-blocking reads and
+ * writes when descriptor is ready. So many connections can be served by
+ * single thread.
+ *
+ * The received data is accumulated within input buffer. The read callback
+ * gets all buffered data and returns number of consumed bytes. So the
+ * callback can parse complete messages only and leave partial message
+ * within buffer.
+ *
+ * The faux_async_write() tries to send data immediately. The unsent part
+ * is copied to output queue and it's sent when descriptor is ready for
+ * writing. The queued chunks are sent by single syscall. The optional
+ * completion callback is executed when chunk is sent completely. The
+ * completion callback can be executed by faux_async_write() itself if data
+ * was sent immediately.
+ *
+ * The high and low watermarks limit output queue. The faux_async_is_full()
+ * returns BOOL_TRUE when queue exceeds high watermark. The drain callback
+ * is executed when such queue falls to low watermark.
+ *
+ * The object doesn't own descriptor. The close callback informs user about
+ * EOF or error. The descriptor is unregistered from loop then but it's not
+ * closed. The object can be freed within any of its callbacks.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "faux/faux.h"
+#include "faux/eloop.h"
+#include "faux/async.h"
+
+#include "private.h"
+
+
+static bool_t faux_async_eloop_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data);
+
+
+/** @brief Allocates asynchronous connection object.
+ *
+ * The descriptor is switched to non-blocking mode and it's registered
+ * within event loop. The object and loop must be used by the same thread.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd Descriptor (socket usually).
+ * @return Allocated object or NULL on error.
+ */
+faux_async_t *faux_async_new(faux_eloop_t *eloop, int fd)
+{
+	faux_async_t *async = NULL;
+	int flags = 0;
+
+	assert(eloop);
+	if (!eloop || (fd < 0))
+		return NULL;
+
+	flags = fcntl(fd, F_GETFL);
+	if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0))
+		return NULL;
+
+	async = faux_zmalloc(sizeof(*async));
+	assert(async);
+	if (!async) {
+		fcntl(fd, F_SETFL, flags);
+		return NULL;
+	}
+
+	// Init
+	async->eloop = eloop;
+	async->fd = fd;
+	async->active = BOOL_FALSE;
+	async->freed = BOOL_FALSE;
+	async->busy = 0;
+	async->not_socket = BOOL_FALSE;
+	async->read_paused = BOOL_FALSE;
+	async->feeding = BOOL_FALSE;
+	async->hangup = BOOL_FALSE;
+	async->in_buf = NULL;
+	async->in_size = 0;
+	async->in_len = 0;
+	async->in_max = FAUX_ASYNC_IN_MAX;
+	async->out_head = NULL;
+	async->out_tail = NULL;
+	async->out_len = 0;
+	async->low_watermark = 0;
+	async->high_watermark = 0;
+	async->above_high = BOOL_FALSE;
+
+	if (!faux_eloop_add_fd(eloop, fd, POLLIN, faux_async_eloop_cb, async)) {
+		faux_free(async);
+		fcntl(fd, F_SETFL, flags);
+		return NULL;
+	}
+	async->active = BOOL_TRUE;
+
+	return async;
+}
+
+
+/** @brief Frees queued output chunks.
+ *
+ * Completion callbacks are not executed.
+ */
+static void faux_async_drop_output(faux_async_t *async)
+{
+	faux_async_chunk_t *chunk = async->out_head;
+
+	while (chunk) {
+		faux_async_chunk_t *next = chunk->next;
+		faux_free(chunk);
+		chunk = next;
+	}
+	async->out_head = NULL;
+	async->out_tail = NULL;
+	async->out_len = 0;
+	async->above_high = BOOL_FALSE;
+}
+
+
+/** @brief Unregisters descriptor from loop.
+ */
+static void faux_async_deactivate(faux_async_t *async)
+{
+	if (!async->active)
+		return;
+	async->active = BOOL_FALSE;
+	faux_eloop_del_fd(async->eloop, async->fd);
+	faux_async_drop_output(async);
+}
+
+
+/** @brief Frees object memory.
+ */
+static void faux_async_destroy(faux_async_t *async)
+{
+	faux_async_deactivate(async);
+	faux_free(async->in_buf);
+	faux_free(async);
+}
+
+
+/** @brief Marks object as used by function that can execute callbacks.
+ */
+static void faux_async_hold(faux_async_t *async)
+{
+	async->busy++;
+}
+
+
+/** @brief Releases object. It's really freed if it was freed by callback.
+ */
+static void faux_async_release(faux_async_t *async)
+{
+	async->busy--;
+	if ((0 == async->busy) && async->freed)
+		faux_async_destroy(async);
+}
+
+
+/** @brief Is object still alive after user callback execution.
+ */
+static bool_t faux_async_alive(const faux_async_t *async)
+{
+	return (async->active && !async->freed);
+}
+
+
+/** @brief Frees asynchronous connection object.
+ *
+ * The descriptor is unregistered from loop but it's not closed. Queued
+ * output data is dropped. Function can be called within object's
+ * callbacks.
+ *
+ * @param [in] async Asynchronous connection object.
+ */
+void faux_async_free(faux_async_t *async)
+{
+	if (!async)
+		return;
+
+	if (async->busy > 0) {
+		faux_async_deactivate(async);
+		async->freed = BOOL_TRUE;
+		return;
+	}
+	faux_async_destroy(async);
+}
+
+
+/** @brief Closes connection due to EOF or error.
+ *
+ * The caller must hold the object.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] err Error code (errno) or 0 on EOF.
+ */
+static void faux_async_close(faux_async_t *async, int err)
+{
+	if (!faux_async_alive(async))
+		return;
+	faux_async_deactivate(async);
+	if (async->close_cb)
+		async->close_cb(async, err, async->close_udata);
+}
+
+
+/** @brief Gets descriptor.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @return Descriptor or < 0 on error.
+ */
+int faux_async_fd(const faux_async_t *async)
+{
+	assert(async);
+	if (!async)
+		return -1;
+
+	return async->fd;
+}
+
+
+/** @brief Is connection active i.e. it's not closed by EOF or error.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @return BOOL_TRUE - active, BOOL_FALSE - closed.
+ */
+bool_t faux_async_is_active(const faux_async_t *async)
+{
+	assert(async);
+	if (!async)
+		return BOOL_FALSE;
+
+	return faux_async_alive(async);
+}
+
+
+/** @brief Sets read callback.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] read_cb Read callback.
+ * @param [in] user_data User data for callback.
+ */
+void faux_async_set_read_cb(faux_async_t *async,
+	faux_async_read_cb_f *read_cb, void *user_data)
+{
+	assert(async);
+	if (!async)
+		return;
+	async->read_cb = read_cb;
+	async->read_udata = user_data;
+}
+
+
+/** @brief Sets close callback.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] close_cb Close callback.
+ * @param [in] user_data User data for callback.
+ */
+void faux_async_set_close_cb(faux_async_t *async,
+	faux_async_close_cb_f *close_cb, void *user_data)
+{
+	assert(async);
+	if (!async)
+		return;
+	async->close_cb = close_cb;
+	async->close_udata = user_data;
+}
+
+
+/** @brief Sets drain callback.
+ *
+ * The drain callback is executed when output queue exceeded high watermark
+ * and then it falls to low watermark.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] drain_cb Drain callback.
+ * @param [in] user_data User data for callback.
+ */
+void faux_async_set_drain_cb(faux_async_t *async,
+	faux_async_write_cb_f *drain_cb, void *user_data)
+{
+	assert(async);
+	if (!async)
+		return;
+	async->drain_cb = drain_cb;
+	async->drain_udata = user_data;
+}
+
+
+/** @brief Sets max size of input buffer.
+ *
+ * The connection is closed with ENOBUFS error when buffer is full and read
+ * callback doesn't consume data.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] max Max size of input buffer.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_async_set_read_limit(faux_async_t *async, size_t max)
+{
+	assert(async);
+	if (!async)
+		return BOOL_FALSE;
+	if ((0 == max) || (max < async->in_len))
+		return BOOL_FALSE;
+	async->in_max = max;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Sets high and low watermarks of output queue.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] low Low watermark.
+ * @param [in] high High watermark. 0 - disable watermarks.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_async_set_watermarks(faux_async_t *async,
+	size_t low, size_t high)
+{
+	assert(async);
+	if (!async)
+		return BOOL_FALSE;
+	if ((high != 0) && (low > high))
+		return BOOL_FALSE;
+	async->low_watermark = low;
+	async->high_watermark = high;
+	async->above_high = (high != 0) && (async->out_len >= high);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Gets number of bytes within output queue.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @return Number of queued bytes.
+ */
+size_t faux_async_out_len(const faux_async_t *async)
+{
+	assert(async);
+	if (!async)
+		return 0;
+
+	return async->out_len;
+}
+
+
+/** @brief Is output queue exceeds high watermark.
+ *
+ * User can stop to produce data when queue is full and wait for drain
+ * callback.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @return BOOL_TRUE - queue is full, BOOL_FALSE - not full.
+ */
+bool_t faux_async_is_full(const faux_async_t *async)
+{
+	assert(async);
+	if (!async)
+		return BOOL_FALSE;
+	if (0 == async->high_watermark)
+		return BOOL_FALSE;
+
+	return (async->out_len >= async->high_watermark);
+}
+
+
+/** @brief Gets number of bytes within input buffer.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @return Number of buffered bytes.
+ */
+size_t faux_async_in_len(const faux_async_t *async)
+{
+	assert(async);
+	if (!async)
+		return 0;
+
+	return async->in_len;
+}
+
+
+/** @brief Reads data from descriptor without blocking.
+ *
+ * @return Number of bytes read, 0 on EOF, < 0 on error.
+ */
+static ssize_t faux_async_sys_read(faux_async_t *async, void *buf, size_t n)
+{
+	ssize_t r = 0;
+
+	do {
+		if (async->not_socket) {
+			r = read(async->fd, buf, n);
+			continue;
+		}
+		r = recv(async->fd, buf, n, MSG_DONTWAIT);
+		if ((r < 0) && (ENOTSOCK == errno)) {
+			async->not_socket = BOOL_TRUE;
+			r = read(async->fd, buf, n);
+		}
+	} while ((r < 0) && (EINTR == errno));
+
+	return r;
+}
+
+
+/** @brief Writes data blocks to descriptor without blocking.
+ *
+ * @return Number of bytes written or < 0 on error.
+ */
+static ssize_t faux_async_sys_writev(faux_async_t *async,
+	const struct iovec *iov, int iovcnt)
+{
+	ssize_t r = 0;
+
+	do {
+		struct msghdr msg = {};
+
+		if (async->not_socket) {
+			r = writev(async->fd, iov, iovcnt);
+			continue;
+		}
+		msg.msg_iov = (struct iovec *)iov;
+		msg.msg_iovlen = iovcnt;
+		r = sendmsg(async->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if ((r < 0) && (ENOTSOCK == errno)) {
+			async->not_socket = BOOL_TRUE;
+			r = writev(async->fd, iov, iovcnt);
+		}
+	} while ((r < 0) && (EINTR == errno));
+
+	return r;
+}
+
+
+/** @brief Passes buffered input data to read callback.
+ *
+ * The read callback can pause and resume reading. The resume doesn't
+ * execute callback recursively. The outer call continues feeding then.
+ * The caller must hold the object.
+ */
+static void faux_async_feed(faux_async_t *async)
+{
+	if (async->feeding)
+		return;
+	async->feeding = BOOL_TRUE;
+
+	while ((async->in_len > 0) && async->read_cb && !async->read_paused) {
+		ssize_t consumed = async->read_cb(async, async->in_buf,
+			async->in_len, async->read_udata);
+		if (!faux_async_alive(async))
+			break;
+		if (consumed < 0) {
+			faux_async_close(async, EPROTO);
+			break;
+		}
+		if (0 == consumed) // Incomplete data. Wait for more
+			break;
+		if ((size_t)consumed > async->in_len)
+			consumed = async->in_len;
+		async->in_len -= consumed;
+		if (async->in_len > 0)
+			memmove(async->in_buf, async->in_buf + consumed,
+				async->in_len);
+	}
+
+	async->feeding = BOOL_FALSE;
+}
+
+
+/** @brief Reads available data to input buffer.
+ *
+ * Single read per event is made to don't starve other connections. The
+ * loop is level triggered so the rest of data will be read by the next
+ * iteration. The caller must hold the object.
+ *
+ * @return Number of bytes read, 0 if connection is closed, < 0 if there
+ * is no data.
+ */
+static ssize_t faux_async_do_read(faux_async_t *async)
+{
+	ssize_t r = 0;
+
+	// Enlarge input buffer
+	if (async->in_len == async->in_size) {
+		size_t new_size = async->in_size * 2;
+		char *new_buf = NULL;
+
+		if (async->in_size >= async->in_max) {
+			faux_async_close(async, ENOBUFS);
+			return 0;
+		}
+		if (new_size < FAUX_ASYNC_IN_CHUNK)
+			new_size = FAUX_ASYNC_IN_CHUNK;
+		if (new_size > async->in_max)
+			new_size = async->in_max;
+		new_buf = realloc(async->in_buf, new_size);
+		if (!new_buf) {
+			faux_async_close(async, ENOMEM);
+			return 0;
+		}
+		async->in_buf = new_buf;
+		async->in_size = new_size;
+	}
+
+	r = faux_async_sys_read(async, async->in_buf + async->in_len,
+		async->in_size - async->in_len);
+	if (r < 0) {
+		if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			return -1;
+		faux_async_close(async, errno);
+		return 0;
+	}
+	if (0 == r) { // EOF
+		faux_async_close(async, 0);
+		return 0;
+	}
+	async->in_len += r;
+
+	faux_async_feed(async);
+
+	return r;
+}
+
+
+/** @brief Drains connection after hang up.
+ *
+ * The descriptor is not registered within loop after hang up. So all the
+ * rest of data is read right now. The connection is closed when there is
+ * no more data. The caller must hold the object.
+ */
+static void faux_async_drain_hangup(faux_async_t *async)
+{
+	faux_async_feed(async);
+	while (faux_async_alive(async) && !async->read_paused) {
+		if (faux_async_do_read(async) < 0) {
+			faux_async_close(async, 0);
+			break;
+		}
+	}
+}
+
+
+/** @brief Sends queued output data.
+ *
+ * The caller must hold the object.
+ */
+static void faux_async_flush(faux_async_t *async)
+{
+	struct iovec iov[FAUX_ASYNC_IOV_MAX];
+	faux_async_chunk_t *chunk = NULL;
+	int iovcnt = 0;
+	ssize_t r = 0;
+	size_t left = 0;
+
+	for (chunk = async->out_head; chunk && (iovcnt < FAUX_ASYNC_IOV_MAX);
+		chunk = chunk->next, iovcnt++) {
+		iov[iovcnt].iov_base = chunk->data + chunk->pos;
+		iov[iovcnt].iov_len = chunk->len - chunk->pos;
+	}
+	if (0 == iovcnt)
+		return;
+
+	r = faux_async_sys_writev(async, iov, iovcnt);
+	if (r < 0) {
+		if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			return;
+		faux_async_close(async, errno);
+		return;
+	}
+
+	// Remove sent chunks
+	left = r;
+	while (async->out_head) {
+		size_t rest = 0;
+
+		chunk = async->out_head;
+		rest = chunk->len - chunk->pos;
+		if (left < rest) {
+			chunk->pos += left;
+			async->out_len -= left;
+			break;
+		}
+		left -= rest;
+		async->out_len -= rest;
+		async->out_head = chunk->next;
+		if (!async->out_head)
+			async->out_tail = NULL;
+		if (chunk->done_cb) {
+			chunk->done_cb(async, chunk->user_data);
+			if (!faux_async_alive(async)) {
+				faux_free(chunk);
+				return;
+			}
+		}
+		faux_free(chunk);
+	}
+
+	if (!async->out_head)
+		faux_eloop_exclude_fd_event(async->eloop, async->fd, POLLOUT);
+
+	// Drain notification
+	if (async->above_high && (async->out_len <= async->low_watermark)) {
+		async->above_high = BOOL_FALSE;
+		if (async->drain_cb)
+			async->drain_cb(async, async->drain_udata);
+	}
+}
+
+
+/** @brief Writes data to connection.
+ *
+ * Function tries to send data immediately. The unsent part is copied to
+ * output queue. So user can free data right after function call. The
+ * completion callback is executed when data is sent completely. It can be
+ * executed by this function itself.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] data Data to write.
+ * @param [in] len Length of data.
+ * @param [in] done_cb Completion callback. Can be NULL.
+ * @param [in] user_data User data for completion callback.
+ * @return BOOL_TRUE - data is sent or queued, BOOL_FALSE on error.
+ */
+bool_t faux_async_write(faux_async_t *async, const void *data, size_t len,
+	faux_async_write_cb_f *done_cb, void *user_data)
+{
+	faux_async_chunk_t *chunk = NULL;
+	size_t written = 0;
+	size_t rest = 0;
+
+	assert(async);
+	if (!async)
+		return BOOL_FALSE;
+	if (!faux_async_alive(async))
+		return BOOL_FALSE;
+	if ((len > 0) && !data)
+		return BOOL_FALSE;
+
+	// Try to send data immediately. The order of data must be preserved
+	// so it's possible when output queue is empty only.
+	if (!async->out_head && (len > 0)) {
+		struct iovec iov = {};
+		ssize_t r = 0;
+
+		iov.iov_base = (void *)data;
+		iov.iov_len = len;
+		r = faux_async_sys_writev(async, &iov, 1);
+		if (r < 0) {
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+				faux_async_hold(async);
+				faux_async_close(async, errno);
+				faux_async_release(async);
+				return BOOL_FALSE;
+			}
+			r = 0;
+		}
+		written = r;
+	}
+
+	// All data is sent
+	if (written == len) {
+		if (!async->out_head && done_cb) {
+			faux_async_hold(async);
+			done_cb(async, user_data);
+			faux_async_release(async);
+			return BOOL_TRUE;
+		}
+		if (!done_cb)
+			return BOOL_TRUE;
+	}
+
+	// Queue the rest of data. Empty chunk with completion callback keeps
+	// the order of callbacks.
+	rest = len - written;
+	chunk = faux_zmalloc(sizeof(*chunk) + rest);
+	assert(chunk);
+	if (!chunk)
+		return BOOL_FALSE;
+	chunk->data = (char *)(chunk + 1);
+	memcpy(chunk->data, (const char *)data + written, rest);
+	chunk->len = rest;
+	chunk->pos = 0;
+	chunk->done_cb = done_cb;
+	chunk->user_data = user_data;
+	chunk->next = NULL;
+	if (async->out_tail)
+		async->out_tail->next = chunk;
+	else
+		async->out_head = chunk;
+	async->out_tail = chunk;
+	async->out_len += rest;
+	if ((async->high_watermark != 0) &&
+		(async->out_len >= async->high_watermark))
+		async->above_high = BOOL_TRUE;
+
+	faux_eloop_include_fd_event(async->eloop, async->fd, POLLOUT);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Pauses or resumes reading.
+ *
+ * The reading can be paused to apply backpressure. For example while
+ * output queue of peer connection is full. The buffered data is passed
+ * to read callback on resume. If peer hung up while reading was paused
+ * then the rest of data is passed to read callback on resume and the
+ * connection is closed after that.
+ *
+ * @param [in] async Asynchronous connection object.
+ * @param [in] pause BOOL_TRUE - pause, BOOL_FALSE - resume.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_async_pause_read(faux_async_t *async, bool_t pause)
+{
+	assert(async);
+	if (!async)
+		return BOOL_FALSE;
+	if (!faux_async_alive(async))
+		return BOOL_FALSE;
+	if (async->read_paused == pause)
+		return BOOL_TRUE;
+	async->read_paused = pause;
+
+	if (async->hangup) {
+		if (pause)
+			return BOOL_TRUE;
+		faux_async_hold(async);
+		faux_async_drain_hangup(async);
+		faux_async_release(async);
+		return BOOL_TRUE;
+	}
+
+	if (pause)
+		return faux_eloop_exclude_fd_event(async->eloop, async->fd,
+			POLLIN);
+
+	if (!faux_eloop_include_fd_event(async->eloop, async->fd, POLLIN))
+		return BOOL_FALSE;
+	faux_async_hold(async);
+	faux_async_feed(async);
+	faux_async_release(async);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Event loop callback for connection's descriptor.
+ */
+static bool_t faux_async_eloop_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	faux_async_t *async = (faux_async_t *)user_data;
+	short revents = info->revents;
+
+	faux_async_hold(async);
+
+	if (revents & POLLNVAL) {
+		faux_async_close(async, EBADF);
+	} else if (revents & POLLERR) {
+		int err = 0;
+		socklen_t len = sizeof(err);
+		if ((getsockopt(async->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) ||
+			(0 == err))
+			err = EIO;
+		faux_async_close(async, err);
+	} else {
+		// The revents can be stale if events were changed by
+		// previous callback
+		if ((revents & POLLOUT) && async->out_head)
+			faux_async_flush(async);
+		if (faux_async_alive(async) && (revents & (POLLIN | POLLHUP))) {
+			// The hang up is reported even if reading is paused.
+			// Stop watching for descriptor to don't spin and
+			// keep buffered data until reading is resumed.
+			if (!async->read_paused) {
+				faux_async_do_read(async);
+			} else if (revents & POLLHUP) {
+				async->hangup = BOOL_TRUE;
+				faux_eloop_del_fd(async->eloop, async->fd);
+			}
+		}
+	}
+
+	faux_async_release(async);
+
+	return BOOL_TRUE;
+}
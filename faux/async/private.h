@@ -0,0 +1,52 @@
+#include "faux/faux.h"
+#include "faux/eloop.h"
+#include "faux/async.h"
+
+// Initial size of input buffer
+#define FAUX_ASYNC_IN_CHUNK 4096
+
+// Default max size of input buffer
+#define FAUX_ASYNC_IN_MAX (1024 * 1024)
+
+// Max number of output chunks sent by single syscall
+#define FAUX_ASYNC_IOV_MAX 64
+
+typedef struct faux_async_chunk_s {
+	struct faux_async_chunk_s *next;
+	char *data; // Points to memory right after the structure
+	size_t len;
+	size_t pos; // Already sent part of chunk
+	faux_async_write_cb_f *done_cb;
+	void *user_data;
+} faux_async_chunk_t;
+
+struct faux_async_s {
+	faux_eloop_t *eloop;
+	int fd;
+	bool_t active; // Descriptor is registered within loop and not closed
+	bool_t freed; // Object is freed within callback. Free it later
+	unsigned int busy; // Nesting level of object's functions
+	bool_t not_socket; // Descriptor is not socket. Use read()/writev()
+	bool_t read_paused;
+	bool_t feeding; // Read callback is executing. Prevents reentrance
+	bool_t hangup; // Hang up while reading is paused. Unregistered from loop
+	// Input buffer
+	char *in_buf;
+	size_t in_size; // Allocated size of input buffer
+	size_t in_len; // Number of buffered bytes
+	size_t in_max; // Max size of input buffer
+	// Output queue
+	faux_async_chunk_t *out_head;
+	faux_async_chunk_t *out_tail;
+	size_t out_len; // Number of queued bytes
+	size_t low_watermark;
+	size_t high_watermark; // 0 - watermarks are disabled
+	bool_t above_high; // Queue exceeded high watermark and isn't drained
+	// Callbacks
+	faux_async_read_cb_f *read_cb;
+	void *read_udata;
+	faux_async_close_cb_f *close_cb;
+	void *close_udata;
+	faux_async_write_cb_f *drain_cb;
+	void *drain_udata;
+};
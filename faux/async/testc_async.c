@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "faux/faux.h"
+#include "faux/eloop.h"
+#include "faux/async.h"
+
+
+#define TESTC_ASYNC_CHUNK 4096
+#define TESTC_ASYNC_LOW (16 * 1024)
+#define TESTC_ASYNC_HIGH (256 * 1024)
+
+
+typedef struct {
+	faux_async_t *async;
+	size_t queued; // Number of bytes written to async object
+	size_t received; // Number of bytes received by peer
+	size_t drained_len; // Queue length when drain callback was executed
+	int drains;
+	bool_t broken;
+} testc_async_t;
+
+
+static void testc_async_drain_cb(faux_async_t *async, void *user_data)
+{
+	testc_async_t *res = (testc_async_t *)user_data;
+
+	res->drains++;
+	res->drained_len = faux_async_out_len(async);
+	if (faux_async_is_full(async))
+		res->broken = BOOL_TRUE;
+}
+
+
+static bool_t testc_async_peer_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	testc_async_t *res = (testc_async_t *)user_data;
+	char buf[TESTC_ASYNC_CHUNK] = {};
+	ssize_t r = 0;
+
+	// Slow peer reads single chunk per iteration
+	r = read(info->fd, buf, sizeof(buf));
+	if (r <= 0)
+		return BOOL_FALSE;
+	res->received += r;
+	if (res->received == res->queued)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_async_fail_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	testc_async_t *res = (testc_async_t *)user_data;
+
+	res->broken = BOOL_TRUE;
+
+	return BOOL_FALSE;
+}
+
+
+int testc_faux_async_watermarks(void)
+{
+	faux_eloop_t *eloop = NULL;
+	testc_async_t res = {};
+	char chunk[TESTC_ASYNC_CHUNK] = {};
+	struct timespec fail = {5, 0};
+	int sv[2] = {-1, -1};
+	int ret = -1; // Pessimistic
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		return -1;
+	}
+	fcntl(sv[0], F_SETFL, O_NONBLOCK);
+	fcntl(sv[1], F_SETFL, O_NONBLOCK);
+
+	eloop = faux_eloop_new(NULL);
+	res.async = faux_async_new(eloop, sv[0]);
+	if (!res.async)
+		goto err;
+	faux_async_set_drain_cb(res.async, testc_async_drain_cb, &res);
+	if (!faux_async_set_watermarks(res.async,
+		TESTC_ASYNC_LOW, TESTC_ASYNC_HIGH))
+		goto err;
+
+	// Fill socket buffer and output queue up to high watermark
+	while (!faux_async_is_full(res.async)) {
+		if (!faux_async_write(res.async, chunk, sizeof(chunk),
+			NULL, NULL))
+			goto err;
+		res.queued += sizeof(chunk);
+		if (res.queued > 64 * 1024 * 1024) {
+			printf("faux_async_is_full: Queue is never full\n");
+			goto err;
+		}
+	}
+	if (faux_async_out_len(res.async) < TESTC_ASYNC_HIGH) {
+		printf("faux_async_is_full: Full queue is below high watermark\n");
+		goto err;
+	}
+
+	// Peer reads all data. The drain callback is executed once.
+	faux_eloop_add_fd(eloop, sv[1], POLLIN, testc_async_peer_cb, &res);
+	faux_eloop_add_sched_once_delayed(eloop, &fail, 1,
+		testc_async_fail_cb, &res);
+	if (!faux_eloop_loop(eloop))
+		goto err;
+	if (res.broken || (res.received != res.queued)) {
+		printf("Peer received %zu of %zu bytes\n",
+			res.received, res.queued);
+		goto err;
+	}
+	if ((res.drains != 1) || (res.drained_len > TESTC_ASYNC_LOW)) {
+		printf("Drain callback: calls=%d queue=%zu\n",
+			res.drains, res.drained_len);
+		goto err;
+	}
+	if (faux_async_out_len(res.async) != 0)
+		goto err;
+
+	ret = 0;
+err:
+	faux_async_free(res.async);
+	faux_eloop_free(eloop);
+	close(sv[0]);
+	close(sv[1]);
+
+	return ret;
+}
+
+
+typedef struct {
+	char data[32];
+	size_t len;
+	int depth; // Nesting level of read callback
+	int calls;
+	int closes;
+	int close_err;
+	bool_t broken;
+} testc_async_pause_t;
+
+
+static ssize_t testc_async_reenter_cb(faux_async_t *async,
+	const void *data, size_t len, void *user_data)
+{
+	testc_async_pause_t *res = (testc_async_pause_t *)user_data;
+
+	res->depth++;
+	if (res->depth > 1)
+		res->broken = BOOL_TRUE;
+	// Consume single byte and resume reading within callback
+	res->data[res->len++] = *(const char *)data;
+	faux_async_pause_read(async, BOOL_TRUE);
+	faux_async_pause_read(async, BOOL_FALSE);
+	res->depth--;
+
+	return 1;
+}
+
+
+static ssize_t testc_async_hangup_cb(faux_async_t *async,
+	const void *data, size_t len, void *user_data)
+{
+	testc_async_pause_t *res = (testc_async_pause_t *)user_data;
+
+	// Pause on the first call and consume data after resume
+	res->calls++;
+	if (1 == res->calls) {
+		faux_async_pause_read(async, BOOL_TRUE);
+		return 0;
+	}
+	if (res->len + len > sizeof(res->data)) {
+		res->broken = BOOL_TRUE;
+		return -1;
+	}
+	memcpy(res->data + res->len, data, len);
+	res->len += len;
+
+	return len;
+}
+
+
+static void testc_async_close_cb(faux_async_t *async, int err,
+	void *user_data)
+{
+	testc_async_pause_t *res = (testc_async_pause_t *)user_data;
+
+	res->closes++;
+	res->close_err = err;
+}
+
+
+static bool_t testc_async_resume_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	faux_async_pause_read((faux_async_t *)user_data, BOOL_FALSE);
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_async_stop_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	return BOOL_FALSE;
+}
+
+
+int testc_faux_async_pause(void)
+{
+	faux_eloop_t *eloop = NULL;
+	faux_async_t *async = NULL;
+	testc_async_pause_t res = {};
+	struct timespec resume = {0, 50000000l};
+	struct timespec stop = {0, 200000000l};
+	int sv[2] = {-1, -1};
+	int ret = -1; // Pessimistic
+
+	eloop = faux_eloop_new(NULL);
+	if (!eloop)
+		return -1;
+
+	// Failed object creation doesn't change descriptor mode
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		goto err;
+	}
+	faux_eloop_add_fd(eloop, sv[0], POLLIN, testc_async_stop_cb, NULL);
+	if (faux_async_new(eloop, sv[0])) {
+		printf("faux_async_new: Descriptor is registered twice\n");
+		goto err;
+	}
+	if (fcntl(sv[0], F_GETFL) & O_NONBLOCK) {
+		printf("faux_async_new: Descriptor mode is changed on error\n");
+		goto err;
+	}
+	faux_eloop_del_fd(eloop, sv[0]);
+
+	// Resume within read callback doesn't execute callback recursively
+	async = faux_async_new(eloop, sv[0]);
+	if (!async)
+		goto err;
+	faux_async_set_read_cb(async, testc_async_reenter_cb, &res);
+	if (write(sv[1], "0123456789", 10) != 10)
+		goto err;
+	faux_eloop_add_sched_once_delayed(eloop, &stop, 1,
+		testc_async_stop_cb, NULL);
+	faux_eloop_loop(eloop);
+	if (res.broken || (res.len != 10) ||
+		(memcmp(res.data, "0123456789", 10) != 0)) {
+		printf("Reentrance: nested=%d data=%zu bytes\n",
+			res.broken, res.len);
+		goto err;
+	}
+	faux_async_free(async);
+	async = NULL;
+	close(sv[0]);
+	close(sv[1]);
+
+	// Hang up while reading is paused. Buffered data is passed to read
+	// callback on resume and then connection is closed.
+	memset(&res, 0, sizeof(res));
+	res.close_err = -1;
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		goto err;
+	}
+	async = faux_async_new(eloop, sv[0]);
+	if (!async)
+		goto err;
+	faux_async_set_read_cb(async, testc_async_hangup_cb, &res);
+	faux_async_set_close_cb(async, testc_async_close_cb, &res);
+	if (write(sv[1], "hello", 5) != 5)
+		goto err;
+	close(sv[1]);
+	sv[1] = -1;
+	faux_eloop_add_sched_once_delayed(eloop, &resume, 1,
+		testc_async_resume_cb, async);
+	faux_eloop_add_sched_once_delayed(eloop, &stop, 2,
+		testc_async_stop_cb, NULL);
+	faux_eloop_loop(eloop);
+	if (res.broken || (res.len != 5) || (memcmp(res.data, "hello", 5) != 0)) {
+		printf("Hang up: Received %zu bytes\n", res.len);
+		goto err;
+	}
+	if ((res.closes != 1) || (res.close_err != 0)) {
+		printf("Hang up: closes=%d err=%d\n", res.closes, res.close_err);
+		goto err;
+	}
+
+	ret = 0;
+err:
+	faux_async_free(async);
+	faux_eloop_free(eloop);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+
+	return ret;
+}
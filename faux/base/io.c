@@ -12,6 +12,7 @@
 #include <sys/uio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
 
 #include "faux/faux.h"
 
@@ -249,3 +250,116 @@ ssize_t faux_read_whole_file(const char *path, void **data)
 
 	return total_readed;
 }
+
+
+// Max number of attempts to create unique temporary file
+#define FAUX_WRITE_TMP_ATTEMPTS 100
+// Max length of temporary file suffix ".<pid>.<counter>" with '\0'
+#define FAUX_WRITE_TMP_SUFFIX_LEN 48
+// Flags to open directory for syncing
+#define FAUX_WRITE_DIR_FLAGS (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+
+
+/** @brief Writes whole file atomically.
+ *
+ * Data is written to the temporary file within the same directory. Then the
+ * temporary file is synced and renamed to the specified name. So readers
+ * see the old or the new file content but never the partially written file.
+ * The directory is synced too so the new file survives the crash.
+ *
+ * Note the file is replaced by new one. So if the target is a symlink then
+ * symlink itself is replaced by regular file. The owner and group of the
+ * original file are not kept. The new file belongs to the current process
+ * user and group. Only permissions of existent file are kept.
+ *
+ * @param [in] path File name.
+ * @param [in] data Data to write.
+ * @param [in] n Number of bytes to write.
+ * @param [in] mode Permissions for new file. The process umask is applied
+ * like open() does. Existent file keeps its permissions.
+ * @return Number of bytes written or < 0 on error.
+ */
+ssize_t faux_write_whole_file(const char *path, const void *data, size_t n,
+	mode_t mode)
+{
+	struct stat statbuf = {};
+	char *tmp_path = NULL;
+	size_t path_len = 0;
+	char *dir = NULL;
+	char *slash = NULL;
+	ssize_t bytes_written = 0;
+	int fd = -1;
+	int dir_fd = -1;
+	unsigned int i = 0;
+	static unsigned int tmp_counter = 0;
+
+	assert(path);
+	assert(data || (0 == n));
+	if (!path || (!data && (n != 0)))
+		return -1;
+
+	// Temporary file within the same directory to make rename() atomic.
+	// The name is unique within process by counter and within system by
+	// PID. The stale file of dead process with the same PID is skipped.
+	// The kernel applies umask to the mode of new file.
+	path_len = strlen(path);
+	tmp_path = faux_zmalloc(path_len + FAUX_WRITE_TMP_SUFFIX_LEN);
+	if (!tmp_path)
+		return -1;
+	for (i = 0; (fd < 0) && (i < FAUX_WRITE_TMP_ATTEMPTS); i++) {
+		snprintf(tmp_path, path_len + FAUX_WRITE_TMP_SUFFIX_LEN,
+			"%s.%ld.%u", path, (long)getpid(),
+			__atomic_fetch_add(&tmp_counter, 1, __ATOMIC_RELAXED));
+		fd = open(tmp_path, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC,
+			mode);
+		if ((fd < 0) && (errno != EEXIST))
+			break;
+	}
+	if (fd < 0) {
+		faux_free(tmp_path);
+		return -1;
+	}
+
+	// Existent file keeps its permissions
+	if ((stat(path, &statbuf) == 0) &&
+		(fchmod(fd, statbuf.st_mode & 07777) < 0))
+		goto err;
+	if (((n != 0) && (faux_write_block(fd, data, n) != (ssize_t)n)) ||
+		(fsync(fd) < 0))
+		goto err;
+	close(fd);
+
+	if (rename(tmp_path, path) < 0) {
+		unlink(tmp_path);
+		faux_free(tmp_path);
+		return -1;
+	}
+	bytes_written = n;
+
+	// Sync directory. Don't analyze result because file is already written.
+	dir = tmp_path; // Reuse buffer
+	memcpy(dir, path, path_len + 1);
+	slash = strrchr(dir, '/');
+	if (!slash)
+		dir_fd = open(".", FAUX_WRITE_DIR_FLAGS);
+	else if (slash == dir)
+		dir_fd = open("/", FAUX_WRITE_DIR_FLAGS);
+	else {
+		*slash = '\0';
+		dir_fd = open(dir, FAUX_WRITE_DIR_FLAGS);
+	}
+	if (dir_fd >= 0) {
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+	faux_free(tmp_path);
+
+	return bytes_written;
+
+err:
+	close(fd);
+	unlink(tmp_path);
+	faux_free(tmp_path);
+
+	return -1;
+}
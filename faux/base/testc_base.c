@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <dirent.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -67,3 +69,77 @@ err:
 
 	return ret;
 }
+
+
+int testc_faux_write_whole_file(void)
+{
+	const char *basedir = getenv(FAUX_TESTC_TMPDIR_ENV);
+	const char *data1 = "first content\n";
+	const char *data2 = "second\n";
+	char *dn = NULL;
+	char *fn = NULL;
+	char *buf = NULL;
+	struct stat statbuf = {};
+	DIR *dir = NULL;
+	struct dirent *entry = NULL;
+	unsigned int entries = 0;
+	int ret = -1; // Pessimistic
+
+	dn = faux_str_sprintf("%s/whole", basedir);
+	fn = faux_str_sprintf("%s/file", dn);
+	mkdir(dn, 0777);
+
+	// The umask is applied to new file
+	umask(022);
+	if (faux_write_whole_file(fn, data1, strlen(data1), 0666) !=
+		(ssize_t)strlen(data1)) {
+		printf("Can't write new file\n");
+		goto err;
+	}
+	if ((stat(fn, &statbuf) < 0) || ((statbuf.st_mode & 07777) != 0644)) {
+		printf("Wrong mode of new file %o\n", statbuf.st_mode & 07777);
+		goto err;
+	}
+
+	// Existent file keeps its permissions
+	chmod(fn, 0600);
+	if (faux_write_whole_file(fn, data2, strlen(data2), 0666) !=
+		(ssize_t)strlen(data2)) {
+		printf("Can't rewrite file\n");
+		goto err;
+	}
+	if ((stat(fn, &statbuf) < 0) || ((statbuf.st_mode & 07777) != 0600)) {
+		printf("Wrong mode of rewritten file %o\n",
+			statbuf.st_mode & 07777);
+		goto err;
+	}
+	if ((faux_read_whole_file(fn, (void **)&buf) != (ssize_t)strlen(data2)) ||
+		(memcmp(buf, data2, strlen(data2)) != 0)) {
+		printf("Wrong content of rewritten file\n");
+		goto err;
+	}
+
+	// No temporary files are left
+	dir = opendir(dn);
+	if (!dir)
+		goto err;
+	while ((entry = readdir(dir)))
+		if (entry->d_name[0] != '.')
+			entries++;
+	if (entries != 1) {
+		printf("Temporary files are left\n");
+		goto err;
+	}
+
+	ret = 0;
+err:
+	if (dir)
+		closedir(dir);
+	free(buf);
+	unlink(fn);
+	rmdir(dn);
+	faux_str_free(fn);
+	faux_str_free(dn);
+
+	return ret;
+}
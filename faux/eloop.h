@@ -6,16 +6,30 @@
 #define _faux_eloop_h
 
 #include <faux/faux.h>
+#include <faux/sched.h>
 
 typedef struct faux_eloop_s faux_eloop_t;
+typedef struct faux_eloop_group_s faux_eloop_group_t;
 
 typedef enum {
 	FAUX_ELOOP_NULL = 0,
 	FAUX_ELOOP_SIGNAL = 1,
 	FAUX_ELOOP_SCHED = 2,
-	FAUX_ELOOP_FD = 3
+	FAUX_ELOOP_FD = 3,
+	FAUX_ELOOP_TASK = 4,
+	FAUX_ELOOP_PREPARE = 5, // Hook before waiting for events
+	FAUX_ELOOP_CHECK = 6, // Hook after dispatching of events
+	FAUX_ELOOP_IDLE = 7, // Hook for iteration without events
+	FAUX_ELOOP_DEFER = 8 // Deferred to the end of iteration
 } faux_eloop_type_e;
 
+// Backend to wait for file descriptor events
+typedef enum {
+	FAUX_ELOOP_BACKEND_AUTO = 0, // The best available one
+	FAUX_ELOOP_BACKEND_PPOLL = 1, // Portable ppoll()
+	FAUX_ELOOP_BACKEND_EPOLL = 2 // Linux epoll
+} faux_eloop_backend_e;
+
 typedef struct {
 	int ev_id;
 } faux_eloop_info_sched_t;
@@ -29,22 +43,111 @@ typedef struct {
 	int signo;
 } faux_eloop_info_signal_t;
 
+typedef struct {
+	int hook_id;
+} faux_eloop_info_hook_t;
+
+// Number of histogram buckets. Bucket 0 counts zero values. Bucket i
+// counts values within [2^(i-1), 2^i). The last bucket counts all the
+// greater values too.
+#define FAUX_ELOOP_HIST_LEN 24
+
+// Loop statistics
+typedef struct {
+	uint64_t iterations; // Number of loop iterations
+	uint64_t wakeups; // Number of iterations with events
+	uint64_t events; // Number of executed callbacks
+	faux_nsec_t wait_time; // Time spent within waiting for events
+	faux_nsec_t cb_time; // Time spent within callbacks
+	faux_nsec_t cb_max; // Duration of the slowest callback
+	faux_eloop_type_e cb_max_type; // Event type of the slowest callback
+	uint64_t budget_exhausted; // Iterations with exhausted dispatch budget
+	uint64_t events_hist[FAUX_ELOOP_HIST_LEN]; // Callbacks per iteration
+	uint64_t cb_hist[FAUX_ELOOP_HIST_LEN]; // Callback duration in usec
+} faux_eloop_stats_t;
+
+// File descriptor statistics
+typedef struct {
+	uint64_t calls; // Number of callback executions
+	faux_nsec_t cb_time; // Time spent within callback
+	faux_nsec_t cb_max; // Duration of the slowest callback execution
+} faux_eloop_fd_stats_t;
+
 // Callback function prototype
 typedef bool_t faux_eloop_cb_f(faux_eloop_t *eloop, faux_eloop_type_e type,
 	void *associated_data, void *user_data);
 
+// Statistics export callback prototype
+typedef bool_t faux_eloop_stats_cb_f(faux_eloop_t *eloop,
+	const faux_eloop_stats_t *stats, void *user_data);
+
 
 C_DECL_BEGIN
 
 faux_eloop_t *faux_eloop_new(faux_eloop_cb_f *default_event_cb);
+faux_eloop_t *faux_eloop_new_backend(faux_eloop_cb_f *default_event_cb,
+	faux_eloop_backend_e backend);
+faux_eloop_backend_e faux_eloop_backend(const faux_eloop_t *eloop);
 void faux_eloop_free(faux_eloop_t *eloop);
 bool_t faux_eloop_loop(faux_eloop_t *eloop);
 bool_t faux_eloop_add_fd(faux_eloop_t *eloop, int fd, short events,
 	faux_eloop_cb_f *event_cb, void *user_data);
 bool_t faux_eloop_del_fd(faux_eloop_t *eloop, int fd);
+bool_t faux_eloop_include_fd_event(faux_eloop_t *eloop, int fd, short events);
+bool_t faux_eloop_exclude_fd_event(faux_eloop_t *eloop, int fd, short events);
 bool_t faux_eloop_add_signal(faux_eloop_t *eloop, int signo,
 	faux_eloop_cb_f *event_cb, void *user_data);
 bool_t faux_eloop_del_signal(faux_eloop_t *eloop, int signo);
+bool_t faux_eloop_add_sched_once(faux_eloop_t *eloop,
+	const struct timespec *time, int ev_id,
+	faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_add_sched_once_delayed(faux_eloop_t *eloop,
+	const struct timespec *interval, int ev_id,
+	faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_add_sched_periodic(faux_eloop_t *eloop,
+	const struct timespec *time, int ev_id,
+	faux_eloop_cb_f *event_cb, void *user_data,
+	const struct timespec *period, unsigned int cycle_num);
+bool_t faux_eloop_add_sched_periodic_delayed(faux_eloop_t *eloop,
+	int ev_id, faux_eloop_cb_f *event_cb, void *user_data,
+	const struct timespec *period, unsigned int cycle_num);
+bool_t faux_eloop_del_sched(faux_eloop_t *eloop, int ev_id);
+bool_t faux_eloop_set_sched_slack(faux_eloop_t *eloop, int ev_id,
+	const struct timespec *slack);
+uint64_t faux_eloop_sched_wakeups_saved(const faux_eloop_t *eloop);
+bool_t faux_eloop_now(const faux_eloop_t *eloop, struct timespec *now);
+bool_t faux_eloop_post(faux_eloop_t *eloop,
+	faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_add_hook(faux_eloop_t *eloop, faux_eloop_type_e type,
+	int hook_id, faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_del_hook(faux_eloop_t *eloop, faux_eloop_type_e type,
+	int hook_id);
+bool_t faux_eloop_defer(faux_eloop_t *eloop,
+	faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_set_budget(faux_eloop_t *eloop, unsigned int max_events,
+	const struct timespec *max_time);
+bool_t faux_eloop_set_stats(faux_eloop_t *eloop, bool_t enable);
+bool_t faux_eloop_reset_stats(faux_eloop_t *eloop);
+bool_t faux_eloop_stats(const faux_eloop_t *eloop, faux_eloop_stats_t *stats);
+bool_t faux_eloop_fd_stats(const faux_eloop_t *eloop, int fd,
+	faux_eloop_fd_stats_t *stats);
+bool_t faux_eloop_set_stats_export(faux_eloop_t *eloop,
+	const struct timespec *period, faux_eloop_stats_cb_f *export_cb,
+	void *user_data);
+
+// Group of loops running within separate threads
+faux_eloop_group_t *faux_eloop_group_new(unsigned int num,
+	faux_eloop_cb_f *default_event_cb, faux_eloop_backend_e backend);
+void faux_eloop_group_free(faux_eloop_group_t *group);
+unsigned int faux_eloop_group_len(const faux_eloop_group_t *group);
+faux_eloop_t *faux_eloop_group_loop(const faux_eloop_group_t *group,
+	unsigned int index);
+faux_eloop_t *faux_eloop_group_next(faux_eloop_group_t *group);
+faux_eloop_t *faux_eloop_group_add_fd(faux_eloop_group_t *group, int fd,
+	short events, faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_group_post_each(faux_eloop_group_t *group,
+	faux_eloop_cb_f *event_cb, void *user_data);
+bool_t faux_eloop_group_run(faux_eloop_group_t *group);
 
 C_DECL_END
 
@@ -8,6 +8,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -20,6 +21,12 @@
 #include <signal.h>
 #include <poll.h>
 #include <sys/signalfd.h>
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+#ifdef HAVE_TIMERFD_CREATE
+#include <sys/timerfd.h>
+#endif
 
 #include "faux/faux.h"
 #include "faux/str.h"
@@ -29,6 +36,65 @@
 
 #include "private.h"
 
+// The sigprocmask() is unspecified within multithreaded process. The loops
+// can work within threads (see faux_eloop_group_t).
+#ifdef HAVE_PTHREAD
+#define setsigmask pthread_sigmask
+#else
+#define setsigmask sigprocmask
+#endif
+
+#ifdef HAVE_TIMERFD_CREATE
+#define TIMERFD_FLAGS (TFD_NONBLOCK | TFD_CLOEXEC)
+#endif
+
+#ifdef HAVE_EPOLL_CREATE1
+/** @brief Converts poll() events to epoll() events.
+ */
+static uint32_t faux_eloop_poll_to_epoll(short events)
+{
+	uint32_t epoll_events = 0;
+
+	if (events & POLLIN)
+		epoll_events |= EPOLLIN;
+	if (events & POLLPRI)
+		epoll_events |= EPOLLPRI;
+	if (events & POLLOUT)
+		epoll_events |= EPOLLOUT;
+#ifdef POLLRDHUP
+	if (events & POLLRDHUP)
+		epoll_events |= EPOLLRDHUP;
+#endif
+
+	return epoll_events;
+}
+
+
+/** @brief Converts epoll() events to poll() events.
+ */
+static short faux_eloop_epoll_to_poll(uint32_t epoll_events)
+{
+	short events = 0;
+
+	if (epoll_events & EPOLLIN)
+		events |= POLLIN;
+	if (epoll_events & EPOLLPRI)
+		events |= POLLPRI;
+	if (epoll_events & EPOLLOUT)
+		events |= POLLOUT;
+	if (epoll_events & EPOLLERR)
+		events |= POLLERR;
+	if (epoll_events & EPOLLHUP)
+		events |= POLLHUP;
+#ifdef POLLRDHUP
+	if (epoll_events & EPOLLRDHUP)
+		events |= POLLRDHUP;
+#endif
+
+	return events;
+}
+#endif
+
 #ifdef HAVE_SIGNALFD
 #define SIGNALFD_FLAGS (SFD_NONBLOCK | SFD_CLOEXEC)
 
@@ -68,43 +134,66 @@ static int faux_eloop_sched_kcompare(const void *key, const void *list_item)
 }
 
 
-static int faux_eloop_fd_compare(const void *first, const void *second)
+static int faux_eloop_signal_compare(const void *first, const void *second)
 {
-	const faux_eloop_fd_t *f = (const faux_eloop_fd_t *)first;
-	const faux_eloop_fd_t *s = (const faux_eloop_fd_t *)second;
+	const faux_eloop_signal_t *f = (const faux_eloop_signal_t *)first;
+	const faux_eloop_signal_t *s = (const faux_eloop_signal_t *)second;
 
-	return (f->fd - s->fd);
+	return (f->signo - s->signo);
 }
 
 
-static int faux_eloop_fd_kcompare(const void *key, const void *list_item)
+static int faux_eloop_signal_kcompare(const void *key, const void *list_item)
 {
 	int *f = (int *)key;
-	const faux_eloop_fd_t *s = (const faux_eloop_fd_t *)list_item;
+	const faux_eloop_signal_t *s = (const faux_eloop_signal_t *)list_item;
 
-	return (*f - s->fd);
+	return (*f - s->signo);
 }
 
 
-static int faux_eloop_signal_compare(const void *first, const void *second)
+static int faux_eloop_hook_compare(const void *first, const void *second)
 {
-	const faux_eloop_signal_t *f = (const faux_eloop_signal_t *)first;
-	const faux_eloop_signal_t *s = (const faux_eloop_signal_t *)second;
+	const faux_eloop_hook_t *f = (const faux_eloop_hook_t *)first;
+	const faux_eloop_hook_t *s = (const faux_eloop_hook_t *)second;
 
-	return (f->signo - s->signo);
+	return (f->hook_id - s->hook_id);
 }
 
 
-static int faux_eloop_signal_kcompare(const void *key, const void *list_item)
+static int faux_eloop_hook_kcompare(const void *key, const void *list_item)
 {
 	int *f = (int *)key;
-	const faux_eloop_signal_t *s = (const faux_eloop_signal_t *)list_item;
+	const faux_eloop_hook_t *s = (const faux_eloop_hook_t *)list_item;
 
-	return (*f - s->signo);
+	return (*f - s->hook_id);
 }
 
 
+/** @brief Allocates event loop object with the best available backend.
+ *
+ * @param [in] default_event_cb Default callback function.
+ * @return Allocated event loop object or NULL on error.
+ */
 faux_eloop_t *faux_eloop_new(faux_eloop_cb_f *default_event_cb)
+{
+	return faux_eloop_new_backend(default_event_cb, FAUX_ELOOP_BACKEND_AUTO);
+}
+
+
+/** @brief Allocates event loop object with specified backend.
+ *
+ * The epoll backend dispatches ready descriptors only so it's preferable
+ * for big number of mostly idle descriptors. The ppoll() backend is
+ * portable. If requested backend is unavailable then ppoll() backend
+ * is used. Use faux_eloop_backend() to get actual backend.
+ *
+ * @param [in] default_event_cb Default callback function.
+ * @param [in] backend Backend to wait for file descriptor events.
+ * @return Allocated event loop object or NULL on error.
+ */
+faux_eloop_t *faux_eloop_new_backend(faux_eloop_cb_f *default_event_cb,
+	faux_eloop_backend_e backend)
 {
 	faux_eloop_t *eloop = NULL;
 
@@ -125,11 +214,16 @@ faux_eloop_t *faux_eloop_new(faux_eloop_cb_f *default_event_cb)
 	assert(eloop->faux_sched);
 
 	// FD
-	eloop->fds = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
-		faux_eloop_fd_compare, faux_eloop_fd_kcompare, faux_free);
-	assert(eloop->fds);
+	eloop->fds = NULL;
+	eloop->fds_size = 0;
 	eloop->pollfds = faux_pollfd_new();
 	assert(eloop->pollfds);
+#ifdef HAVE_EPOLL_CREATE1
+	eloop->epoll_fd = -1;
+	if ((FAUX_ELOOP_BACKEND_AUTO == backend) ||
+		(FAUX_ELOOP_BACKEND_EPOLL == backend))
+		eloop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+#endif
 
 	// Signal
 	eloop->signals = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
@@ -140,6 +234,64 @@ faux_eloop_t *faux_eloop_new(faux_eloop_cb_f *default_event_cb)
 #ifdef HAVE_SIGNALFD
 	eloop->signal_fd = -1;
 #endif
+#ifdef HAVE_TIMERFD_CREATE
+	eloop->timer_fd = -1;
+	eloop->timer_armed = BOOL_FALSE;
+#endif
+
+	// Tasks
+	eloop->tasks = NULL;
+	eloop->wake_pending = BOOL_FALSE;
+	eloop->wake_fd[0] = -1;
+	eloop->wake_fd[1] = -1;
+	eloop->stop_requested = BOOL_FALSE;
+	eloop->worker = BOOL_FALSE;
+#ifdef HAVE_EVENTFD
+	// The same eventfd is used for reading and writing
+	eloop->wake_fd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	eloop->wake_fd[1] = eloop->wake_fd[0];
+#else
+	if (pipe(eloop->wake_fd) == 0) {
+		int i = 0;
+		for (i = 0; i < 2; i++) {
+			fcntl(eloop->wake_fd[i], F_SETFL, O_NONBLOCK);
+			fcntl(eloop->wake_fd[i], F_SETFD, FD_CLOEXEC);
+		}
+	}
+#endif
+
+	// Hooks
+	eloop->prepare_hooks = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
+		faux_eloop_hook_compare, faux_eloop_hook_kcompare, faux_free);
+	assert(eloop->prepare_hooks);
+	eloop->check_hooks = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
+		faux_eloop_hook_compare, faux_eloop_hook_kcompare, faux_free);
+	assert(eloop->check_hooks);
+	eloop->idle_hooks = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
+		faux_eloop_hook_compare, faux_eloop_hook_kcompare, faux_free);
+	assert(eloop->idle_hooks);
+	eloop->hooks_dispatching = NULL;
+	eloop->hooks_deleted = BOOL_FALSE;
+	eloop->defer_head = NULL;
+	eloop->defer_tail = NULL;
+
+	// Dispatch budget
+	eloop->budget_events = 0;
+	eloop->budget_time = 0;
+	eloop->dispatch_start = 0;
+	eloop->dispatch_iter = 0;
+	eloop->pending = NULL;
+	eloop->pending_len = 0;
+	eloop->pending_size = 0;
+
+	// Statistics
+	eloop->stats = NULL;
+	eloop->stats_cb = NULL;
+	eloop->stats_udata = NULL;
+	eloop->stats_period = 0;
+	eloop->stats_last = 0;
+	eloop->iter_events = 0;
+	eloop->last_cb_time = 0;
 
 	return eloop;
 }
@@ -147,12 +299,44 @@ faux_eloop_t *faux_eloop_new(faux_eloop_cb_f *default_event_cb)
 
 void faux_eloop_free(faux_eloop_t *eloop)
 {
+	size_t i = 0;
+
 	if (!eloop)
 		return;
 
+	faux_free(eloop->stats);
+
+	// Hooks and not executed deferred callbacks
+	faux_list_free(eloop->prepare_hooks);
+	faux_list_free(eloop->check_hooks);
+	faux_list_free(eloop->idle_hooks);
+	while (eloop->defer_head) {
+		faux_eloop_task_t *task = eloop->defer_head;
+		eloop->defer_head = task->next;
+		faux_free(task);
+	}
+
+	// Not executed tasks
+	while (eloop->tasks) {
+		faux_eloop_task_t *task = eloop->tasks;
+		eloop->tasks = task->next;
+		faux_free(task);
+	}
+	if (eloop->wake_fd[0] >= 0)
+		close(eloop->wake_fd[0]);
+	if ((eloop->wake_fd[1] >= 0) && (eloop->wake_fd[1] != eloop->wake_fd[0]))
+		close(eloop->wake_fd[1]);
+
 	faux_list_free(eloop->signals);
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0)
+		close(eloop->epoll_fd);
+#endif
 	faux_pollfd_free(eloop->pollfds);
-	faux_list_free(eloop->fds);
+	for (i = 0; i < eloop->fds_size; i++)
+		faux_free(eloop->fds[i]);
+	faux_free(eloop->fds);
+	faux_free(eloop->pending);
 	faux_sched_free(eloop->faux_sched);
 	faux_list_free(eloop->scheds);
 
@@ -160,337 +344,2050 @@ void faux_eloop_free(faux_eloop_t *eloop)
 }
 
 
-bool_t faux_eloop_loop(faux_eloop_t *eloop)
+/** @brief Returns histogram bucket for value.
+ *
+ * @param [in] value Value.
+ * @return Bucket index.
+ */
+static unsigned int faux_eloop_hist_bucket(uint64_t value)
 {
-	bool_t retval = BOOL_TRUE;
-	bool_t stop = BOOL_FALSE;
-	sigset_t blocked_signals;
-	sigset_t orig_sig_set;
-	sigset_t *sigset_for_ppoll = NULL;
+	unsigned int bucket = 0;
 
-	// If event loop is active already and we try to start nested loop
-	// then return.
-	if (eloop->working)
-		return BOOL_FALSE;
-	eloop->working = BOOL_TRUE;
+	while (value && (bucket < (FAUX_ELOOP_HIST_LEN - 1))) {
+		value >>= 1;
+		bucket++;
+	}
 
-	// Block signals to prevent race conditions while loop and ppoll()
-	// Catch signals while ppoll() only
-	sigfillset(&blocked_signals);
-	sigprocmask(SIG_SETMASK, &blocked_signals, &orig_sig_set);
+	return bucket;
+}
 
-#ifdef HAVE_SIGNALFD
-	// Create Linux-specific signal file descriptor. Wait for all signals.
-	// Unneeded signals will be filtered out later.
-	eloop->signal_fd = signalfd(eloop->signal_fd, &eloop->sig_set,
-		SIGNALFD_FLAGS);
-	faux_pollfd_add(eloop->pollfds, eloop->signal_fd, POLLIN);
 
-#else // Standard signal processing
-	sigset_for_ppoll = &eloop->sig_mask;
-	faux_eloop_static_user_data = eloop->signals;
+/** @brief Executes statistics export callback if period is expired.
+ *
+ * The callback gets copy of statistics because it can reset or disable
+ * statistics.
+ *
+ * @param [in] eloop Event loop object.
+ * @return BOOL_TRUE if callback asked to stop the loop.
+ */
+static bool_t faux_eloop_export_stats(faux_eloop_t *eloop)
+{
+	faux_eloop_stats_t snapshot = {};
 
-	if (faux_list_len(eloop->signals) != 0) {
-		faux_list_node_t *iter = faux_list_head(eloop->signals);
-		faux_eloop_signal_t *sig = NULL;
-		struct sigaction sig_act = {};
+	if (!eloop->stats_cb || !eloop->stats)
+		return BOOL_FALSE;
+	if ((eloop->now - eloop->stats_last) < eloop->stats_period)
+		return BOOL_FALSE;
+	eloop->stats_last = eloop->now;
+	snapshot = *eloop->stats;
 
-		sig_act.sa_flags = 0;
-		sig_act.sa_mask = eloop->sig_set;
-		sig_act.sa_handler = &faux_eloop_static_sighandler;
-		while ((sig = (faux_eloop_signal_t *)faux_list_each(&iter))) {
-			sig->set = BOOL_FALSE;
-			sigaction(sig->signo, &sig_act, &sig->oldact);
-		}
+	// BOOL_FALSE return value means "break the loop"
+	return !eloop->stats_cb(eloop, &snapshot, eloop->stats_udata);
+}
+
+
+/** @brief Executes event callback.
+ *
+ * All the callbacks are executed by this function. It measures callback
+ * duration if statistics is enabled. So disabled statistics costs single
+ * check.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] event_cb Callback function.
+ * @param [in] type Event type.
+ * @param [in] associated_data Associated data.
+ * @param [in] user_data User data for callback function.
+ * @return Return value of callback.
+ */
+static bool_t faux_eloop_exec(faux_eloop_t *eloop, faux_eloop_cb_f *event_cb,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	faux_eloop_stats_t *stats = eloop->stats;
+	faux_nsec_t start = 0;
+	faux_nsec_t duration = 0;
+	bool_t r = BOOL_FALSE;
+
+	if (!stats)
+		return event_cb(eloop, type, associated_data, user_data);
+
+	start = faux_nsec_now_monotonic();
+	r = event_cb(eloop, type, associated_data, user_data);
+	duration = faux_nsec_now_monotonic() - start;
+
+	// Callback can disable statistics
+	stats = eloop->stats;
+	if (!stats)
+		return r;
+	eloop->last_cb_time = duration;
+	eloop->iter_events++;
+	stats->events++;
+	stats->cb_time += duration;
+	if (duration > stats->cb_max) {
+		stats->cb_max = duration;
+		stats->cb_max_type = type;
 	}
-#endif
+	stats->cb_hist[faux_eloop_hist_bucket(duration / 1000)]++;
 
-	// Main loop
-	while (!stop) {
-		int sn = 0;
-		struct timespec *timeout = NULL;
-//		struct timespec next_interval = {};
-		faux_pollfd_iterator_t pollfd_iter;
-		struct pollfd *pollfd = NULL;
+	return r;
+}
 
-		// Find out next scheduled interval
-/*		if (faux_sched_next_interval(eloop->sched, &next_interval) < 0)
-			timeout = NULL;
-		else
-			timeout = &next_interval;
-*/
 
-		// Wait for events
-		sn = ppoll(faux_pollfd_vector(eloop->pollfds),
-			faux_pollfd_len(eloop->pollfds), timeout, sigset_for_ppoll);
+/** @brief Executes callbacks for all already coming scheduled events.
+ *
+ * The events are dispatched in batch. The number of events within batch
+ * is limited by the number of events scheduled before the batch start.
+ * So periodic events with short period can't lock the loop.
+ *
+ * @param [in] eloop Event loop object.
+ * @return BOOL_TRUE if some callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_scheds(faux_eloop_t *eloop)
+{
+	size_t batch = faux_sched_len(eloop->faux_sched);
+	int ev_id = 0;
+	void *data = NULL;
+	bool_t stop = BOOL_FALSE;
 
-		if ((sn < 0) && (errno != EINTR)) {
-			retval = BOOL_FALSE;
-			break;
-		}
+	while ((batch-- > 0) && (faux_sched_pop_at(eloop->faux_sched,
+		eloop->now, &ev_id, &data) == 0)) {
+		faux_eloop_sched_t *entry = (faux_eloop_sched_t *)data;
+		faux_eloop_context_t context = entry->context;
+		faux_eloop_info_sched_t info = {};
+		faux_eloop_cb_f *event_cb = NULL;
+
+		// Forget entry after the last cycle. Do it before callback so
+		// callback can register the same ID again.
+		if (entry->cycle_num != FAUX_SCHED_INFINITE)
+			entry->cycle_num--;
+		if (0 == entry->cycle_num)
+			faux_list_kdel(eloop->scheds, &ev_id);
+
+		event_cb = context.event_cb;
+		if (!event_cb)
+			event_cb = eloop->default_event_cb;
+		if (!event_cb) // Callback is not defined
+			continue;
+		info.ev_id = ev_id;
+
+		// Execute callback
+		// BOOL_FALSE return value means "break the loop"
+		if (!faux_eloop_exec(eloop, event_cb, FAUX_ELOOP_SCHED, &info,
+			context.user_data))
+			stop = BOOL_TRUE;
+	}
 
-#ifndef HAVE_SIGNALFD // Standard signals
-		// Signals
-		if ((sn < 0) && (EINTR == errno)) {
-			faux_list_node_t *iter = faux_list_head(eloop->signals);
-			faux_eloop_signal_t *sig = NULL;
-			while ((sig = (faux_eloop_signal_t *)faux_list_each(&iter))) {
-				faux_eloop_info_signal_t sinfo = {};
-				faux_eloop_cb_f *event_cb = NULL;
-				bool_t r = BOOL_TRUE;
+	return stop;
+}
 
-				if (BOOL_FALSE == sig->set)
-					continue;
-				sig->set = BOOL_FALSE;
 
-				event_cb = sig->context.event_cb;
-				if (!event_cb)
-					event_cb = eloop->default_event_cb;
-				if (!event_cb) // Callback is not defined
-					continue;
-				sinfo.signo = sig->signo;
+#ifdef HAVE_TIMERFD_CREATE
+/** @brief Arms timer file descriptor to the time of the nearest event.
+ *
+ * The timer is armed with absolute time so it's not needed to recalculate
+ * interval on each loop iteration. The timer is re-armed only when the
+ * nearest event was changed.
+ *
+ * @param [in] eloop Event loop object.
+ * @return 0 - success, < 0 on error.
+ */
+static int faux_eloop_timer_arm(faux_eloop_t *eloop)
+{
+	struct itimerspec its = {};
+	struct timespec next = {};
+
+	// No scheduled events. Disarm timer.
+	if (faux_sched_next_time(eloop->faux_sched, &next) < 0) {
+		if (!eloop->timer_armed)
+			return 0;
+		eloop->timer_armed = BOOL_FALSE;
+		return timerfd_settime(eloop->timer_fd, 0, &its, NULL);
+	}
 
-				// Execute callback
-				r = event_cb(eloop, FAUX_ELOOP_SIGNAL, &sinfo,
-					sig->context.user_data);
-				// BOOL_FALSE return value means "break the loop"
-				if (!r)
-					stop = BOOL_TRUE;
-			}
-		}
+	// The nearest event is not changed
+	if (eloop->timer_armed &&
+		(faux_timespec_cmp(&next, &eloop->timer_time) == 0))
+		return 0;
+
+	its.it_value = next;
+	// Zero value disarms timer so use the minimal non-zero one
+	if ((0 == next.tv_sec) && (0 == next.tv_nsec))
+		its.it_value.tv_nsec = 1;
+	if (timerfd_settime(eloop->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+		return -1;
+	eloop->timer_armed = BOOL_TRUE;
+	eloop->timer_time = next;
+
+	return 0;
+}
 #endif
 
-		// Scheduled event
-		if (0 == sn) {
-//			int id = 0; // Event idenftifier
-//			void *data = NULL; // Event data
-//			faux_eloop_info_sched_t info = {};
 
-printf("Sheduled event\n");
-			// Some scheduled events
-/*			while(faux_sched_pop(sched, &id, &data) == 0) {
-				syslog(LOG_DEBUG, "sched: Update event\n");
-			}
-*/			continue;
-		}
+/** @brief Returns registered descriptor entry.
+ *
+ * The descriptors array is indexed by fd so it costs O(1).
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @return Registered entry or NULL if fd is not registered.
+ */
+static faux_eloop_fd_t *faux_eloop_fd_entry(const faux_eloop_t *eloop, int fd)
+{
+	if ((fd < 0) || ((size_t)fd >= eloop->fds_size))
+		return NULL;
 
+	return eloop->fds[fd];
+}
 
-		// File descriptor
-		faux_pollfd_init_iterator(eloop->pollfds, &pollfd_iter);
-		while ((pollfd = faux_pollfd_each_active(eloop->pollfds, &pollfd_iter))) {
-			int fd = pollfd->fd;
-			faux_eloop_info_fd_t info = {};
-			faux_eloop_cb_f *event_cb = NULL;
-			faux_eloop_fd_t *entry = NULL;
-			bool_t r = BOOL_TRUE;
 
-#ifdef HAVE_SIGNALFD
-			// Read special signal file descriptor
-			if (fd == eloop->signal_fd) {
-				struct signalfd_siginfo signal_info = {};
-
-				while (faux_read_block(fd, &signal_info,
-					sizeof(signal_info)) == sizeof(signal_info)) {
-					faux_eloop_info_signal_t sinfo = {};
-					faux_eloop_signal_t *sentry =
-						(faux_eloop_signal_t *)faux_list_kfind(
-						eloop->signals, &signal_info.ssi_signo);
-
-					if (!sentry) // Not registered signal. Drop it.
-						continue;
-					event_cb = sentry->context.event_cb;
-					if (!event_cb)
-						event_cb = eloop->default_event_cb;
-					if (!event_cb) // Callback is not defined
-						continue;
-					sinfo.signo = sentry->signo;
-
-					// Execute callback
-					r = event_cb(eloop, FAUX_ELOOP_SIGNAL, &sinfo,
-						sentry->context.user_data);
-					// BOOL_FALSE return value means "break the loop"
-					if (!r)
-						stop = BOOL_TRUE;
-				}
-				continue; // Another fds are common, not signal
-			}
+/** @brief Starts watching for file descriptor events by loop backend.
+ *
+ * The epoll doesn't support regular files and directories. The epoll_ctl()
+ * returns EPERM for them. Such descriptors are always ready so the epoll
+ * backend keeps them within ppoll() set and checks them without waiting.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @param [in] events Events to watch for (poll() format).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+static bool_t faux_eloop_watch_fd(faux_eloop_t *eloop, int fd, short events)
+{
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0) {
+		struct epoll_event ev = {};
+
+		ev.events = faux_eloop_poll_to_epoll(events);
+		ev.data.fd = fd;
+		if (epoll_ctl(eloop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+			return BOOL_TRUE;
+		if (errno != EPERM)
+			return BOOL_FALSE;
+	}
 #endif
 
-			// Prepare event data
-			entry = (faux_eloop_fd_t *)faux_list_kfind(eloop->fds, &fd);
-			assert(entry);
-			if (!entry) // Something went wrong
-				continue;
-			event_cb = entry->context.event_cb;
-			if (!event_cb)
-				event_cb = eloop->default_event_cb;
-			if (!event_cb) // Callback function is not defined for this event
-				continue;
-			info.fd = fd;
-			info.revents = pollfd->revents;
-
-			// Execute callback
-			r = event_cb(eloop, FAUX_ELOOP_FD, &info, entry->context.user_data);
-			// BOOL_FALSE return value means "break the loop"
-			if (!r)
-				stop = BOOL_TRUE;
-		}
-
-	} // Loop end
+	if (!faux_pollfd_add(eloop->pollfds, fd, events))
+		return BOOL_FALSE;
 
-#ifdef HAVE_SIGNALFD
-	// Close signal file descriptor
-	faux_pollfd_del_by_fd(eloop->pollfds, eloop->signal_fd);
-	close(eloop->signal_fd);
-	eloop->signal_fd = -1;
+	return BOOL_TRUE;
+}
 
-#else // Standard signals. Restore signal handlers
-	if (faux_list_len(eloop->signals) != 0) {
-		faux_list_node_t *iter = faux_list_head(eloop->signals);
-		faux_eloop_signal_t *sig = NULL;
 
-		while ((sig = (faux_eloop_signal_t *)faux_list_each(&iter))) {
-			sig->set = BOOL_FALSE;
-			sigaction(sig->signo, &sig->oldact, NULL);
-		}
+/** @brief Stops watching for file descriptor events by loop backend.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+static bool_t faux_eloop_unwatch_fd(faux_eloop_t *eloop, int fd)
+{
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0) {
+		// Descriptor unsupported by epoll
+		if (faux_pollfd_del_by_fd(eloop->pollfds, fd) == 0)
+			return BOOL_TRUE;
+		// The descriptor can be already closed. Then it's removed from
+		// epoll set automatically and error is not significant.
+		epoll_ctl(eloop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+		return BOOL_TRUE;
 	}
 #endif
 
-	// Unblock signals
-	sigprocmask(SIG_SETMASK, &orig_sig_set, NULL);
-
-	// Deactivate loop flag
-	eloop->working = BOOL_FALSE;
+	if (faux_pollfd_del_by_fd(eloop->pollfds, fd) < 0)
+		return BOOL_FALSE;
 
-	return retval;
+	return BOOL_TRUE;
 }
 
 
-bool_t faux_eloop_add_fd(faux_eloop_t *eloop, int fd, short events,
-	faux_eloop_cb_f *event_cb, void *user_data)
+/** @brief Changes events to watch for by loop backend.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @param [in] events New events to watch for (poll() format).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+static bool_t faux_eloop_rewatch_fd(faux_eloop_t *eloop, int fd, short events)
 {
-	faux_eloop_fd_t *entry = NULL;
-	faux_list_node_t *new_node = NULL;
+	struct pollfd *pfd = NULL;
+
+#ifdef HAVE_EPOLL_CREATE1
+	if ((eloop->epoll_fd >= 0) &&
+		!faux_pollfd_find(eloop->pollfds, fd)) {
+		struct epoll_event ev = {};
+
+		ev.events = faux_eloop_poll_to_epoll(events);
+		ev.data.fd = fd;
+		if (epoll_ctl(eloop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)
+			return BOOL_FALSE;
+		return BOOL_TRUE;
+	}
+#endif
 
-	if (!eloop || (fd < 0))
+	pfd = faux_pollfd_find(eloop->pollfds, fd);
+	if (!pfd)
 		return BOOL_FALSE;
+	pfd->events = events;
 
-	entry = faux_zmalloc(sizeof(*entry));
-	if (!entry)
-		return BOOL_FALSE;
-	entry->fd = fd;
-	entry->events = events;
-	entry->context.event_cb = event_cb;
-	entry->context.user_data = user_data;
+	return BOOL_TRUE;
+}
 
-	if (!(new_node = faux_list_add(eloop->fds, entry))) {
-		faux_free(entry);
-		return BOOL_FALSE;
-	}
 
-	if (!faux_pollfd_add(eloop->pollfds, entry->fd, entry->events)) {
-		faux_list_del(eloop->fds, new_node);
-		faux_free(entry);
-		return BOOL_FALSE;
+#ifdef HAVE_SIGNALFD
+/** @brief Executes callbacks for signals read from signal file descriptor.
+ *
+ * @param [in] eloop Event loop object.
+ * @return BOOL_TRUE if some callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_signalfd(faux_eloop_t *eloop)
+{
+	struct signalfd_siginfo signal_info = {};
+	bool_t stop = BOOL_FALSE;
+
+	while (faux_read_block(eloop->signal_fd, &signal_info,
+		sizeof(signal_info)) == sizeof(signal_info)) {
+		faux_eloop_info_signal_t sinfo = {};
+		faux_eloop_cb_f *event_cb = NULL;
+		faux_eloop_signal_t *sentry =
+			(faux_eloop_signal_t *)faux_list_kfind(
+			eloop->signals, &signal_info.ssi_signo);
+
+		if (!sentry) // Not registered signal. Drop it.
+			continue;
+		event_cb = sentry->context.event_cb;
+		if (!event_cb)
+			event_cb = eloop->default_event_cb;
+		if (!event_cb) // Callback is not defined
+			continue;
+		sinfo.signo = sentry->signo;
+
+		// Execute callback
+		// BOOL_FALSE return value means "break the loop"
+		if (!faux_eloop_exec(eloop, event_cb, FAUX_ELOOP_SIGNAL, &sinfo,
+			sentry->context.user_data))
+			stop = BOOL_TRUE;
 	}
 
-	return BOOL_TRUE;
+	return stop;
 }
+#endif
 
 
-bool_t faux_eloop_del_fd(faux_eloop_t *eloop, int fd)
+/** @brief Executes callbacks for posted tasks.
+ *
+ * The whole queue is taken at once so tasks posted by callbacks will be
+ * executed on the next iteration. The queue is a lock-free stack so it's
+ * reversed to execute tasks in order of posting.
+ *
+ * @param [in] eloop Event loop object.
+ * @return BOOL_TRUE if some callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_tasks(faux_eloop_t *eloop)
 {
-	if (!eloop || (fd < 0))
-		return BOOL_FALSE;
+	faux_eloop_task_t *stack = NULL;
+	faux_eloop_task_t *task = NULL;
+	char buf[256];
+	bool_t stop = BOOL_FALSE;
 
-	if (faux_list_kdel(eloop->fds, &fd) < 0)
-		return BOOL_FALSE;
+	// Drain wake up descriptor. Then allow posters to wake up loop again.
+	// The flag is cleared before taking the queue so task posted after
+	// taking will wake up loop.
+	while (read(eloop->wake_fd[0], buf, sizeof(buf)) > 0);
+	__atomic_store_n(&eloop->wake_pending, BOOL_FALSE, __ATOMIC_SEQ_CST);
+
+	// Take whole stack and reverse it
+	stack = __atomic_exchange_n(&eloop->tasks, NULL, __ATOMIC_SEQ_CST);
+	while (stack) {
+		faux_eloop_task_t *next = stack->next;
+		stack->next = task;
+		task = stack;
+		stack = next;
+	}
 
-	if (faux_pollfd_del_by_fd(eloop->pollfds, fd) < 0)
-		return BOOL_FALSE;
+	while (task) {
+		faux_eloop_task_t *next = task->next;
+		faux_eloop_context_t context = task->context;
+		faux_eloop_cb_f *event_cb = NULL;
+
+		faux_free(task);
+		task = next;
+		event_cb = context.event_cb;
+		if (!event_cb)
+			event_cb = eloop->default_event_cb;
+		if (!event_cb) // Callback is not defined
+			continue;
+
+		// Execute callback
+		// BOOL_FALSE return value means "break the loop"
+		if (!faux_eloop_exec(eloop, event_cb, FAUX_ELOOP_TASK, NULL,
+			context.user_data))
+			stop = BOOL_TRUE;
+	}
 
-	return BOOL_TRUE;
+	return stop;
 }
 
 
-bool_t faux_eloop_add_signal(faux_eloop_t *eloop, int signo,
-	faux_eloop_cb_f *event_cb, void *user_data)
+/** @brief Returns list of hooks for specified hook type.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] type Hook type.
+ * @return List of hooks or NULL for invalid type.
+ */
+static faux_list_t *faux_eloop_hooks(const faux_eloop_t *eloop,
+	faux_eloop_type_e type)
 {
-	faux_eloop_signal_t *entry = NULL;
+	switch (type) {
+	case FAUX_ELOOP_PREPARE:
+		return eloop->prepare_hooks;
+	case FAUX_ELOOP_CHECK:
+		return eloop->check_hooks;
+	case FAUX_ELOOP_IDLE:
+		return eloop->idle_hooks;
+	default:
+		break;
+	}
 
-	if (!eloop || (signo < 0))
-		return BOOL_FALSE;
+	return NULL;
+}
 
-	if (sigismember(&eloop->sig_set, signo) == 1)
-		return BOOL_FALSE; // Already exists
 
-	// Firstly try to add signal to sigset. Library function will validate
-	// signal number value.
-	if (sigaddset(&eloop->sig_set, signo) < 0)
-		return BOOL_FALSE; // Invalid signal number
-	sigdelset(&eloop->sig_mask, signo);
+/** @brief Executes callbacks of hooks.
+ *
+ * The callback can delete hooks of the same type. The iterator already
+ * points to the next hook so deleted hooks are only marked while
+ * dispatching. They are skipped and freed after the pass.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] type Hook type.
+ * @return BOOL_TRUE if some callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_hooks(faux_eloop_t *eloop,
+	faux_eloop_type_e type)
+{
+	faux_list_t *hooks = faux_eloop_hooks(eloop, type);
+	faux_list_node_t *iter = faux_list_head(hooks);
+	faux_list_node_t *node = NULL;
+	faux_eloop_hook_t *hook = NULL;
+	bool_t stop = BOOL_FALSE;
 
-	entry = faux_zmalloc(sizeof(*entry));
-	if (!entry) {
-		sigdelset(&eloop->sig_set, signo);
-		sigaddset(&eloop->sig_mask, signo);
-		return BOOL_FALSE;
+	eloop->hooks_dispatching = hooks;
+	while ((hook = (faux_eloop_hook_t *)faux_list_each(&iter))) {
+		faux_eloop_info_hook_t info = {};
+		faux_eloop_cb_f *event_cb = NULL;
+
+		if (hook->deleted)
+			continue;
+		event_cb = hook->context.event_cb;
+		if (!event_cb)
+			event_cb = eloop->default_event_cb;
+		if (!event_cb) // Callback is not defined
+			continue;
+		info.hook_id = hook->hook_id;
+
+		// Execute callback
+		// BOOL_FALSE return value means "break the loop"
+		if (!faux_eloop_exec(eloop, event_cb, type, &info,
+			hook->context.user_data))
+			stop = BOOL_TRUE;
+	}
+	eloop->hooks_dispatching = NULL;
+	if (!eloop->hooks_deleted)
+		return stop;
+	eloop->hooks_deleted = BOOL_FALSE;
+
+	// Free hooks deleted by callbacks
+	iter = faux_list_head(hooks);
+	while ((node = faux_list_each_node(&iter))) {
+		hook = (faux_eloop_hook_t *)faux_list_data(node);
+		if (hook->deleted)
+			faux_list_del(hooks, node);
 	}
-	entry->signo = signo;
-	entry->set = BOOL_FALSE;
-	entry->context.event_cb = event_cb;
-	entry->context.user_data = user_data;
 
-	if (!faux_list_add(eloop->signals, entry)) {
-		faux_free(entry);
-		sigdelset(&eloop->sig_set, signo);
-		sigaddset(&eloop->sig_mask, signo);
-		return BOOL_FALSE;
+	return stop;
+}
+
+
+/** @brief Executes deferred callbacks.
+ *
+ * Only callbacks deferred before this call are executed. The callbacks
+ * deferred by them will be executed on the next iteration.
+ *
+ * @param [in] eloop Event loop object.
+ * @return BOOL_TRUE if some callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_deferred(faux_eloop_t *eloop)
+{
+	faux_eloop_task_t *task = eloop->defer_head;
+	bool_t stop = BOOL_FALSE;
+
+	eloop->defer_head = NULL;
+	eloop->defer_tail = NULL;
+
+	while (task) {
+		faux_eloop_task_t *next = task->next;
+		faux_eloop_context_t context = task->context;
+		faux_eloop_cb_f *event_cb = NULL;
+
+		faux_free(task);
+		task = next;
+		event_cb = context.event_cb;
+		if (!event_cb)
+			event_cb = eloop->default_event_cb;
+		if (!event_cb) // Callback is not defined
+			continue;
+
+		// Execute callback
+		// BOOL_FALSE return value means "break the loop"
+		if (!faux_eloop_exec(eloop, event_cb, FAUX_ELOOP_DEFER, NULL,
+			context.user_data))
+			stop = BOOL_TRUE;
 	}
 
-	if (eloop->working) { // Add signal on the fly
+	return stop;
+}
+
+
+/** @brief Executes callback for ready file descriptor.
+ *
+ * The service descriptors (timerfd, signalfd, wake up descriptor) are
+ * processed here too.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd Ready file descriptor.
+ * @param [in] revents Returned events (poll() format).
+ * @return BOOL_TRUE if callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_fd(faux_eloop_t *eloop, int fd,
+	short revents)
+{
+	faux_eloop_info_fd_t info = {};
+	faux_eloop_cb_f *event_cb = NULL;
+	faux_eloop_fd_t *entry = NULL;
+	bool_t stop = BOOL_FALSE;
+
+#ifdef HAVE_TIMERFD_CREATE
+	// Timer file descriptor means scheduled events
+	if (fd == eloop->timer_fd) {
+		uint64_t expirations = 0;
+
+		faux_read_block(fd, &expirations, sizeof(expirations));
+		// Expired timer must be re-armed anyway
+		eloop->timer_armed = BOOL_FALSE;
+		return faux_eloop_dispatch_scheds(eloop);
+	}
+#endif
+
 #ifdef HAVE_SIGNALFD
-		// Reattach signalfd handler with updated sig_set
-		eloop->signal_fd = signalfd(eloop->signal_fd, &eloop->sig_set,
-			SIGNALFD_FLAGS);
+	// Read special signal file descriptor
+	if (fd == eloop->signal_fd)
+		return faux_eloop_dispatch_signalfd(eloop);
+#endif
 
-#else // Standard signals
-		struct sigaction sig_act = {};
-		sig_act.sa_flags = 0;
-		sig_act.sa_mask = eloop->sig_set;
-		sig_act.sa_handler = &faux_eloop_static_sighandler;
-		sigaction(signo, &sig_act, &entry->oldact);
+	// Wake up descriptor means posted tasks
+	if (fd == eloop->wake_fd[0])
+		return faux_eloop_dispatch_tasks(eloop);
+
+	// Prepare event data. The descriptor can be already removed by
+	// previous callback within the same iteration.
+	entry = faux_eloop_fd_entry(eloop, fd);
+	if (!entry)
+		return BOOL_FALSE;
+	event_cb = entry->context.event_cb;
+	if (!event_cb)
+		event_cb = eloop->default_event_cb;
+	if (!event_cb) // Callback function is not defined for this event
+		return BOOL_FALSE;
+	info.fd = fd;
+	info.revents = revents;
+
+	// Execute callback
+	// BOOL_FALSE return value means "break the loop"
+	if (!faux_eloop_exec(eloop, event_cb, FAUX_ELOOP_FD, &info,
+		entry->context.user_data))
+		stop = BOOL_TRUE;
+
+	// The entry can be removed by callback
+	if (eloop->stats && (entry = faux_eloop_fd_entry(eloop, fd))) {
+		entry->stats.calls++;
+		entry->stats.cb_time += eloop->last_cb_time;
+		if (eloop->last_cb_time > entry->stats.cb_max)
+			entry->stats.cb_max = eloop->last_cb_time;
+	}
+
+	return stop;
+}
+
+
+#ifdef HAVE_EPOLL_CREATE1
+/** @brief Waits for events by epoll backend.
+ *
+ * The descriptors unsupported by epoll are always ready. So loop doesn't
+ * block while they are registered. They are checked by ppoll() without
+ * waiting and are appended to the epoll events. The half of events array
+ * at most is used for them.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] timeout Timeout. NULL for infinite waiting.
+ * @param [in] sigmask Signal mask to set while waiting.
+ * @return Number of ready descriptors, 0 on timeout, < 0 on error.
+ */
+static int faux_eloop_epoll_wait(faux_eloop_t *eloop,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+	int timeout_ms = -1;
+	int max_events = FAUX_ELOOP_EPOLL_EVENTS;
+	size_t plen = faux_pollfd_len(eloop->pollfds);
+	struct timespec zero = {};
+	int sn = 0;
+	int i = 0;
+
+	// Round up to don't wake up before event
+	if (timeout) {
+		if (timeout->tv_sec >= INT_MAX / 1000)
+			timeout_ms = INT_MAX;
+		else
+			timeout_ms = timeout->tv_sec * 1000 +
+				(timeout->tv_nsec + 999999) / 1000000;
+	}
+	if (plen > 0) {
+		timeout_ms = 0;
+		max_events -= (plen < (FAUX_ELOOP_EPOLL_EVENTS / 2)) ?
+			plen : (FAUX_ELOOP_EPOLL_EVENTS / 2);
+	}
+
+	sn = epoll_pwait(eloop->epoll_fd, eloop->epoll_events,
+		max_events, timeout_ms, sigmask);
+	if ((sn < 0) || (0 == plen))
+		return sn;
+
+	if (ppoll(faux_pollfd_vector(eloop->pollfds), plen, &zero, NULL) <= 0)
+		return sn;
+	for (i = 0; (i < (int)plen) && (sn < FAUX_ELOOP_EPOLL_EVENTS); i++) {
+		struct pollfd *pfd = faux_pollfd_item(eloop->pollfds, i);
+		struct epoll_event *ev = &eloop->epoll_events[sn];
+
+		if (0 == pfd->revents)
+			continue;
+		ev->events = faux_eloop_poll_to_epoll(pfd->revents);
+		if (pfd->revents & POLLERR)
+			ev->events |= EPOLLERR;
+		if (pfd->revents & POLLHUP)
+			ev->events |= EPOLLHUP;
+		ev->data.fd = pfd->fd;
+		pfd->revents = 0;
+		sn++;
+	}
+
+	return sn;
+}
+#endif
+
+
+/** @brief Waits for events by loop backend.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] timeout Timeout. NULL for infinite waiting.
+ * @param [in] sigmask Signal mask to set while waiting.
+ * @return Number of ready descriptors, 0 on timeout, < 0 on error.
+ */
+static int faux_eloop_wait(faux_eloop_t *eloop,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0)
+		return faux_eloop_epoll_wait(eloop, timeout, sigmask);
+#endif
+
+	return ppoll(faux_pollfd_vector(eloop->pollfds),
+		faux_pollfd_len(eloop->pollfds), timeout, sigmask);
+}
+
+
+/** @brief Checks if descriptor is service one.
+ *
+ * The service descriptors (timerfd, signalfd, wake up descriptor) are
+ * not limited by dispatch budget.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @return BOOL_TRUE if descriptor is service one.
+ */
+static bool_t faux_eloop_is_service_fd(const faux_eloop_t *eloop, int fd)
+{
+#ifdef HAVE_TIMERFD_CREATE
+	if (fd == eloop->timer_fd)
+		return BOOL_TRUE;
+#endif
+#ifdef HAVE_SIGNALFD
+	if (fd == eloop->signal_fd)
+		return BOOL_TRUE;
 #endif
+	if (fd == eloop->wake_fd[0])
+		return BOOL_TRUE;
+
+	return BOOL_FALSE;
+}
+
+
+/** @brief Checks if dispatch budget of iteration is exhausted.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] dispatched Number of dispatched user descriptors.
+ * @param [in] start Time when dispatching of descriptors was started.
+ * @return BOOL_TRUE if budget is exhausted.
+ */
+static bool_t faux_eloop_budget_exhausted(const faux_eloop_t *eloop,
+	unsigned int dispatched, faux_nsec_t start)
+{
+	if ((eloop->budget_events != 0) && (dispatched >= eloop->budget_events))
+		return BOOL_TRUE;
+	if ((eloop->budget_time != 0) && (dispatched != 0) &&
+		((faux_nsec_now_monotonic() - start) >= eloop->budget_time))
+		return BOOL_TRUE;
+
+	return BOOL_FALSE;
+}
+
+
+/** @brief Gets ready descriptor by index within backend's result.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] index Index within backend's result.
+ * @param [out] fd Ready descriptor.
+ * @param [out] revents Returned events (poll() format).
+ * @return BOOL_TRUE if item is ready and it's not dispatched yet.
+ */
+static bool_t faux_eloop_ready_fd(faux_eloop_t *eloop, unsigned int index,
+	int *fd, short *revents)
+{
+	struct pollfd *pollfd = NULL;
+
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0) {
+		struct epoll_event *ev = &eloop->epoll_events[index];
+		if (0 == ev->events)
+			return BOOL_FALSE;
+		*fd = ev->data.fd;
+		*revents = faux_eloop_epoll_to_poll(ev->events);
+		return BOOL_TRUE;
 	}
+#endif
+	pollfd = faux_pollfd_item(eloop->pollfds, index);
+	if (!pollfd || (0 == pollfd->revents))
+		return BOOL_FALSE;
+	*fd = pollfd->fd;
+	*revents = pollfd->revents;
 
 	return BOOL_TRUE;
 }
 
 
-bool_t faux_eloop_del_signal(faux_eloop_t *eloop, int signo)
+/** @brief Marks item of backend's result as dispatched.
+ *
+ * Vector of ppoll() backend can be changed by callbacks. Removed item is
+ * replaced by the last one so item must be marked before dispatching to
+ * don't dispatch the same item twice.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] index Index within backend's result.
+ */
+static void faux_eloop_ready_fd_done(faux_eloop_t *eloop, unsigned int index)
 {
-	if (!eloop || (signo < 0))
+	struct pollfd *pollfd = NULL;
+
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0) {
+		eloop->epoll_events[index].events = 0;
+		return;
+	}
+#endif
+	pollfd = faux_pollfd_item(eloop->pollfds, index);
+	if (pollfd)
+		pollfd->revents = 0;
+}
+
+
+/** @brief Appends skipped descriptor to the pending queue.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] entry Skipped descriptor.
+ */
+static void faux_eloop_pending_add(faux_eloop_t *eloop, faux_eloop_fd_t *entry)
+{
+	if (entry->skipped)
+		return;
+
+	// Enlarge queue
+	if (eloop->pending_len == eloop->pending_size) {
+		size_t new_size = eloop->pending_size * 2;
+		int *new_pending = NULL;
+
+		if (new_size < FAUX_ELOOP_FDS_CHUNK)
+			new_size = FAUX_ELOOP_FDS_CHUNK;
+		new_pending = realloc(eloop->pending,
+			new_size * sizeof(*new_pending));
+		assert(new_pending);
+		if (!new_pending) // Descriptor loses its priority only
+			return;
+		eloop->pending = new_pending;
+		eloop->pending_size = new_size;
+	}
+
+	eloop->pending[eloop->pending_len++] = entry->fd;
+	entry->skipped = BOOL_TRUE;
+}
+
+
+/** @brief Executes callbacks for ready file descriptors.
+ *
+ * If dispatch budget is set then the rest of ready descriptors are skipped
+ * when budget is exhausted. The skipped descriptors are queued. The queued
+ * descriptors are dispatched before others in the order they were skipped
+ * when they are reported by backend again. The backends are level
+ * triggered so skipped descriptors will be reported again. Note the epoll
+ * backend gets limited number of events per call. So if there are more
+ * ready descriptors then skipped descriptor can be reported by one of
+ * the later iterations. It keeps its place within queue then.
+ *
+ * The rest of descriptors are dispatched starting from rotating position
+ * so the descriptors at the beginning of vector have no priority. The
+ * service descriptors are dispatched first and they are never skipped.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] sn Number of ready descriptors got by backend.
+ * @return BOOL_TRUE if some callback asked to stop the loop.
+ */
+static bool_t faux_eloop_dispatch_fds(faux_eloop_t *eloop, int sn)
+{
+	bool_t stop = BOOL_FALSE;
+	bool_t exhausted = BOOL_FALSE;
+	unsigned int dispatched = 0;
+	unsigned int num = sn;
+	unsigned int first = eloop->dispatch_start++;
+	uint64_t iter = ++eloop->dispatch_iter;
+	faux_nsec_t start = 0;
+	size_t pending_len = 0;
+	size_t i = 0;
+
+	if (0 == sn)
 		return BOOL_FALSE;
 
-	if (sigismember(&eloop->sig_set, signo) != 1)
-		return BOOL_FALSE; // Doesn't exist
+	// Ppoll backend returns the whole vector
+	if (faux_eloop_backend(eloop) == FAUX_ELOOP_BACKEND_PPOLL)
+		num = faux_pollfd_len(eloop->pollfds);
+	if (0 == num)
+		return BOOL_FALSE;
+	first %= num;
+
+	// Service descriptors (timerfd, signalfd, wake up descriptor) are not
+	// limited by budget. They go first and their time isn't charged
+	// against budget.
+	for (i = 0; i < num; i++) {
+		int fd = -1;
+		short revents = 0;
+
+		if (!faux_eloop_ready_fd(eloop, i, &fd, &revents))
+			continue;
+		if (!faux_eloop_is_service_fd(eloop, fd))
+			continue;
+		faux_eloop_ready_fd_done(eloop, i);
+		if (faux_eloop_dispatch_fd(eloop, fd, revents))
+			stop = BOOL_TRUE;
+	}
+	if (eloop->budget_time != 0)
+		start = faux_nsec_now_monotonic();
+
+	// Mark ready descriptors. The callbacks can change ppoll() vector so
+	// the ready state is kept within descriptor entry.
+	for (i = 0; i < num; i++) {
+		faux_eloop_fd_t *entry = NULL;
+		int fd = -1;
+		short revents = 0;
+
+		if (!faux_eloop_ready_fd(eloop, i, &fd, &revents))
+			continue;
+		if (!(entry = faux_eloop_fd_entry(eloop, fd)))
+			continue;
+		entry->ready_iter = iter;
+		entry->revents = revents;
+	}
 
-	sigdelset(&eloop->sig_set, signo);
-	sigaddset(&eloop->sig_mask, signo);
+	// Ready descriptors skipped by previous iterations go first. The
+	// queue is compacted in place. Stale items (removed or dispatched
+	// descriptors) are dropped.
+	for (i = 0; i < eloop->pending_len; i++) {
+		int fd = eloop->pending[i];
+		faux_eloop_fd_t *entry = faux_eloop_fd_entry(eloop, fd);
+
+		if (!entry || !entry->skipped)
+			continue;
+		if (entry->ready_iter != iter) { // Not reported now
+			eloop->pending[pending_len++] = fd;
+			continue;
+		}
+		if (!exhausted)
+			exhausted = faux_eloop_budget_exhausted(eloop,
+				dispatched, start);
+		if (exhausted) {
+			eloop->pending[pending_len++] = fd;
+			continue;
+		}
+		entry->skipped = BOOL_FALSE;
+		entry->ready_iter = 0;
+		dispatched++;
+		if (faux_eloop_dispatch_fd(eloop, fd, entry->revents))
+			stop = BOOL_TRUE;
+	}
+	eloop->pending_len = pending_len;
+
+	// The rest of ready descriptors
+	for (i = 0; i < num; i++) {
+		unsigned int index = (first + i) % num;
+		faux_eloop_fd_t *entry = NULL;
+		int fd = -1;
+		short revents = 0;
+
+		if (!faux_eloop_ready_fd(eloop, index, &fd, &revents))
+			continue;
+		faux_eloop_ready_fd_done(eloop, index);
+
+		// Descriptor is dispatched already or it's removed or it's
+		// re-registered by callback
+		entry = faux_eloop_fd_entry(eloop, fd);
+		if (!entry || (entry->ready_iter != iter))
+			continue;
+		entry->ready_iter = 0;
+		if (!exhausted)
+			exhausted = faux_eloop_budget_exhausted(eloop,
+				dispatched, start);
+		if (exhausted) {
+			faux_eloop_pending_add(eloop, entry);
+			continue;
+		}
+		dispatched++;
+		if (faux_eloop_dispatch_fd(eloop, fd, revents))
+			stop = BOOL_TRUE;
+	}
+
+	if (exhausted && eloop->stats)
+		eloop->stats->budget_exhausted++;
+
+	return stop;
+}
+
+bool_t faux_eloop_loop(faux_eloop_t *eloop)
+{
+	bool_t retval = BOOL_TRUE;
+	bool_t stop = BOOL_FALSE;
+	sigset_t blocked_signals;
+	sigset_t orig_sig_set;
+	sigset_t *sigset_for_ppoll = NULL;
+
+	// If event loop is active already and we try to start nested loop
+	// then return.
+	if (eloop->working)
+		return BOOL_FALSE;
+	eloop->working = BOOL_TRUE;
+
+	// Block signals to prevent race conditions while loop and ppoll()
+	// Catch signals while ppoll() only
+	sigfillset(&blocked_signals);
+	setsigmask(SIG_SETMASK, &blocked_signals, &orig_sig_set);
+
+#ifdef HAVE_TIMERFD_CREATE
+	// Create Linux-specific timer file descriptor. The scheduler uses
+	// CLOCK_MONOTONIC. If timerfd is unavailable the ppoll() timeout will
+	// be used.
+	eloop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TIMERFD_FLAGS);
+	eloop->timer_armed = BOOL_FALSE;
+	if ((eloop->timer_fd >= 0) &&
+		!faux_eloop_watch_fd(eloop, eloop->timer_fd, POLLIN)) {
+		close(eloop->timer_fd);
+		eloop->timer_fd = -1;
+	}
+#endif
 
-	if (eloop->working) { // Del signal on the fly
 #ifdef HAVE_SIGNALFD
-		// Reattach signalfd handler with updated sig_set
-		eloop->signal_fd = signalfd(eloop->signal_fd, &eloop->sig_set,
-			SIGNALFD_FLAGS);
+	// Create Linux-specific signal file descriptor. Wait for all signals.
+	// Unneeded signals will be filtered out later.
+	eloop->signal_fd = signalfd(eloop->signal_fd, &eloop->sig_set,
+		SIGNALFD_FLAGS);
+	faux_eloop_watch_fd(eloop, eloop->signal_fd, POLLIN);
 
-#else // Standard signals
-		faux_eloop_signal_t *sig = faux_list_kfind(eloop->signals, &signo);
-		sigaction(signo, &sig->oldact, NULL);
+#else // Standard signal processing
+	sigset_for_ppoll = &eloop->sig_mask;
+
+	// Signal handlers are process-wide. So only the loop with registered
+	// signals owns them. It allows to run other loops within threads.
+	if (faux_list_len(eloop->signals) != 0) {
+		faux_list_node_t *iter = faux_list_head(eloop->signals);
+		faux_eloop_signal_t *sig = NULL;
+		struct sigaction sig_act = {};
+
+		faux_eloop_static_user_data = eloop->signals;
+
+		sig_act.sa_flags = 0;
+		sig_act.sa_mask = eloop->sig_set;
+		sig_act.sa_handler = &faux_eloop_static_sighandler;
+		while ((sig = (faux_eloop_signal_t *)faux_list_each(&iter))) {
+			sig->set = BOOL_FALSE;
+			sigaction(sig->signo, &sig_act, &sig->oldact);
+		}
+	}
+#endif
+
+	// Wake up descriptor for posted tasks. The tasks posted before loop start
+	// will be executed on the first iteration.
+	if (eloop->wake_fd[0] >= 0)
+		faux_eloop_watch_fd(eloop, eloop->wake_fd[0], POLLIN);
+
+	// Main loop
+	while (!stop) {
+		int sn = 0;
+		struct timespec *timeout = NULL;
+		struct timespec next_interval = {};
+		bool_t use_timeout = BOOL_TRUE;
+		faux_nsec_t wait_start = 0;
+
+		// Prepare hooks can register events or defer callbacks
+		if (faux_eloop_dispatch_hooks(eloop, FAUX_ELOOP_PREPARE)) {
+			stop = BOOL_TRUE;
+			break;
+		}
+
+#ifdef HAVE_TIMERFD_CREATE
+		if ((eloop->timer_fd >= 0) && (faux_eloop_timer_arm(eloop) == 0))
+			use_timeout = BOOL_FALSE;
+#endif
+		// Find out next scheduled interval
+		if (use_timeout && (faux_sched_next_interval(eloop->faux_sched,
+			&next_interval) == 0))
+			timeout = &next_interval;
+		// Don't block if there is some work to do at the end of
+		// iteration
+		if (eloop->defer_head || (faux_list_len(eloop->idle_hooks) > 0)) {
+			next_interval.tv_sec = 0;
+			next_interval.tv_nsec = 0;
+			timeout = &next_interval;
+		}
+
+		// Wait for events
+		if (eloop->stats)
+			wait_start = faux_nsec_now_monotonic();
+		sn = faux_eloop_wait(eloop, timeout, sigset_for_ppoll);
+
+		if ((sn < 0) && (errno != EINTR)) {
+			retval = BOOL_FALSE;
+			break;
+		}
+
+		// Read loop time once. All the deadline checks within this
+		// iteration use it.
+		eloop->now = faux_nsec_now_monotonic();
+		if (eloop->stats) {
+			eloop->stats->wait_time += eloop->now - wait_start;
+			eloop->iter_events = 0;
+		}
+
+#ifndef HAVE_SIGNALFD // Standard signals
+		// Signals
+		if ((sn < 0) && (EINTR == errno)) {
+			faux_list_node_t *iter = faux_list_head(eloop->signals);
+			faux_eloop_signal_t *sig = NULL;
+			while ((sig = (faux_eloop_signal_t *)faux_list_each(&iter))) {
+				faux_eloop_info_signal_t sinfo = {};
+				faux_eloop_cb_f *event_cb = NULL;
+				bool_t r = BOOL_TRUE;
+
+				if (BOOL_FALSE == sig->set)
+					continue;
+				sig->set = BOOL_FALSE;
+
+				event_cb = sig->context.event_cb;
+				if (!event_cb)
+					event_cb = eloop->default_event_cb;
+				if (!event_cb) // Callback is not defined
+					continue;
+				sinfo.signo = sig->signo;
+
+				// Execute callback
+				r = faux_eloop_exec(eloop, event_cb, FAUX_ELOOP_SIGNAL, &sinfo,
+					sig->context.user_data);
+				// BOOL_FALSE return value means "break the loop"
+				if (!r)
+					stop = BOOL_TRUE;
+			}
+		}
+#endif
+
+		// Scheduled events. The timerfd will be processed later.
+		if (use_timeout && faux_eloop_dispatch_scheds(eloop))
+			stop = BOOL_TRUE;
+
+		// File descriptors
+		if ((sn > 0) && faux_eloop_dispatch_fds(eloop, sn))
+			stop = BOOL_TRUE;
+
+		// End of iteration. Deferred callbacks go first so check hooks
+		// see the results of them.
+		if (eloop->defer_head && faux_eloop_dispatch_deferred(eloop))
+			stop = BOOL_TRUE;
+		if (faux_eloop_dispatch_hooks(eloop, FAUX_ELOOP_CHECK))
+			stop = BOOL_TRUE;
+		if ((0 == sn) && faux_eloop_dispatch_hooks(eloop, FAUX_ELOOP_IDLE))
+			stop = BOOL_TRUE;
+		// Another thread asked to stop the loop
+		if (__atomic_exchange_n(&eloop->stop_requested, BOOL_FALSE,
+			__ATOMIC_SEQ_CST))
+			stop = BOOL_TRUE;
+
+		if (eloop->stats) {
+			eloop->stats->iterations++;
+			if (sn != 0)
+				eloop->stats->wakeups++;
+			eloop->stats->events_hist[faux_eloop_hist_bucket(
+				eloop->iter_events)]++;
+			if (faux_eloop_export_stats(eloop))
+				stop = BOOL_TRUE;
+		}
+
+	} // Loop end
+
+	if (eloop->wake_fd[0] >= 0)
+		faux_eloop_unwatch_fd(eloop, eloop->wake_fd[0]);
+
+#ifdef HAVE_TIMERFD_CREATE
+	// Close timer file descriptor
+	if (eloop->timer_fd >= 0) {
+		faux_eloop_unwatch_fd(eloop, eloop->timer_fd);
+		close(eloop->timer_fd);
+	}
+	eloop->timer_fd = -1;
+	eloop->timer_armed = BOOL_FALSE;
 #endif
+
+#ifdef HAVE_SIGNALFD
+	// Close signal file descriptor
+	faux_eloop_unwatch_fd(eloop, eloop->signal_fd);
+	close(eloop->signal_fd);
+	eloop->signal_fd = -1;
+
+#else // Standard signals. Restore signal handlers
+	if (faux_list_len(eloop->signals) != 0) {
+		faux_list_node_t *iter = faux_list_head(eloop->signals);
+		faux_eloop_signal_t *sig = NULL;
+
+		while ((sig = (faux_eloop_signal_t *)faux_list_each(&iter))) {
+			sig->set = BOOL_FALSE;
+			sigaction(sig->signo, &sig->oldact, NULL);
+		}
 	}
+#endif
 
-	faux_list_kdel(eloop->signals, &signo);
+	// Unblock signals
+	setsigmask(SIG_SETMASK, &orig_sig_set, NULL);
+
+	// Deactivate loop flag
+	eloop->working = BOOL_FALSE;
+
+	return retval;
+}
+
+
+bool_t faux_eloop_add_fd(faux_eloop_t *eloop, int fd, short events,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_fd_t *entry = NULL;
+
+	if (!eloop || (fd < 0))
+		return BOOL_FALSE;
+	if (faux_eloop_fd_entry(eloop, fd)) // Already registered
+		return BOOL_FALSE;
+
+	// Enlarge descriptors array
+	if ((size_t)fd >= eloop->fds_size) {
+		size_t new_size = eloop->fds_size * 2;
+		faux_eloop_fd_t **new_fds = NULL;
+
+		if (new_size < FAUX_ELOOP_FDS_CHUNK)
+			new_size = FAUX_ELOOP_FDS_CHUNK;
+		if (new_size <= (size_t)fd)
+			new_size = fd + 1;
+		new_fds = realloc(eloop->fds, new_size * sizeof(*new_fds));
+		assert(new_fds);
+		if (!new_fds)
+			return BOOL_FALSE;
+		memset(new_fds + eloop->fds_size, 0,
+			(new_size - eloop->fds_size) * sizeof(*new_fds));
+		eloop->fds = new_fds;
+		eloop->fds_size = new_size;
+	}
+
+	entry = faux_zmalloc(sizeof(*entry));
+	if (!entry)
+		return BOOL_FALSE;
+	entry->fd = fd;
+	entry->events = events;
+	entry->context.event_cb = event_cb;
+	entry->context.user_data = user_data;
+
+	if (!faux_eloop_watch_fd(eloop, entry->fd, entry->events)) {
+		faux_free(entry);
+		return BOOL_FALSE;
+	}
+	eloop->fds[fd] = entry;
+
+	return BOOL_TRUE;
+}
+
+
+bool_t faux_eloop_del_fd(faux_eloop_t *eloop, int fd)
+{
+	faux_eloop_fd_t *entry = NULL;
+
+	if (!eloop || (fd < 0))
+		return BOOL_FALSE;
+
+	entry = faux_eloop_fd_entry(eloop, fd);
+	if (!entry)
+		return BOOL_FALSE;
+	eloop->fds[fd] = NULL;
+	faux_free(entry);
+
+	if (!faux_eloop_unwatch_fd(eloop, fd))
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Changes events to watch for registered file descriptor.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @param [in] events New events to watch for (poll() format).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+static bool_t faux_eloop_set_fd_events(faux_eloop_t *eloop, int fd,
+	short events)
+{
+	faux_eloop_fd_t *entry = NULL;
+
+	if (!eloop || (fd < 0))
+		return BOOL_FALSE;
+	entry = faux_eloop_fd_entry(eloop, fd);
+	if (!entry)
+		return BOOL_FALSE;
+	if (entry->events == events) // Nothing to change
+		return BOOL_TRUE;
+	if (!faux_eloop_rewatch_fd(eloop, fd, events))
+		return BOOL_FALSE;
+	entry->events = events;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Adds events to watch for registered file descriptor.
+ *
+ * It's usually used to watch for POLLOUT while output queue is not empty.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @param [in] events Events to add (poll() format).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_include_fd_event(faux_eloop_t *eloop, int fd, short events)
+{
+	faux_eloop_fd_t *entry = NULL;
+
+	if (!eloop || (fd < 0))
+		return BOOL_FALSE;
+	entry = faux_eloop_fd_entry(eloop, fd);
+	if (!entry)
+		return BOOL_FALSE;
+
+	return faux_eloop_set_fd_events(eloop, fd, entry->events | events);
+}
+
+
+/** @brief Removes events to watch for registered file descriptor.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @param [in] events Events to remove (poll() format).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_exclude_fd_event(faux_eloop_t *eloop, int fd, short events)
+{
+	faux_eloop_fd_t *entry = NULL;
+
+	if (!eloop || (fd < 0))
+		return BOOL_FALSE;
+	entry = faux_eloop_fd_entry(eloop, fd);
+	if (!entry)
+		return BOOL_FALSE;
+
+	return faux_eloop_set_fd_events(eloop, fd, entry->events & ~events);
+}
+
+
+/** @brief Returns actual backend of event loop.
+ *
+ * @param [in] eloop Event loop object.
+ * @return Backend.
+ */
+faux_eloop_backend_e faux_eloop_backend(const faux_eloop_t *eloop)
+{
+	if (!eloop)
+		return FAUX_ELOOP_BACKEND_AUTO;
+
+#ifdef HAVE_EPOLL_CREATE1
+	if (eloop->epoll_fd >= 0)
+		return FAUX_ELOOP_BACKEND_EPOLL;
+#endif
+
+	return FAUX_ELOOP_BACKEND_PPOLL;
+}
+
+
+bool_t faux_eloop_add_signal(faux_eloop_t *eloop, int signo,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_signal_t *entry = NULL;
+
+	if (!eloop || (signo < 0))
+		return BOOL_FALSE;
+
+	// Signal handling is process-wide. The worker loops of group block
+	// all signals so only the main loop can handle them.
+	if (eloop->worker)
+		return BOOL_FALSE;
+
+	if (sigismember(&eloop->sig_set, signo) == 1)
+		return BOOL_FALSE; // Already exists
+
+	// Firstly try to add signal to sigset. Library function will validate
+	// signal number value.
+	if (sigaddset(&eloop->sig_set, signo) < 0)
+		return BOOL_FALSE; // Invalid signal number
+	sigdelset(&eloop->sig_mask, signo);
+
+	entry = faux_zmalloc(sizeof(*entry));
+	if (!entry) {
+		sigdelset(&eloop->sig_set, signo);
+		sigaddset(&eloop->sig_mask, signo);
+		return BOOL_FALSE;
+	}
+	entry->signo = signo;
+	entry->set = BOOL_FALSE;
+	entry->context.event_cb = event_cb;
+	entry->context.user_data = user_data;
+
+	if (!faux_list_add(eloop->signals, entry)) {
+		faux_free(entry);
+		sigdelset(&eloop->sig_set, signo);
+		sigaddset(&eloop->sig_mask, signo);
+		return BOOL_FALSE;
+	}
+
+	if (eloop->working) { // Add signal on the fly
+#ifdef HAVE_SIGNALFD
+		// Reattach signalfd handler with updated sig_set
+		eloop->signal_fd = signalfd(eloop->signal_fd, &eloop->sig_set,
+			SIGNALFD_FLAGS);
+
+#else // Standard signals
+		struct sigaction sig_act = {};
+		sig_act.sa_flags = 0;
+		sig_act.sa_mask = eloop->sig_set;
+		sig_act.sa_handler = &faux_eloop_static_sighandler;
+		sigaction(signo, &sig_act, &entry->oldact);
+#endif
+	}
+
+	return BOOL_TRUE;
+}
+
+
+bool_t faux_eloop_del_signal(faux_eloop_t *eloop, int signo)
+{
+	if (!eloop || (signo < 0))
+		return BOOL_FALSE;
+
+	if (sigismember(&eloop->sig_set, signo) != 1)
+		return BOOL_FALSE; // Doesn't exist
+
+	sigdelset(&eloop->sig_set, signo);
+	sigaddset(&eloop->sig_mask, signo);
+
+	if (eloop->working) { // Del signal on the fly
+#ifdef HAVE_SIGNALFD
+		// Reattach signalfd handler with updated sig_set
+		eloop->signal_fd = signalfd(eloop->signal_fd, &eloop->sig_set,
+			SIGNALFD_FLAGS);
+
+#else // Standard signals
+		faux_eloop_signal_t *sig = faux_list_kfind(eloop->signals, &signo);
+		sigaction(signo, &sig->oldact, NULL);
+#endif
+	}
+
+	faux_list_kdel(eloop->signals, &signo);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Internal function to register scheduled event.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] ev_id Event ID. Must be unique within event loop.
+ * @param [in] event_cb Callback function.
+ * @param [in] user_data User data for callback function.
+ * @param [in] cycle_num Number of cycles.
+ * @return Registered entry or NULL on error.
+ */
+static faux_eloop_sched_t *faux_eloop_new_sched(faux_eloop_t *eloop,
+	int ev_id, faux_eloop_cb_f *event_cb, void *user_data,
+	unsigned int cycle_num)
+{
+	faux_eloop_sched_t *entry = NULL;
+
+	if (!eloop || (0 == cycle_num))
+		return NULL;
+
+	entry = faux_zmalloc(sizeof(*entry));
+	if (!entry)
+		return NULL;
+	entry->ev_id = ev_id;
+	entry->cycle_num = cycle_num;
+	entry->context.event_cb = event_cb;
+	entry->context.user_data = user_data;
+
+	if (!faux_list_add(eloop->scheds, entry)) { // ID already exists
+		faux_free(entry);
+		return NULL;
+	}
+
+	return entry;
+}
+
+
+/** @brief Schedules one-time event using absolute time.
+ *
+ * The event ID must be unique within event loop. The registration is
+ * removed automatically after the event or by faux_eloop_del_sched().
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] time Absolute CLOCK_MONOTONIC time of event (FAUX_SCHED_NOW
+ *   for now).
+ * @param [in] ev_id Event ID.
+ * @param [in] event_cb Callback function. NULL for default callback.
+ * @param [in] user_data User data for callback function.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_add_sched_once(faux_eloop_t *eloop,
+	const struct timespec *time, int ev_id,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_sched_t *entry = NULL;
+
+	entry = faux_eloop_new_sched(eloop, ev_id, event_cb, user_data, 1);
+	if (!entry)
+		return BOOL_FALSE;
+
+	entry->ev = faux_sched_once(eloop->faux_sched, time, ev_id, entry);
+	if (!entry->ev) {
+		faux_list_kdel(eloop->scheds, &ev_id);
+		return BOOL_FALSE;
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Schedules one-time event using interval from now.
+ *
+ * @sa faux_eloop_add_sched_once()
+ */
+bool_t faux_eloop_add_sched_once_delayed(faux_eloop_t *eloop,
+	const struct timespec *interval, int ev_id,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_sched_t *entry = NULL;
+
+	entry = faux_eloop_new_sched(eloop, ev_id, event_cb, user_data, 1);
+	if (!entry)
+		return BOOL_FALSE;
+
+	entry->ev = faux_sched_once_delayed(eloop->faux_sched, interval,
+		ev_id, entry);
+	if (!entry->ev) {
+		faux_list_kdel(eloop->scheds, &ev_id);
+		return BOOL_FALSE;
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Schedules periodic event using absolute time for first one.
+ *
+ * The registration is removed automatically after the last cycle or by
+ * faux_eloop_del_sched().
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] time Absolute CLOCK_MONOTONIC time of first event.
+ * @param [in] ev_id Event ID.
+ * @param [in] event_cb Callback function. NULL for default callback.
+ * @param [in] user_data User data for callback function.
+ * @param [in] period Period of periodic event.
+ * @param [in] cycle_num Number of cycles (FAUX_SCHED_INFINITE for infinite).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_add_sched_periodic(faux_eloop_t *eloop,
+	const struct timespec *time, int ev_id,
+	faux_eloop_cb_f *event_cb, void *user_data,
+	const struct timespec *period, unsigned int cycle_num)
+{
+	faux_eloop_sched_t *entry = NULL;
+
+	entry = faux_eloop_new_sched(eloop, ev_id, event_cb, user_data,
+		cycle_num);
+	if (!entry)
+		return BOOL_FALSE;
+
+	entry->ev = faux_sched_periodic(eloop->faux_sched, time, ev_id, entry,
+		period, cycle_num);
+	if (!entry->ev) {
+		faux_list_kdel(eloop->scheds, &ev_id);
+		return BOOL_FALSE;
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Schedules periodic event using period for first one.
+ *
+ * @sa faux_eloop_add_sched_periodic()
+ */
+bool_t faux_eloop_add_sched_periodic_delayed(faux_eloop_t *eloop,
+	int ev_id, faux_eloop_cb_f *event_cb, void *user_data,
+	const struct timespec *period, unsigned int cycle_num)
+{
+	faux_eloop_sched_t *entry = NULL;
+
+	entry = faux_eloop_new_sched(eloop, ev_id, event_cb, user_data,
+		cycle_num);
+	if (!entry)
+		return BOOL_FALSE;
+
+	entry->ev = faux_sched_periodic_delayed(eloop->faux_sched, ev_id, entry,
+		period, cycle_num);
+	if (!entry->ev) {
+		faux_list_kdel(eloop->scheds, &ev_id);
+		return BOOL_FALSE;
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Removes scheduled event.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] ev_id Event ID.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_del_sched(faux_eloop_t *eloop, int ev_id)
+{
+	faux_eloop_sched_t *entry = NULL;
+
+	if (!eloop)
+		return BOOL_FALSE;
+
+	entry = (faux_eloop_sched_t *)faux_list_kfind(eloop->scheds, &ev_id);
+	if (!entry)
+		return BOOL_FALSE;
+	faux_sched_del(eloop->faux_sched, entry->ev);
+	faux_list_kdel(eloop->scheds, &ev_id);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Sets slack of scheduled event.
+ *
+ * The event can be delayed within slack to be handled together with
+ * another events. So the number of loop wakeups is reduced. The slack
+ * is kept for all cycles of periodic event.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] ev_id Event ID.
+ * @param [in] slack Slack value (NULL for no slack).
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_set_sched_slack(faux_eloop_t *eloop, int ev_id,
+	const struct timespec *slack)
+{
+	if (!eloop)
+		return BOOL_FALSE;
+
+	if (faux_sched_set_slack(eloop->faux_sched, ev_id, slack) <= 0)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Returns number of loop wakeups saved by events slack.
+ *
+ * @param [in] eloop Event loop object.
+ * @return Number of saved wakeups.
+ */
+uint64_t faux_eloop_sched_wakeups_saved(const faux_eloop_t *eloop)
+{
+	if (!eloop)
+		return 0;
+
+	return faux_sched_wakeups_saved(eloop->faux_sched);
+}
+
+
+/** @brief Returns cached loop time.
+ *
+ * The loop time is CLOCK_MONOTONIC time read once per loop iteration
+ * after waiting for events. It's cheaper than reading the clock within
+ * callbacks and it's the same time used to dispatch scheduled events. If
+ * the loop is not active the clock is read.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [out] now Loop time.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_now(const faux_eloop_t *eloop, struct timespec *now)
+{
+	if (!eloop || !now)
+		return BOOL_FALSE;
+
+	if (!eloop->working) {
+		faux_timespec_now_monotonic(now);
+		return BOOL_TRUE;
+	}
+	faux_nsec_to_timespec(now, eloop->now);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Posts task to event loop.
+ *
+ * The function is thread-safe. So any thread can pass work to the thread
+ * running event loop. The callback will be executed within loop thread
+ * with FAUX_ELOOP_TASK event type and NULL associated data. Tasks are
+ * executed in order of posting. The BOOL_FALSE returned by callback breaks
+ * the loop.
+ *
+ * The queue is lock-free. The loop is woken up by the first task posted
+ * after previous queue draining only. So a number of posts costs single
+ * write() syscall.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] event_cb Callback function. NULL for default callback.
+ * @param [in] user_data User data for callback function.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_post(faux_eloop_t *eloop,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_task_t *task = NULL;
+	faux_eloop_task_t *head = NULL;
+#ifdef HAVE_EVENTFD
+	uint64_t inc = 1;
+#else
+	char inc = 0;
+#endif
+
+	assert(eloop);
+	if (!eloop)
+		return BOOL_FALSE;
+	if (eloop->wake_fd[1] < 0)
+		return BOOL_FALSE;
+
+	task = faux_zmalloc(sizeof(*task));
+	assert(task);
+	if (!task)
+		return BOOL_FALSE;
+	task->context.event_cb = event_cb;
+	task->context.user_data = user_data;
+
+	// Push task to lock-free stack
+	head = __atomic_load_n(&eloop->tasks, __ATOMIC_RELAXED);
+	do {
+		task->next = head;
+	} while (!__atomic_compare_exchange_n(&eloop->tasks, &head, task,
+		BOOL_TRUE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+	// Wake up loop if it's not woken up yet
+	if (__atomic_exchange_n(&eloop->wake_pending, BOOL_TRUE,
+		__ATOMIC_SEQ_CST))
+		return BOOL_TRUE;
+	// The error is not significant. The full pipe means loop is woken up
+	// anyway. And the task is already queued.
+	if (write(eloop->wake_fd[1], &inc, sizeof(inc)) < 0)
+		return BOOL_TRUE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Asks loop to stop.
+ *
+ * The function is thread-safe. It doesn't allocate memory so it can be
+ * used when faux_eloop_post() fails. The loop is stopped at the end of
+ * current or the next iteration. If loop is not running yet then it will
+ * be stopped after the first iteration.
+ *
+ * @param [in] eloop Event loop object.
+ */
+void faux_eloop_request_stop(faux_eloop_t *eloop)
+{
+#ifdef HAVE_EVENTFD
+	uint64_t inc = 1;
+#else
+	char inc = 0;
+#endif
+
+	assert(eloop);
+	if (!eloop)
+		return;
+
+	__atomic_store_n(&eloop->stop_requested, BOOL_TRUE, __ATOMIC_SEQ_CST);
+	// The full pipe means loop is woken up anyway
+	if ((eloop->wake_fd[1] >= 0) &&
+		(write(eloop->wake_fd[1], &inc, sizeof(inc)) < 0))
+		return;
+}
+
+
+/** @brief Registers hook.
+ *
+ * The hooks are executed on each loop iteration:
+ * FAUX_ELOOP_PREPARE - before waiting for events.
+ * FAUX_ELOOP_CHECK - after dispatching of events and deferred callbacks.
+ * FAUX_ELOOP_IDLE - when there were no events while iteration. The
+ * registered idle hook makes loop to don't block while waiting for events.
+ *
+ * The hook ID must be unique within hooks of the same type. The
+ * faux_eloop_info_hook_t structure is passed to callback as associated
+ * data.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] type Hook type.
+ * @param [in] hook_id Hook ID.
+ * @param [in] event_cb Callback function. NULL for default callback.
+ * @param [in] user_data User data for callback function.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_add_hook(faux_eloop_t *eloop, faux_eloop_type_e type,
+	int hook_id, faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_hook_t *entry = NULL;
+	faux_list_t *hooks = NULL;
+
+	if (!eloop)
+		return BOOL_FALSE;
+	hooks = faux_eloop_hooks(eloop, type);
+	if (!hooks) // Invalid hook type
+		return BOOL_FALSE;
+
+	// Hook with the same ID can be deleted within dispatching but it's
+	// not freed yet. Reuse it.
+	if (hooks == eloop->hooks_dispatching) {
+		entry = (faux_eloop_hook_t *)faux_list_kfind(hooks, &hook_id);
+		if (entry && entry->deleted) {
+			entry->deleted = BOOL_FALSE;
+			entry->context.event_cb = event_cb;
+			entry->context.user_data = user_data;
+			return BOOL_TRUE;
+		}
+	}
+
+	entry = faux_zmalloc(sizeof(*entry));
+	if (!entry)
+		return BOOL_FALSE;
+	entry->hook_id = hook_id;
+	entry->deleted = BOOL_FALSE;
+	entry->context.event_cb = event_cb;
+	entry->context.user_data = user_data;
+
+	if (!faux_list_add(hooks, entry)) { // ID already exists
+		faux_free(entry);
+		return BOOL_FALSE;
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Removes hook.
+ *
+ * It can be called by hook callback. The hook of dispatched type is only
+ * marked as deleted then and it will be freed after dispatching.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] type Hook type.
+ * @param [in] hook_id Hook ID.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_del_hook(faux_eloop_t *eloop, faux_eloop_type_e type,
+	int hook_id)
+{
+	faux_list_t *hooks = NULL;
+
+	if (!eloop)
+		return BOOL_FALSE;
+	hooks = faux_eloop_hooks(eloop, type);
+	if (!hooks) // Invalid hook type
+		return BOOL_FALSE;
+
+	if (hooks == eloop->hooks_dispatching) {
+		faux_eloop_hook_t *hook = (faux_eloop_hook_t *)
+			faux_list_kfind(hooks, &hook_id);
+		if (!hook || hook->deleted)
+			return BOOL_FALSE;
+		hook->deleted = BOOL_TRUE;
+		eloop->hooks_deleted = BOOL_TRUE;
+		return BOOL_TRUE;
+	}
+
+	if (faux_list_kdel(hooks, &hook_id) < 0)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Defers callback to the end of current loop iteration.
+ *
+ * The deferred callbacks are executed once after dispatching of all the
+ * events of iteration. So the work caused by many events can be done in
+ * single pass, for example the output buffers of many connections can be
+ * flushed together. The callback is executed with FAUX_ELOOP_DEFER event
+ * type and NULL associated data. The callbacks are executed in order of
+ * deferring. The loop doesn't block while there are deferred callbacks.
+ *
+ * The function is not thread-safe. Use faux_eloop_post() from other
+ * threads.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] event_cb Callback function. NULL for default callback.
+ * @param [in] user_data User data for callback function.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_defer(faux_eloop_t *eloop,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_task_t *task = NULL;
+
+	assert(eloop);
+	if (!eloop)
+		return BOOL_FALSE;
+
+	task = faux_zmalloc(sizeof(*task));
+	assert(task);
+	if (!task)
+		return BOOL_FALSE;
+	task->context.event_cb = event_cb;
+	task->context.user_data = user_data;
+	task->next = NULL;
+
+	if (eloop->defer_tail)
+		eloop->defer_tail->next = task;
+	else
+		eloop->defer_head = task;
+	eloop->defer_tail = task;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Sets dispatch budget of loop iteration.
+ *
+ * The busy descriptors can delay other descriptors. The budget limits the
+ * number of dispatched descriptors and the time of dispatching within
+ * single iteration. The skipped descriptors are dispatched first by the
+ * next iterations. The dispatching starts from the different position
+ * each iteration so all descriptors get the same chance. The signals,
+ * scheduled events and posted tasks are not limited by budget.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] max_events Max number of dispatched descriptors. 0 for
+ * unlimited.
+ * @param [in] max_time Max time of dispatching. The callback is not
+ * interrupted so the time can be exceeded by the last callback. NULL for
+ * unlimited.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_set_budget(faux_eloop_t *eloop, unsigned int max_events,
+	const struct timespec *max_time)
+{
+	assert(eloop);
+	if (!eloop)
+		return BOOL_FALSE;
+
+	eloop->budget_events = max_events;
+	eloop->budget_time = 0;
+	if (max_time)
+		eloop->budget_time = faux_timespec_to_nsec(max_time);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Enables or disables loop statistics.
+ *
+ * The statistics is reset on enabling. The disabled statistics costs
+ * nearly nothing. The enabled one costs two clock reads per callback.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] enable BOOL_TRUE to enable statistics, BOOL_FALSE to disable.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_set_stats(faux_eloop_t *eloop, bool_t enable)
+{
+	assert(eloop);
+	if (!eloop)
+		return BOOL_FALSE;
+
+	if (!enable) {
+		faux_free(eloop->stats);
+		eloop->stats = NULL;
+		return BOOL_TRUE;
+	}
+	if (eloop->stats) // Already enabled
+		return BOOL_TRUE;
+	eloop->stats = faux_zmalloc(sizeof(*eloop->stats));
+	assert(eloop->stats);
+	if (!eloop->stats)
+		return BOOL_FALSE;
+
+	return faux_eloop_reset_stats(eloop);
+}
+
+
+/** @brief Resets loop statistics.
+ *
+ * The statistics of all registered file descriptors is reset too.
+ *
+ * @param [in] eloop Event loop object.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_reset_stats(faux_eloop_t *eloop)
+{
+	size_t i = 0;
+
+	assert(eloop);
+	if (!eloop)
+		return BOOL_FALSE;
+	if (!eloop->stats)
+		return BOOL_FALSE;
+
+	memset(eloop->stats, 0, sizeof(*eloop->stats));
+	for (i = 0; i < eloop->fds_size; i++) {
+		if (eloop->fds[i])
+			memset(&eloop->fds[i]->stats, 0,
+				sizeof(eloop->fds[i]->stats));
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Gets snapshot of loop statistics.
+ *
+ * The function is cheap so it can be used to export statistics
+ * periodically. See faux_eloop_set_stats_export() also.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [out] stats Statistics.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error or if statistics is
+ * disabled.
+ */
+bool_t faux_eloop_stats(const faux_eloop_t *eloop, faux_eloop_stats_t *stats)
+{
+	assert(eloop);
+	if (!eloop || !stats)
+		return BOOL_FALSE;
+	if (!eloop->stats)
+		return BOOL_FALSE;
+
+	*stats = *eloop->stats;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Sets statistics export callback.
+ *
+ * The callback is executed at the end of loop iteration when export
+ * period is expired and statistics is enabled. It gets the snapshot of
+ * loop statistics. The callback can use faux_eloop_fd_stats() and
+ * faux_eloop_reset_stats() to get per-descriptor statistics and to start
+ * new interval. The export doesn't wake up the loop. So idle loop exports
+ * statistics on the next wake up. The callback returns BOOL_FALSE to stop
+ * the loop like other callbacks.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] period Export period. NULL to export on each iteration.
+ * @param [in] export_cb Export callback. NULL to disable export.
+ * @param [in] user_data User data for callback function.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_set_stats_export(faux_eloop_t *eloop,
+	const struct timespec *period, faux_eloop_stats_cb_f *export_cb,
+	void *user_data)
+{
+	assert(eloop);
+	if (!eloop)
+		return BOOL_FALSE;
+
+	eloop->stats_cb = export_cb;
+	eloop->stats_udata = user_data;
+	eloop->stats_period = 0;
+	if (period)
+		eloop->stats_period = faux_timespec_to_nsec(period);
+	eloop->stats_last = faux_nsec_now_monotonic();
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Gets statistics of registered file descriptor.
+ *
+ * @param [in] eloop Event loop object.
+ * @param [in] fd File descriptor.
+ * @param [out] stats Statistics.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error or if statistics is
+ * disabled.
+ */
+bool_t faux_eloop_fd_stats(const faux_eloop_t *eloop, int fd,
+	faux_eloop_fd_stats_t *stats)
+{
+	faux_eloop_fd_t *entry = NULL;
+
+	assert(eloop);
+	if (!eloop || !stats)
+		return BOOL_FALSE;
+	if (!eloop->stats)
+		return BOOL_FALSE;
+	entry = faux_eloop_fd_entry(eloop, fd);
+	if (!entry)
+		return BOOL_FALSE;
+
+	*stats = entry->stats;
 
 	return BOOL_TRUE;
 }
@@ -0,0 +1,348 @@
+/** @file group.c
+ * @brief Group of event loops running within separate threads.
+ *
+ * The group contains N event loops. The first loop (index 0) is main one.
+ * It's executed within the thread that calls faux_eloop_group_run(). The
+ * other loops are executed within their own threads. The signals must be
+ * registered on the main loop only because signal handling is
+ * process-wide. The faux_eloop_add_signal() fails for worker loops. The
+ * worker threads block all signals. The other threads of application must
+ * block them too.
+ *
+ * The event loop object is not thread-safe. So the loop can be changed
+ * only by its own thread. The faux_eloop_post() is the only function that
+ * can be used from foreign thread. The group functions use it to register
+ * descriptors within other loops.
+ *
+ * The accepted sockets can be distributed across loops by round-robin
+ * faux_eloop_group_add_fd(). Another way is SO_REUSEPORT. The
+ * faux_eloop_group_post_each() can be used to create listening socket
+ * within each loop then.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <signal.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "faux/faux.h"
+#include "faux/eloop.h"
+
+#include "private.h"
+
+typedef struct faux_eloop_group_fd_s {
+	int fd;
+	short events;
+	faux_eloop_context_t context;
+} faux_eloop_group_fd_t;
+
+
+/** @brief Allocates group of event loops.
+ *
+ * Without threads support the group contains single loop.
+ *
+ * @param [in] num Number of loops. 0 means number of online CPUs.
+ * @param [in] default_event_cb Default callback function for all loops.
+ * @param [in] backend Backend to wait for file descriptor events.
+ * @return Allocated group or NULL on error.
+ */
+faux_eloop_group_t *faux_eloop_group_new(unsigned int num,
+	faux_eloop_cb_f *default_event_cb, faux_eloop_backend_e backend)
+{
+	faux_eloop_group_t *group = NULL;
+	unsigned int i = 0;
+
+	if (0 == num) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num = (cpus > 0) ? cpus : 1;
+	}
+#ifndef HAVE_PTHREAD
+	num = 1;
+#endif
+
+	group = faux_zmalloc(sizeof(*group));
+	assert(group);
+	if (!group)
+		return NULL;
+
+	// Init
+	group->len = num;
+	group->next = 0;
+	group->running = BOOL_FALSE;
+	group->loops = faux_zmalloc(num * sizeof(*group->loops));
+	assert(group->loops);
+#ifdef HAVE_PTHREAD
+	group->threads = faux_zmalloc(num * sizeof(*group->threads));
+	assert(group->threads);
+#endif
+	// The loops must have wake up descriptor to get tasks from other
+	// threads
+	for (i = 0; i < num; i++) {
+		group->loops[i] = faux_eloop_new_backend(default_event_cb, backend);
+		if (!group->loops[i] || (group->loops[i]->wake_fd[1] < 0)) {
+			faux_eloop_group_free(group);
+			return NULL;
+		}
+		group->loops[i]->worker = (i != 0);
+	}
+
+	return group;
+}
+
+
+/** @brief Frees group of event loops.
+ *
+ * The group must not be running.
+ *
+ * @param [in] group Group of event loops.
+ */
+void faux_eloop_group_free(faux_eloop_group_t *group)
+{
+	unsigned int i = 0;
+
+	if (!group)
+		return;
+
+	for (i = 0; i < group->len; i++)
+		faux_eloop_free(group->loops[i]);
+	faux_free(group->loops);
+#ifdef HAVE_PTHREAD
+	faux_free(group->threads);
+#endif
+	faux_free(group);
+}
+
+
+/** @brief Gets number of loops within group.
+ *
+ * @param [in] group Group of event loops.
+ * @return Number of loops.
+ */
+unsigned int faux_eloop_group_len(const faux_eloop_group_t *group)
+{
+	assert(group);
+	if (!group)
+		return 0;
+
+	return group->len;
+}
+
+
+/** @brief Gets loop by index.
+ *
+ * The loop with index 0 is the main loop.
+ *
+ * @param [in] group Group of event loops.
+ * @param [in] index Index of loop.
+ * @return Event loop object or NULL on error.
+ */
+faux_eloop_t *faux_eloop_group_loop(const faux_eloop_group_t *group,
+	unsigned int index)
+{
+	assert(group);
+	if (!group)
+		return NULL;
+	if (index >= group->len)
+		return NULL;
+
+	return group->loops[index];
+}
+
+
+/** @brief Chooses next loop by round-robin.
+ *
+ * The function is thread-safe.
+ *
+ * @param [in] group Group of event loops.
+ * @return Event loop object or NULL on error.
+ */
+faux_eloop_t *faux_eloop_group_next(faux_eloop_group_t *group)
+{
+	unsigned int index = 0;
+
+	assert(group);
+	if (!group)
+		return NULL;
+
+	index = __atomic_fetch_add(&group->next, 1, __ATOMIC_RELAXED);
+
+	return group->loops[index % group->len];
+}
+
+
+/** @brief Task to register descriptor within loop's own thread.
+ */
+static bool_t faux_eloop_group_add_fd_task(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	faux_eloop_group_fd_t *req = (faux_eloop_group_fd_t *)user_data;
+
+	if (!faux_eloop_add_fd(eloop, req->fd, req->events,
+		req->context.event_cb, req->context.user_data))
+		close(req->fd);
+	faux_free(req);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Registers descriptor within the next loop of group.
+ *
+ * The loop is chosen by round-robin. The descriptor will be registered by
+ * loop's own thread so function is thread-safe. The ownership of
+ * descriptor is passed to the loop. The descriptor will be closed if it
+ * can't be registered.
+ *
+ * @param [in] group Group of event loops.
+ * @param [in] fd File descriptor.
+ * @param [in] events Events to watch for (poll() format).
+ * @param [in] event_cb Callback function.
+ * @param [in] user_data User data for callback function.
+ * @return Chosen event loop or NULL on error.
+ */
+faux_eloop_t *faux_eloop_group_add_fd(faux_eloop_group_t *group, int fd,
+	short events, faux_eloop_cb_f *event_cb, void *user_data)
+{
+	faux_eloop_group_fd_t *req = NULL;
+	faux_eloop_t *eloop = NULL;
+
+	assert(group);
+	if (!group || (fd < 0))
+		return NULL;
+
+	req = faux_zmalloc(sizeof(*req));
+	assert(req);
+	if (!req)
+		return NULL;
+	req->fd = fd;
+	req->events = events;
+	req->context.event_cb = event_cb;
+	req->context.user_data = user_data;
+
+	eloop = faux_eloop_group_next(group);
+	if (!faux_eloop_post(eloop, faux_eloop_group_add_fd_task, req)) {
+		faux_free(req);
+		return NULL;
+	}
+
+	return eloop;
+}
+
+
+/** @brief Posts task to each loop of group.
+ *
+ * It can be used to initialize per-loop resources like SO_REUSEPORT
+ * listening sockets.
+ *
+ * @param [in] group Group of event loops.
+ * @param [in] event_cb Callback function.
+ * @param [in] user_data User data for callback function.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_eloop_group_post_each(faux_eloop_group_t *group,
+	faux_eloop_cb_f *event_cb, void *user_data)
+{
+	unsigned int i = 0;
+	bool_t retval = BOOL_TRUE;
+
+	assert(group);
+	if (!group)
+		return BOOL_FALSE;
+
+	for (i = 0; i < group->len; i++) {
+		if (!faux_eloop_post(group->loops[i], event_cb, user_data))
+			retval = BOOL_FALSE;
+	}
+
+	return retval;
+}
+
+
+#ifdef HAVE_PTHREAD
+/** @brief Thread function to execute worker loop.
+ */
+static void *faux_eloop_group_thread(void *arg)
+{
+	faux_eloop_loop((faux_eloop_t *)arg);
+
+	return NULL;
+}
+
+
+/** @brief Task to stop worker loop.
+ */
+static bool_t faux_eloop_group_stop_task(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	return BOOL_FALSE;
+}
+#endif
+
+
+/** @brief Runs all loops of group.
+ *
+ * The worker loops are started within their own threads. The main loop is
+ * executed within current thread. When main loop is stopped the worker
+ * loops are stopped too. Function returns after all threads are finished.
+ *
+ * @param [in] group Group of event loops.
+ * @return Return value of main loop.
+ */
+bool_t faux_eloop_group_run(faux_eloop_group_t *group)
+{
+	bool_t retval = BOOL_FALSE;
+#ifdef HAVE_PTHREAD
+	sigset_t all_signals;
+	sigset_t orig_signals;
+	unsigned int started = 1;
+	unsigned int i = 0;
+#endif
+
+	assert(group);
+	if (!group)
+		return BOOL_FALSE;
+	if (group->running)
+		return BOOL_FALSE;
+	group->running = BOOL_TRUE;
+
+#ifdef HAVE_PTHREAD
+	// Threads inherit signal mask. So worker threads will block all
+	// signals and signals will be delivered to main loop.
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_SETMASK, &all_signals, &orig_signals);
+	for (started = 1; started < group->len; started++) {
+		if (pthread_create(&group->threads[started], NULL,
+			faux_eloop_group_thread, group->loops[started]) != 0)
+			break;
+	}
+	pthread_sigmask(SIG_SETMASK, &orig_signals, NULL);
+#endif
+
+	// Don't run main loop if some workers can't be started
+#ifdef HAVE_PTHREAD
+	if (started == group->len)
+#endif
+		retval = faux_eloop_loop(group->loops[0]);
+
+#ifdef HAVE_PTHREAD
+	for (i = 1; i < started; i++) {
+		// The stop request doesn't allocate memory
+		if (!faux_eloop_post(group->loops[i],
+			faux_eloop_group_stop_task, NULL))
+			faux_eloop_request_stop(group->loops[i]);
+		pthread_join(group->threads[i], NULL);
+	}
+#endif
+	group->running = BOOL_FALSE;
+
+	return retval;
+}
@@ -4,20 +4,72 @@
 #include "faux/vec.h"
 #include "faux/sched.h"
 
+// Minimal size of descriptors array
+#define FAUX_ELOOP_FDS_CHUNK 64
+
+#ifdef HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+
+// Max number of events got by single epoll_pwait() call
+#define FAUX_ELOOP_EPOLL_EVENTS 128
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 
 struct faux_eloop_s {
 	bool_t working; // Is event loop active now. Can detect nested loop.
 	faux_eloop_cb_f *default_event_cb; // Default callback function
 	faux_list_t *scheds; // List of registered sched events
 	faux_sched_t *faux_sched; // Service shed structure
-	faux_list_t *fds; // List of registered file descriptors
-	faux_pollfd_t *pollfds; // Service object for ppoll()
+	struct faux_eloop_fd_s **fds; // Registered descriptors indexed by fd
+	size_t fds_size; // Allocated size of fds array
+	faux_pollfd_t *pollfds; // Service object for ppoll(). The epoll backend
+		// keeps descriptors unsupported by epoll here (regular files)
+#ifdef HAVE_EPOLL_CREATE1
+	int epoll_fd; // Descriptor of epoll backend. < 0 for ppoll() backend
+	struct epoll_event epoll_events[FAUX_ELOOP_EPOLL_EVENTS];
+#endif
 	faux_list_t *signals; // List of registered signals
 	sigset_t sig_set; // Set of registered signals (1 for interested signal)
 	sigset_t sig_mask; // Mask of registered signals (0 - interested) = not sig_set
+	faux_nsec_t now; // Loop time. Updated once per loop iteration
+	struct faux_eloop_task_s *tasks; // Lock-free stack of posted tasks
+	bool_t wake_pending; // Loop is already woken up for posted tasks
+	int wake_fd[2]; // Wake up loop when task is posted. eventfd or pipe
+	bool_t stop_requested; // Stop is requested by another thread
+	bool_t worker; // Worker loop of group. It can't handle signals
+	faux_list_t *prepare_hooks; // Hooks before waiting for events
+	faux_list_t *check_hooks; // Hooks after dispatching of events
+	faux_list_t *idle_hooks; // Hooks for iterations without events
+	faux_list_t *hooks_dispatching; // Hooks list that is dispatched now
+	bool_t hooks_deleted; // Some hooks are deleted within dispatching
+	struct faux_eloop_task_s *defer_head; // Queue of deferred callbacks
+	struct faux_eloop_task_s *defer_tail;
+	unsigned int budget_events; // Max descriptors per iteration. 0 - unlimited
+	faux_nsec_t budget_time; // Max dispatching time per iteration. 0 - unlimited
+	unsigned int dispatch_start; // Rotating start position of dispatching
+	uint64_t dispatch_iter; // Counter of descriptors dispatching
+	int *pending; // Queue of descriptors skipped due to exhausted budget
+	size_t pending_len;
+	size_t pending_size; // Allocated size of pending queue
+	faux_eloop_stats_t *stats; // Statistics. NULL if it's disabled
+	faux_eloop_stats_cb_f *stats_cb; // Statistics export callback
+	void *stats_udata;
+	faux_nsec_t stats_period; // Export period. 0 - each iteration
+	faux_nsec_t stats_last; // Time of the last export
+	uint64_t iter_events; // Number of callbacks within current iteration
+	faux_nsec_t last_cb_time; // Duration of the last callback
 #ifdef HAVE_SIGNALFD
 	int signal_fd; // Handler for signalfd(). Valid when loop is active only
 #endif
+#ifdef HAVE_TIMERFD_CREATE
+	int timer_fd; // Handler for timerfd. Valid when loop is active only
+	bool_t timer_armed; // Is timer_fd armed
+	struct timespec timer_time; // Absolute time timer_fd is armed to
+#endif
 };
 
 
@@ -28,18 +80,52 @@ typedef struct faux_eloop_context_s {
 
 typedef struct faux_eloop_shed_s {
 	int ev_id;
+	unsigned int cycle_num; // Number of cycles left. Can be infinite
+	faux_ev_t *ev; // Handle of scheduled event
 	faux_eloop_context_t context;
 } faux_eloop_sched_t;
 
 typedef struct faux_eloop_fd_s {
 	int fd;
 	short events;
+	bool_t skipped; // Skipped due to exhausted budget. It's within pending
+	uint64_t ready_iter; // Dispatch iteration the descriptor is ready within
+	short revents; // Returned events of ready_iter iteration
 	faux_eloop_context_t context;
+	faux_eloop_fd_stats_t stats;
 } faux_eloop_fd_t;
 
+typedef struct faux_eloop_task_s {
+	faux_eloop_context_t context;
+	struct faux_eloop_task_s *next;
+} faux_eloop_task_t;
+
+struct faux_eloop_group_s {
+	faux_eloop_t **loops; // Loop with index 0 is the main one
+	unsigned int len; // Number of loops
+	unsigned int next; // Round-robin counter
+#ifdef HAVE_PTHREAD
+	pthread_t *threads; // Threads of worker loops
+#endif
+	bool_t running;
+};
+
+typedef struct faux_eloop_hook_s {
+	int hook_id;
+	bool_t deleted; // Hook is deleted within dispatching. Free it later
+	faux_eloop_context_t context;
+} faux_eloop_hook_t;
+
 typedef struct faux_eloop_signal_s {
 	int signo;
 	struct sigaction oldact;
 	bool_t set;
 	faux_eloop_context_t context;
 } faux_eloop_signal_t;
+
+
+C_DECL_BEGIN
+
+void faux_eloop_request_stop(faux_eloop_t *eloop);
+
+C_DECL_END
@@ -0,0 +1,804 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "faux/faux.h"
+#include "faux/str.h"
+#include "faux/eloop.h"
+#include "faux/sched.h"
+#include "faux/testc_helpers.h"
+
+
+typedef struct {
+	int sock_reads;
+	int file_events;
+	int timeouts;
+} testc_eloop_t;
+
+
+static bool_t testc_eloop_sock_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	testc_eloop_t *res = (testc_eloop_t *)user_data;
+	char buf[16] = {};
+
+	if (read(info->fd, buf, sizeof(buf)) > 0)
+		res->sock_reads++;
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_file_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	testc_eloop_t *res = (testc_eloop_t *)user_data;
+
+	// Regular file is always ready. So stop watching for it.
+	res->file_events++;
+	faux_eloop_del_fd(eloop, info->fd);
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_stop_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	faux_eloop_info_sched_t *info = (faux_eloop_info_sched_t *)associated_data;
+	testc_eloop_t *res = (testc_eloop_t *)user_data;
+
+	if (2 == info->ev_id)
+		res->timeouts++;
+
+	return BOOL_FALSE;
+}
+
+
+int testc_faux_eloop_backends(void)
+{
+	faux_eloop_backend_e backends[] = {
+		FAUX_ELOOP_BACKEND_PPOLL,
+		FAUX_ELOOP_BACKEND_EPOLL,
+	};
+	const char *basedir = getenv(FAUX_TESTC_TMPDIR_ENV);
+	char *fn = NULL;
+	unsigned int i = 0;
+	int ret = -1; // Pessimistic
+
+	fn = faux_str_sprintf("%s/eloop", basedir);
+	if (faux_testc_file_deploy(fn, "regular file\n") < 0)
+		goto err;
+
+	for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+		faux_eloop_t *eloop = NULL;
+		testc_eloop_t res = {};
+		struct timespec stop = {0, 100000000l};
+		struct timespec fail = {5, 0};
+		int sv[2] = {-1, -1};
+		int file_fd = -1;
+		bool_t ok = BOOL_FALSE;
+
+		eloop = faux_eloop_new_backend(NULL, backends[i]);
+		if (!eloop)
+			goto err;
+		if ((socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0) &&
+			((file_fd = open(fn, O_RDONLY)) >= 0) &&
+			faux_eloop_add_fd(eloop, sv[0], POLLIN,
+				testc_eloop_sock_cb, &res) &&
+			faux_eloop_add_fd(eloop, file_fd, POLLIN,
+				testc_eloop_file_cb, &res) &&
+			faux_eloop_add_sched_once_delayed(eloop, &stop, 1,
+				testc_eloop_stop_cb, &res) &&
+			faux_eloop_add_sched_once_delayed(eloop, &fail, 2,
+				testc_eloop_stop_cb, &res) &&
+			(write(sv[1], "x", 1) == 1))
+			ok = faux_eloop_loop(eloop);
+		if (!ok)
+			printf("Backend %d: Can't run loop\n", backends[i]);
+		else if ((res.sock_reads != 1) || (res.file_events != 1) ||
+			(res.timeouts != 0)) {
+			printf("Backend %d: Events socket=%d file=%d "
+				"timeout=%d\n", backends[i], res.sock_reads,
+				res.file_events, res.timeouts);
+			ok = BOOL_FALSE;
+		}
+		faux_eloop_free(eloop);
+		if (file_fd >= 0)
+			close(file_fd);
+		if (sv[0] >= 0)
+			close(sv[0]);
+		if (sv[1] >= 0)
+			close(sv[1]);
+		if (!ok)
+			goto err;
+	}
+
+	ret = 0;
+err:
+	if (fn)
+		unlink(fn);
+	faux_str_free(fn);
+
+	return ret;
+}
+
+
+
+#define TESTC_ELOOP_POSTS 1000
+
+
+typedef struct {
+	faux_eloop_t *eloop;
+	int posted; // Number of successfully posted tasks
+	int executed; // Number of executed tasks
+} testc_eloop_post_t;
+
+
+static bool_t testc_eloop_post_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	testc_eloop_post_t *res = (testc_eloop_post_t *)user_data;
+
+	res->executed++;
+	if (TESTC_ELOOP_POSTS == res->executed)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+static void *testc_eloop_post_thread(void *arg)
+{
+	testc_eloop_post_t *res = (testc_eloop_post_t *)arg;
+	int i = 0;
+
+	for (i = 0; i < TESTC_ELOOP_POSTS; i++) {
+		if (!faux_eloop_post(res->eloop, testc_eloop_post_cb, res))
+			break;
+		res->posted++;
+	}
+
+	return NULL;
+}
+
+
+static bool_t testc_eloop_fail_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	return BOOL_FALSE;
+}
+
+
+int testc_faux_eloop_post(void)
+{
+	faux_eloop_t *eloop = NULL;
+	testc_eloop_post_t res = {};
+	struct timespec fail = {5, 0};
+#ifdef HAVE_PTHREAD
+	pthread_t thread;
+#endif
+	int ret = -1; // Pessimistic
+
+	eloop = faux_eloop_new(NULL);
+	if (!eloop)
+		return -1;
+	res.eloop = eloop;
+	faux_eloop_add_sched_once_delayed(eloop, &fail, 1,
+		testc_eloop_fail_cb, NULL);
+
+	// Tasks are posted by foreign thread while loop is running
+#ifdef HAVE_PTHREAD
+	if (pthread_create(&thread, NULL, testc_eloop_post_thread, &res) != 0) {
+		printf("pthread_create: Can't create thread\n");
+		goto err;
+	}
+	faux_eloop_loop(eloop);
+	pthread_join(thread, NULL);
+#else
+	testc_eloop_post_thread(&res);
+	faux_eloop_loop(eloop);
+#endif
+	if ((res.posted != TESTC_ELOOP_POSTS) ||
+		(res.executed != TESTC_ELOOP_POSTS)) {
+		printf("faux_eloop_post: Posted %d, executed %d tasks\n",
+			res.posted, res.executed);
+		goto err;
+	}
+
+	ret = 0;
+err:
+	faux_eloop_free(eloop);
+
+	return ret;
+}
+
+
+static int testc_eloop_hook_calls[4] = {};
+
+
+static bool_t testc_eloop_hook_cb(faux_eloop_t *eloop, faux_eloop_type_e type,
+	void *associated_data, void *user_data)
+{
+	faux_eloop_info_hook_t *info = (faux_eloop_info_hook_t *)associated_data;
+	int calls = ++testc_eloop_hook_calls[info->hook_id];
+
+	// The first hook deletes the next ones within dispatching
+	if ((1 == info->hook_id) && (1 == calls)) {
+		faux_eloop_del_hook(eloop, type, 2);
+		faux_eloop_del_hook(eloop, type, 3);
+		faux_eloop_add_hook(eloop, type, 3, testc_eloop_hook_cb, NULL);
+	}
+	// Delete itself
+	if ((1 == info->hook_id) && (2 == calls))
+		faux_eloop_del_hook(eloop, type, 1);
+	if ((3 == info->hook_id) && (3 == calls))
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+int testc_faux_eloop_hooks(void)
+{
+	faux_eloop_t *eloop = NULL;
+	int i = 0;
+	int ret = -1; // Pessimistic
+
+	eloop = faux_eloop_new(NULL);
+	if (!eloop)
+		return -1;
+	for (i = 1; i <= 3; i++)
+		faux_eloop_add_hook(eloop, FAUX_ELOOP_IDLE, i,
+			testc_eloop_hook_cb, NULL);
+	if (!faux_eloop_loop(eloop))
+		goto err;
+	if ((testc_eloop_hook_calls[1] != 2) ||
+		(testc_eloop_hook_calls[2] != 0) ||
+		(testc_eloop_hook_calls[3] != 3)) {
+		printf("Hooks calls: %d %d %d\n", testc_eloop_hook_calls[1],
+			testc_eloop_hook_calls[2], testc_eloop_hook_calls[3]);
+		goto err;
+	}
+
+	ret = 0;
+err:
+	faux_eloop_free(eloop);
+
+	return ret;
+}
+
+
+#define TESTC_ELOOP_BUDGET_FDS 8
+#define TESTC_ELOOP_BUDGET_EVENTS 3
+#define TESTC_ELOOP_BUDGET_ITERS 8
+
+
+typedef struct {
+	int fds[TESTC_ELOOP_BUDGET_FDS];
+	int calls[TESTC_ELOOP_BUDGET_FDS]; // Calls per descriptor
+	int iter_calls; // Calls within current iteration
+	int iters;
+	int max_iters;
+	int expected; // Expected number of calls per iteration
+	bool_t broken;
+	useconds_t cb_sleep; // Duration of descriptor callback
+} testc_eloop_budget_t;
+
+
+static bool_t testc_eloop_budget_fd_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	testc_eloop_budget_t *res = (testc_eloop_budget_t *)user_data;
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	unsigned int i = 0;
+
+	// Data is not read so descriptor is always ready
+	for (i = 0; i < TESTC_ELOOP_BUDGET_FDS; i++)
+		if (res->fds[i] == info->fd)
+			res->calls[i]++;
+	res->iter_calls++;
+	if (res->cb_sleep)
+		usleep(res->cb_sleep);
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_budget_check_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	testc_eloop_budget_t *res = (testc_eloop_budget_t *)user_data;
+
+	if (res->iter_calls != 0) {
+		if (res->iter_calls != res->expected) {
+			printf("Iteration %d: %d calls\n",
+				res->iters, res->iter_calls);
+			res->broken = BOOL_TRUE;
+		}
+		res->iters++;
+	}
+	res->iter_calls = 0;
+	if (res->iters >= res->max_iters)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_budget_sched_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	// Slow scheduled event must not consume descriptors budget
+	usleep(60000);
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Runs loop with always ready descriptors.
+ */
+static int testc_eloop_budget_run(faux_eloop_backend_e backend,
+	testc_eloop_budget_t *res, unsigned int max_events,
+	const struct timespec *max_time, bool_t slow_sched)
+{
+	faux_eloop_t *eloop = NULL;
+	int sv[TESTC_ELOOP_BUDGET_FDS][2] = {};
+	struct timespec period = {0, 1000000l};
+	unsigned int i = 0;
+	int ret = -1; // Pessimistic
+
+	for (i = 0; i < TESTC_ELOOP_BUDGET_FDS; i++)
+		sv[i][0] = sv[i][1] = -1;
+	eloop = faux_eloop_new_backend(NULL, backend);
+	if (!eloop)
+		return -1;
+	faux_eloop_set_budget(eloop, max_events, max_time);
+	faux_eloop_add_hook(eloop, FAUX_ELOOP_CHECK, 1,
+		testc_eloop_budget_check_cb, res);
+	for (i = 0; i < TESTC_ELOOP_BUDGET_FDS; i++) {
+		if ((socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) < 0) ||
+			(write(sv[i][1], "x", 1) != 1))
+			goto err;
+		res->fds[i] = sv[i][0];
+		if (!faux_eloop_add_fd(eloop, sv[i][0], POLLIN,
+			testc_eloop_budget_fd_cb, res))
+			goto err;
+	}
+	// Periodic event is executed within each iteration
+	if (slow_sched)
+		faux_eloop_add_sched_periodic_delayed(eloop, 1,
+			testc_eloop_budget_sched_cb, NULL, &period,
+			FAUX_SCHED_INFINITE);
+
+	faux_eloop_loop(eloop);
+	if (!res->broken)
+		ret = 0;
+err:
+	faux_eloop_free(eloop);
+	for (i = 0; i < TESTC_ELOOP_BUDGET_FDS; i++) {
+		if (sv[i][0] >= 0)
+			close(sv[i][0]);
+		if (sv[i][1] >= 0)
+			close(sv[i][1]);
+	}
+
+	return ret;
+}
+
+
+int testc_faux_eloop_budget(void)
+{
+	faux_eloop_backend_e backends[] = {
+		FAUX_ELOOP_BACKEND_PPOLL,
+		FAUX_ELOOP_BACKEND_EPOLL,
+	};
+	unsigned int i = 0;
+
+	for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+		testc_eloop_budget_t res = {};
+		struct timespec max_time = {0, 10000000l};
+		struct timespec long_time = {0, 30000000l};
+		unsigned int j = 0;
+
+		// Events budget. Skipped descriptors go first within the next
+		// iterations so all descriptors get the same number of calls.
+		res.max_iters = TESTC_ELOOP_BUDGET_ITERS;
+		res.expected = TESTC_ELOOP_BUDGET_EVENTS;
+		if (testc_eloop_budget_run(backends[i], &res,
+			TESTC_ELOOP_BUDGET_EVENTS, NULL, BOOL_FALSE) < 0) {
+			printf("Backend %d: Events budget\n", backends[i]);
+			return -1;
+		}
+		for (j = 0; j < TESTC_ELOOP_BUDGET_FDS; j++) {
+			if (res.calls[j] != TESTC_ELOOP_BUDGET_ITERS *
+				TESTC_ELOOP_BUDGET_EVENTS / TESTC_ELOOP_BUDGET_FDS) {
+				printf("Backend %d: Rotation. Descriptor %u: "
+					"%d calls\n", backends[i], j, res.calls[j]);
+				return -1;
+			}
+		}
+
+		// Time budget. Slow callback exhausts budget.
+		memset(&res, 0, sizeof(res));
+		res.max_iters = 3;
+		res.expected = 1;
+		res.cb_sleep = 20000;
+		if (testc_eloop_budget_run(backends[i], &res, 0, &max_time,
+			BOOL_FALSE) < 0) {
+			printf("Backend %d: Time budget\n", backends[i]);
+			return -1;
+		}
+
+		// Time of scheduled events is not charged against budget
+		memset(&res, 0, sizeof(res));
+		res.max_iters = TESTC_ELOOP_BUDGET_ITERS;
+		res.expected = TESTC_ELOOP_BUDGET_FDS;
+		res.cb_sleep = 500;
+		if (testc_eloop_budget_run(backends[i], &res, 0, &long_time,
+			BOOL_TRUE) < 0) {
+			printf("Backend %d: Time budget with scheduled event\n",
+				backends[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+#define TESTC_ELOOP_GROUP_LOOPS 3
+#define TESTC_ELOOP_GROUP_FDS 6
+
+
+typedef struct testc_eloop_group_s testc_eloop_group_t;
+
+typedef struct {
+	testc_eloop_group_t *res;
+	faux_eloop_t *chosen; // Loop chosen by faux_eloop_group_add_fd()
+	faux_eloop_t *handled; // Loop executed callback
+} testc_eloop_group_fd_t;
+
+struct testc_eloop_group_s {
+	faux_eloop_t *main;
+	testc_eloop_group_fd_t fds[TESTC_ELOOP_GROUP_FDS];
+	int fd_events; // Descriptor events reported to main loop
+	int inits; // Tasks posted to each loop and reported to main loop
+	unsigned int loops;
+};
+
+
+static bool_t testc_eloop_group_done_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	testc_eloop_group_t *res = (testc_eloop_group_t *)user_data;
+
+	// Executed within main loop. Stop the group when all is done.
+	if ((res->fd_events == TESTC_ELOOP_GROUP_FDS) &&
+		((unsigned int)res->inits == res->loops))
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_group_fd_done_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	testc_eloop_group_fd_t *req = (testc_eloop_group_fd_t *)user_data;
+
+	req->res->fd_events++;
+
+	return testc_eloop_group_done_cb(eloop, type, NULL, req->res);
+}
+
+
+static bool_t testc_eloop_group_fd_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	testc_eloop_group_fd_t *req = (testc_eloop_group_fd_t *)user_data;
+	char buf[16] = {};
+
+	// Executed within worker loop. Report to main loop.
+	if (read(info->fd, buf, sizeof(buf)) <= 0)
+		return BOOL_TRUE;
+	req->handled = eloop;
+	faux_eloop_post(req->res->main, testc_eloop_group_fd_done_cb, req);
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_group_init_done_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	testc_eloop_group_t *res = (testc_eloop_group_t *)user_data;
+
+	res->inits++;
+
+	return testc_eloop_group_done_cb(eloop, type, NULL, res);
+}
+
+
+static bool_t testc_eloop_group_init_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	testc_eloop_group_t *res = (testc_eloop_group_t *)user_data;
+
+	faux_eloop_post(res->main, testc_eloop_group_init_done_cb, res);
+
+	return BOOL_TRUE;
+}
+
+
+int testc_faux_eloop_group(void)
+{
+	faux_eloop_group_t *group = NULL;
+	testc_eloop_group_t res = {};
+	struct timespec fail = {5, 0};
+	int sv[TESTC_ELOOP_GROUP_FDS][2] = {};
+	unsigned int i = 0;
+	int ret = -1; // Pessimistic
+
+	for (i = 0; i < TESTC_ELOOP_GROUP_FDS; i++)
+		sv[i][0] = sv[i][1] = -1;
+	group = faux_eloop_group_new(TESTC_ELOOP_GROUP_LOOPS, NULL,
+		FAUX_ELOOP_BACKEND_AUTO);
+	if (!group) {
+		printf("faux_eloop_group_new: Can't create group\n");
+		return -1;
+	}
+	// Group has single loop without threads support
+	res.loops = faux_eloop_group_len(group);
+	res.main = faux_eloop_group_loop(group, 0);
+
+	// Signals can be handled by main loop only
+	if (res.loops > 1) {
+		if (faux_eloop_add_signal(faux_eloop_group_loop(group, 1),
+			SIGUSR1, NULL, NULL)) {
+			printf("faux_eloop_add_signal: Worker loop handles "
+				"signal\n");
+			goto err;
+		}
+	}
+	if (!faux_eloop_add_signal(res.main, SIGUSR1, NULL, NULL)) {
+		printf("faux_eloop_add_signal: Main loop can't handle signal\n");
+		goto err;
+	}
+
+	// Descriptors are distributed by round-robin
+	for (i = 0; i < TESTC_ELOOP_GROUP_FDS; i++) {
+		res.fds[i].res = &res;
+		if ((socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) < 0) ||
+			(write(sv[i][1], "x", 1) != 1))
+			goto err;
+		res.fds[i].chosen = faux_eloop_group_add_fd(group, sv[i][0],
+			POLLIN, testc_eloop_group_fd_cb, &res.fds[i]);
+		if (res.fds[i].chosen !=
+			faux_eloop_group_loop(group, i % res.loops)) {
+			printf("faux_eloop_group_add_fd: Not round-robin\n");
+			goto err;
+		}
+	}
+	if (!faux_eloop_group_post_each(group, testc_eloop_group_init_cb,
+		&res))
+		goto err;
+	faux_eloop_add_sched_once_delayed(res.main, &fail, 1,
+		testc_eloop_stop_cb, NULL);
+
+	if (!faux_eloop_group_run(group)) {
+		printf("faux_eloop_group_run: Can't run group\n");
+		goto err;
+	}
+	if ((res.fd_events != TESTC_ELOOP_GROUP_FDS) ||
+		((unsigned int)res.inits != res.loops)) {
+		printf("Reported events: fds=%d inits=%d\n",
+			res.fd_events, res.inits);
+		goto err;
+	}
+	for (i = 0; i < TESTC_ELOOP_GROUP_FDS; i++) {
+		if (res.fds[i].handled != res.fds[i].chosen) {
+			printf("Descriptor %u is handled by wrong loop\n", i);
+			goto err;
+		}
+	}
+
+	ret = 0;
+err:
+	faux_eloop_group_free(group);
+	for (i = 0; i < TESTC_ELOOP_GROUP_FDS; i++) {
+		if (sv[i][0] >= 0)
+			close(sv[i][0]);
+		if (sv[i][1] >= 0)
+			close(sv[i][1]);
+	}
+
+	return ret;
+}
+
+
+#define TESTC_ELOOP_STATS_CALLS 5
+#define TESTC_ELOOP_STATS_SLEEP 2000 // usec
+
+
+typedef struct {
+	int sock; // Peer socket
+	int calls;
+	uint64_t exports;
+	bool_t broken;
+} testc_eloop_stats_t;
+
+
+static bool_t testc_eloop_stats_fd_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	faux_eloop_info_fd_t *info = (faux_eloop_info_fd_t *)associated_data;
+	testc_eloop_stats_t *res = (testc_eloop_stats_t *)user_data;
+	char buf[16] = {};
+
+	// Single event per iteration. Peer sends the next byte.
+	if (read(info->fd, buf, sizeof(buf)) <= 0)
+		return BOOL_FALSE;
+	usleep(TESTC_ELOOP_STATS_SLEEP);
+	res->calls++;
+	if (TESTC_ELOOP_STATS_CALLS == res->calls)
+		return BOOL_FALSE;
+	if (write(res->sock, "x", 1) != 1)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+static bool_t testc_eloop_stats_export_cb(faux_eloop_t *eloop,
+	const faux_eloop_stats_t *stats, void *user_data)
+{
+	testc_eloop_stats_t *res = (testc_eloop_stats_t *)user_data;
+
+	// Export on each iteration
+	res->exports++;
+	if (stats->iterations != res->exports)
+		res->broken = BOOL_TRUE;
+
+	return BOOL_TRUE;
+}
+
+
+static uint64_t testc_eloop_hist_sum(const uint64_t *hist, unsigned int from)
+{
+	uint64_t sum = 0;
+	unsigned int i = 0;
+
+	for (i = from; i < FAUX_ELOOP_HIST_LEN; i++)
+		sum += hist[i];
+
+	return sum;
+}
+
+
+int testc_faux_eloop_stats(void)
+{
+	faux_eloop_t *eloop = NULL;
+	testc_eloop_stats_t res = {};
+	faux_eloop_stats_t stats = {};
+	faux_eloop_fd_stats_t fd_stats = {};
+	int sv[2] = {-1, -1};
+	int ret = -1; // Pessimistic
+
+	eloop = faux_eloop_new(NULL);
+	if (!eloop)
+		return -1;
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+		goto err;
+	res.sock = sv[1];
+	faux_eloop_add_fd(eloop, sv[0], POLLIN, testc_eloop_stats_fd_cb, &res);
+
+	// Disabled statistics
+	if (faux_eloop_stats(eloop, &stats) ||
+		faux_eloop_fd_stats(eloop, sv[0], &fd_stats)) {
+		printf("faux_eloop_stats: Statistics is not disabled\n");
+		goto err;
+	}
+
+	faux_eloop_set_stats(eloop, BOOL_TRUE);
+	faux_eloop_set_stats_export(eloop, NULL,
+		testc_eloop_stats_export_cb, &res);
+	if (write(sv[1], "x", 1) != 1)
+		goto err;
+	faux_eloop_loop(eloop);
+	if (res.calls != TESTC_ELOOP_STATS_CALLS)
+		goto err;
+
+	// Counters
+	if (!faux_eloop_stats(eloop, &stats))
+		goto err;
+	if ((stats.iterations < TESTC_ELOOP_STATS_CALLS) ||
+		(stats.wakeups < TESTC_ELOOP_STATS_CALLS) ||
+		(stats.wakeups > stats.iterations) ||
+		(stats.events < TESTC_ELOOP_STATS_CALLS)) {
+		printf("Counters: iterations=%lu wakeups=%lu events=%lu\n",
+			(unsigned long)stats.iterations,
+			(unsigned long)stats.wakeups, (unsigned long)stats.events);
+		goto err;
+	}
+	if ((stats.cb_max < TESTC_ELOOP_STATS_SLEEP * 1000l) ||
+		(stats.cb_max_type != FAUX_ELOOP_FD) ||
+		(stats.cb_time < stats.cb_max * TESTC_ELOOP_STATS_CALLS / 2)) {
+		printf("Callback time: max=%lld type=%d total=%lld\n",
+			(long long)stats.cb_max, stats.cb_max_type,
+			(long long)stats.cb_time);
+		goto err;
+	}
+
+	// Histograms count each iteration and each callback
+	if ((testc_eloop_hist_sum(stats.events_hist, 0) != stats.iterations) ||
+		(testc_eloop_hist_sum(stats.cb_hist, 0) != stats.events)) {
+		printf("Histograms don't match counters\n");
+		goto err;
+	}
+	// Callback with 2ms sleep is within [1024, 2048) usec bucket or later
+	if (testc_eloop_hist_sum(stats.cb_hist, 11) < TESTC_ELOOP_STATS_CALLS) {
+		printf("Callback histogram: slow callbacks are not counted\n");
+		goto err;
+	}
+	// Single descriptor callback per iteration
+	if (stats.events_hist[1] < TESTC_ELOOP_STATS_CALLS) {
+		printf("Events histogram: iterations are not counted\n");
+		goto err;
+	}
+
+	// Export
+	if (res.broken || (res.exports != stats.iterations)) {
+		printf("Export: %lu exports of %lu iterations\n",
+			(unsigned long)res.exports,
+			(unsigned long)stats.iterations);
+		goto err;
+	}
+
+	// Per descriptor statistics
+	if (!faux_eloop_fd_stats(eloop, sv[0], &fd_stats))
+		goto err;
+	if ((fd_stats.calls != TESTC_ELOOP_STATS_CALLS) ||
+		(fd_stats.cb_max < TESTC_ELOOP_STATS_SLEEP * 1000l) ||
+		(fd_stats.cb_time < fd_stats.cb_max)) {
+		printf("Descriptor statistics: calls=%lu max=%lld\n",
+			(unsigned long)fd_stats.calls, (long long)fd_stats.cb_max);
+		goto err;
+	}
+
+	// Reset
+	faux_eloop_reset_stats(eloop);
+	faux_eloop_stats(eloop, &stats);
+	faux_eloop_fd_stats(eloop, sv[0], &fd_stats);
+	if ((stats.iterations != 0) || (stats.events != 0) ||
+		(fd_stats.calls != 0)) {
+		printf("faux_eloop_reset_stats: Statistics is not reset\n");
+		goto err;
+	}
+
+	ret = 0;
+err:
+	faux_eloop_free(eloop);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+
+	return ret;
+}
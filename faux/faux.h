@@ -84,6 +84,8 @@ ssize_t faux_read(int fd, void *buf, size_t n);
 ssize_t faux_write_block(int fd, const void *buf, size_t n);
 size_t faux_read_block(int fd, void *buf, size_t n);
 ssize_t faux_read_whole_file(const char *path, void **data);
+ssize_t faux_write_whole_file(const char *path, const void *data, size_t n,
+	mode_t mode);
 
 // Filesystem
 ssize_t faux_filesize(const char *path);
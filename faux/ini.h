@@ -7,17 +7,35 @@
 
 #include <faux/faux.h>
 #include <faux/list.h>
+#include <faux/eloop.h>
 
 typedef struct faux_pair_s faux_pair_t;
 typedef struct faux_ini_s faux_ini_t;
+typedef struct faux_ini_section_s faux_ini_section_t;
+typedef struct faux_ini_cache_s faux_ini_cache_t;
+typedef struct faux_ini_watch_s faux_ini_watch_t;
 typedef faux_list_node_t faux_ini_node_t;
 
+typedef enum {
+	FAUX_INI_ADDED = 0,
+	FAUX_INI_REMOVED = 1,
+	FAUX_INI_CHANGED = 2
+} faux_ini_change_e;
+
+// Callback function prototype. It's called on every changed pair.
+typedef void faux_ini_change_f(faux_ini_change_e change, const char *section,
+	const char *name, const char *old_value, const char *new_value,
+	void *user_data);
+
 C_DECL_BEGIN
 
 // Pair
 const char *faux_pair_name(const faux_pair_t *pair);
 const char *faux_pair_value(const faux_pair_t *pair);
 
+// Section
+const char *faux_ini_section_name(const faux_ini_section_t *section);
+
 // Ini
 faux_ini_t *faux_ini_new(void);
 void faux_ini_free(faux_ini_t *ini);
@@ -30,9 +48,43 @@ const char *faux_ini_find(const faux_ini_t *ini, const char *name);
 faux_ini_node_t *faux_ini_iter(const faux_ini_t *ini);
 const faux_pair_t *faux_ini_each(faux_ini_node_t **iter);
 
+const faux_pair_t *faux_ini_section_set(faux_ini_t *ini, const char *section,
+	const char *name, const char *value);
+void faux_ini_section_unset(faux_ini_t *ini, const char *section,
+	const char *name);
+const faux_pair_t *faux_ini_section_find_pair(const faux_ini_t *ini,
+	const char *section, const char *name);
+const char *faux_ini_section_find(const faux_ini_t *ini,
+	const char *section, const char *name);
+faux_ini_node_t *faux_ini_section_iter(const faux_ini_t *ini,
+	const char *section);
+faux_ini_node_t *faux_ini_sections_iter(const faux_ini_t *ini);
+const faux_ini_section_t *faux_ini_sections_each(faux_ini_node_t **iter);
+
 int faux_ini_parse_str(faux_ini_t *ini, const char *str);
 int faux_ini_parse_file(faux_ini_t *ini, const char *fn);
 int faux_ini_write_file(const faux_ini_t *ini, const char *fn);
+int faux_ini_apply(faux_ini_t *ini, const faux_ini_t *new_ini,
+	faux_ini_change_f *change_cb, void *user_data);
+
+// Binary snapshot
+int faux_ini_cache_write(const faux_ini_t *ini, const char *src_fn,
+	const char *fn);
+faux_ini_cache_t *faux_ini_cache_open(const char *fn, const char *src_fn);
+void faux_ini_cache_close(faux_ini_cache_t *cache);
+size_t faux_ini_cache_len(const faux_ini_cache_t *cache);
+const char *faux_ini_cache_find(const faux_ini_cache_t *cache,
+	const char *section, const char *name);
+int faux_ini_cache_load(const faux_ini_cache_t *cache, faux_ini_t *ini);
+
+// Watch for INI file changes
+faux_ini_watch_t *faux_ini_watch_new(faux_ini_t *ini, const char *fn,
+	faux_ini_change_f *change_cb, void *user_data);
+void faux_ini_watch_free(faux_ini_watch_t *watch);
+int faux_ini_watch_fd(const faux_ini_watch_t *watch);
+int faux_ini_watch_reload(faux_ini_watch_t *watch);
+bool_t faux_ini_watch_attach(faux_ini_watch_t *watch, faux_eloop_t *eloop);
+bool_t faux_ini_watch_detach(faux_ini_watch_t *watch);
 
 C_DECL_END
 
@@ -0,0 +1,535 @@
+/** @file cache.c
+ * @brief Binary snapshot of parsed INI object.
+ *
+ * The snapshot is a compact binary image of INI object. It can be written
+ * next to the source INI file and then mmap()-ed on startup instead of
+ * text parsing. The lookups run directly against the mapped image.
+ *
+ * The image layout is:
+ * @code
+ * header | entries[entry_num] | buckets[bucket_num] | string table
+ * @endcode
+ * Entries are sorted by section name and then by pair name. The pairs
+ * outside of any section have empty section name so they go first.
+ * Buckets are open addressing hash table. Bucket contains entry index + 1.
+ * The zero bucket is empty. The string table contains zero terminated
+ * strings. Image uses native byte order.
+ *
+ * The image stores the stamp of source file: size, modification time with
+ * nanoseconds, inode and device numbers. Image is considered stale if source
+ * file was changed or replaced. The stamp is checked before the hash of the
+ * whole image (except the header). The hash is stored to detect broken images.
+ *
+ * Note the sections without pairs are not stored within image.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#include "private.h"
+#include "faux/faux.h"
+#include "faux/str.h"
+#include "faux/ini.h"
+
+#define FAUX_INI_CACHE_MAGIC 0x494e4946 // "FINI" in little endian
+#define FAUX_INI_CACHE_VERSION 2
+#define FAUX_INI_CACHE_FNV_BASIS 2166136261u
+#define FAUX_INI_CACHE_FNV_PRIME 16777619u
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t src_size; // Size of source file
+	int64_t src_mtime_sec; // Modification time of source file
+	int64_t src_mtime_nsec;
+	uint64_t src_ino; // Inode of source file. Detects replaced file
+	uint64_t src_dev;
+	uint32_t entry_num;
+	uint32_t bucket_num; // Power of two
+	uint32_t strtab_size;
+	uint32_t hash; // Hash of image without header
+} faux_ini_cache_hdr_t;
+
+typedef struct {
+	uint32_t section; // Offsets within string table
+	uint32_t name;
+	uint32_t value;
+	uint32_t hash; // Hash of section and name
+} faux_ini_cache_entry_t;
+
+struct faux_ini_cache_s {
+	void *image; // mmap()-ed image
+	size_t size; // Size of image
+	const faux_ini_cache_hdr_t *hdr;
+	const faux_ini_cache_entry_t *entries;
+	const uint32_t *buckets;
+	const char *strtab;
+};
+
+
+/** @brief Continues FNV-1a hash calculation.
+ */
+static uint32_t faux_ini_cache_hash_buf(uint32_t hash,
+	const void *buf, size_t n)
+{
+	const unsigned char *p = (const unsigned char *)buf;
+	size_t i = 0;
+
+	for (i = 0; i < n; i++) {
+		hash ^= p[i];
+		hash *= FAUX_INI_CACHE_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+
+/** @brief Calculates hash of pair key i.e. section and name.
+ *
+ * Strings are hashed including terminating zeros so there is no need
+ * to concatenate them.
+ */
+static uint32_t faux_ini_cache_hash_key(const char *section, const char *name)
+{
+	uint32_t hash = FAUX_INI_CACHE_FNV_BASIS;
+
+	hash = faux_ini_cache_hash_buf(hash, section, strlen(section) + 1);
+	hash = faux_ini_cache_hash_buf(hash, name, strlen(name) + 1);
+
+	return hash;
+}
+
+
+/** @brief Internal function to add pairs of the list to the image.
+ */
+static void faux_ini_cache_add_pairs(faux_list_t *list, uint32_t section_off,
+	const char *section, faux_ini_cache_entry_t *entries, uint32_t *entry_num,
+	char *strtab, uint32_t *strtab_size)
+{
+	faux_ini_node_t *iter = NULL;
+	const faux_pair_t *pair = NULL;
+
+	iter = (faux_ini_node_t *)faux_list_head(list);
+	while ((pair = faux_ini_each(&iter))) {
+		faux_ini_cache_entry_t *entry = &entries[*entry_num];
+		size_t len = 0;
+
+		entry->section = section_off;
+		entry->hash = faux_ini_cache_hash_key(section, pair->name);
+
+		len = strlen(pair->name) + 1;
+		memcpy(strtab + *strtab_size, pair->name, len);
+		entry->name = *strtab_size;
+		*strtab_size += len;
+
+		len = strlen(pair->value) + 1;
+		memcpy(strtab + *strtab_size, pair->value, len);
+		entry->value = *strtab_size;
+		*strtab_size += len;
+
+		(*entry_num)++;
+	}
+}
+
+
+/** @brief Writes binary snapshot of INI object to the file.
+ *
+ * The whole image is prepared in memory and then is written by single
+ * operation. The file is replaced atomically.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] src_fn Source INI file name to get stamp from.
+ * Can be NULL if INI object has no source file. Such image can't be
+ * validated against source file.
+ * @param [in] fn File name to write snapshot to.
+ * @return 0 - success, < 0 - error
+ */
+int faux_ini_cache_write(const faux_ini_t *ini, const char *src_fn,
+	const char *fn)
+{
+	faux_ini_cache_hdr_t *hdr = NULL;
+	faux_ini_cache_entry_t *entries = NULL;
+	uint32_t *buckets = NULL;
+	char *strtab = NULL;
+	char *image = NULL;
+	size_t image_size = 0;
+	size_t entries_off = 0;
+	size_t buckets_off = 0;
+	size_t strtab_off = 0;
+	size_t entry_num = 0;
+	size_t bucket_num = 1;
+	size_t strtab_max = 1; // Empty string for global section
+	uint32_t strtab_size = 0;
+	uint32_t num = 0;
+	uint32_t i = 0;
+	faux_ini_node_t *iter = NULL;
+	faux_ini_section_t *section = NULL;
+	const faux_pair_t *pair = NULL;
+	struct stat src_stat = {};
+	ssize_t bytes_written = 0;
+
+	assert(ini);
+	assert(fn);
+	if (!ini)
+		return -1;
+	if (!fn || '\0' == *fn)
+		return -1;
+
+	if (src_fn && (stat(src_fn, &src_stat) < 0))
+		return -1;
+
+	// Calculate image size
+	iter = faux_ini_iter(ini);
+	while ((pair = faux_ini_each(&iter))) {
+		strtab_max += strlen(pair->name) + strlen(pair->value) + 2;
+		entry_num++;
+	}
+	iter = faux_ini_sections_iter(ini);
+	while ((section = (faux_ini_section_t *)faux_ini_sections_each(&iter))) {
+		faux_ini_node_t *piter = NULL;
+
+		strtab_max += strlen(section->name) + 1;
+		piter = (faux_ini_node_t *)faux_list_head(section->list);
+		while ((pair = faux_ini_each(&piter))) {
+			strtab_max += strlen(pair->name) + strlen(pair->value) + 2;
+			entry_num++;
+		}
+	}
+	if ((entry_num > UINT32_MAX / 2) || (strtab_max > UINT32_MAX))
+		return -1;
+	while (bucket_num < entry_num * 2)
+		bucket_num <<= 1;
+
+	entries_off = sizeof(*hdr);
+	buckets_off = entries_off + entry_num * sizeof(*entries);
+	strtab_off = buckets_off + bucket_num * sizeof(*buckets);
+	image_size = strtab_off + strtab_max;
+	image = faux_zmalloc(image_size);
+	assert(image);
+	if (!image)
+		return -1;
+	hdr = (faux_ini_cache_hdr_t *)image;
+	entries = (faux_ini_cache_entry_t *)(image + entries_off);
+	buckets = (uint32_t *)(image + buckets_off);
+	strtab = image + strtab_off;
+
+	// Fill entries and string table. The strtab[0] is empty string.
+	strtab_size = 1;
+	faux_ini_cache_add_pairs(ini->list, 0, "", entries, &num,
+		strtab, &strtab_size);
+	iter = faux_ini_sections_iter(ini);
+	while ((section = (faux_ini_section_t *)faux_ini_sections_each(&iter))) {
+		uint32_t section_off = strtab_size;
+		size_t len = strlen(section->name) + 1;
+
+		memcpy(strtab + strtab_size, section->name, len);
+		strtab_size += len;
+		faux_ini_cache_add_pairs(section->list, section_off,
+			section->name, entries, &num, strtab, &strtab_size);
+	}
+
+	// Fill hash table
+	for (i = 0; i < num; i++) {
+		uint32_t b = entries[i].hash & (bucket_num - 1);
+		while (buckets[b] != 0)
+			b = (b + 1) & (bucket_num - 1);
+		buckets[b] = i + 1;
+	}
+
+	// Header
+	hdr->magic = FAUX_INI_CACHE_MAGIC;
+	hdr->version = FAUX_INI_CACHE_VERSION;
+	hdr->src_size = src_stat.st_size;
+	hdr->src_mtime_sec = src_stat.st_mtim.tv_sec;
+	hdr->src_mtime_nsec = src_stat.st_mtim.tv_nsec;
+	hdr->src_ino = src_stat.st_ino;
+	hdr->src_dev = src_stat.st_dev;
+	hdr->entry_num = num;
+	hdr->bucket_num = bucket_num;
+	hdr->strtab_size = strtab_size;
+	image_size = strtab_off + strtab_size;
+	hdr->hash = faux_ini_cache_hash_buf(FAUX_INI_CACHE_FNV_BASIS,
+		image + entries_off, image_size - entries_off);
+
+	bytes_written = faux_write_whole_file(fn, image, image_size, 0644);
+	faux_free(image);
+	if (bytes_written < 0)
+		return -1;
+
+	return 0;
+}
+
+
+/** @brief Checks header of mapped image.
+ *
+ * It's a cheap check. The image content is not touched.
+ *
+ * @param [in] cache Cache object with mapped image.
+ * @return BOOL_TRUE if header is consistent else BOOL_FALSE.
+ */
+static bool_t faux_ini_cache_validate_hdr(const faux_ini_cache_t *cache)
+{
+	const faux_ini_cache_hdr_t *hdr = NULL;
+	size_t expected_size = 0;
+
+	if (cache->size < sizeof(*hdr))
+		return BOOL_FALSE;
+	hdr = (const faux_ini_cache_hdr_t *)cache->image;
+	if ((hdr->magic != FAUX_INI_CACHE_MAGIC) ||
+		(hdr->version != FAUX_INI_CACHE_VERSION))
+		return BOOL_FALSE;
+	if ((0 == hdr->bucket_num) ||
+		(hdr->bucket_num & (hdr->bucket_num - 1)) ||
+		// At least one empty bucket must terminate probing
+		(hdr->bucket_num <= hdr->entry_num) ||
+		(0 == hdr->strtab_size))
+		return BOOL_FALSE;
+	expected_size = sizeof(*hdr) +
+		(size_t)hdr->entry_num * sizeof(faux_ini_cache_entry_t) +
+		(size_t)hdr->bucket_num * sizeof(uint32_t) +
+		hdr->strtab_size;
+	if (expected_size != cache->size)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Checks if image is made from the current version of source file.
+ *
+ * @param [in] cache Cache object with mapped image.
+ * @param [in] src_fn Source INI file name.
+ * @return BOOL_TRUE if source file is unchanged else BOOL_FALSE.
+ */
+static bool_t faux_ini_cache_validate_src(const faux_ini_cache_t *cache,
+	const char *src_fn)
+{
+	const faux_ini_cache_hdr_t *hdr =
+		(const faux_ini_cache_hdr_t *)cache->image;
+	struct stat st = {};
+
+	if (stat(src_fn, &st) < 0)
+		return BOOL_FALSE;
+	if (((uint64_t)st.st_size != hdr->src_size) ||
+		(st.st_mtim.tv_sec != hdr->src_mtime_sec) ||
+		(st.st_mtim.tv_nsec != hdr->src_mtime_nsec) ||
+		((uint64_t)st.st_ino != hdr->src_ino) ||
+		((uint64_t)st.st_dev != hdr->src_dev))
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Checks integrity of mapped image.
+ *
+ * The header must be checked by faux_ini_cache_validate_hdr() before.
+ *
+ * @param [in] cache Cache object with mapped image.
+ * @return BOOL_TRUE if image is consistent else BOOL_FALSE.
+ */
+static bool_t faux_ini_cache_validate(faux_ini_cache_t *cache)
+{
+	const faux_ini_cache_hdr_t *hdr = NULL;
+	uint32_t i = 0;
+
+	hdr = (const faux_ini_cache_hdr_t *)cache->image;
+	if (faux_ini_cache_hash_buf(FAUX_INI_CACHE_FNV_BASIS,
+		(const char *)cache->image + sizeof(*hdr),
+		cache->size - sizeof(*hdr)) != hdr->hash)
+		return BOOL_FALSE;
+
+	cache->hdr = hdr;
+	cache->entries = (const faux_ini_cache_entry_t *)(hdr + 1);
+	cache->buckets = (const uint32_t *)(cache->entries + hdr->entry_num);
+	cache->strtab = (const char *)(cache->buckets + hdr->bucket_num);
+
+	// All strings must be zero terminated and offsets must be valid
+	if (cache->strtab[hdr->strtab_size - 1] != '\0')
+		return BOOL_FALSE;
+	for (i = 0; i < hdr->entry_num; i++) {
+		const faux_ini_cache_entry_t *entry = &cache->entries[i];
+		if ((entry->section >= hdr->strtab_size) ||
+			(entry->name >= hdr->strtab_size) ||
+			(entry->value >= hdr->strtab_size))
+			return BOOL_FALSE;
+	}
+	for (i = 0; i < hdr->bucket_num; i++) {
+		if (cache->buckets[i] > hdr->entry_num)
+			return BOOL_FALSE;
+	}
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Opens binary snapshot of INI object.
+ *
+ * Function maps the snapshot file to memory and validates it. If source
+ * file name is specified then the stamp of the source file (size,
+ * modification time, inode and device) must be equal to the values stored
+ * within snapshot. Else the snapshot is considered stale. The header and
+ * the stamp are checked before the hash of the whole image so the stale
+ * snapshot is rejected cheaply.
+ *
+ * @param [in] fn File name of snapshot.
+ * @param [in] src_fn Source INI file name. Can be NULL.
+ * @return Allocated cache object or NULL on error or stale snapshot.
+ */
+faux_ini_cache_t *faux_ini_cache_open(const char *fn, const char *src_fn)
+{
+	faux_ini_cache_t *cache = NULL;
+	struct stat st = {};
+	int fd = -1;
+
+	assert(fn);
+	if (!fn || '\0' == *fn)
+		return NULL;
+
+	fd = open(fn, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if ((fstat(fd, &st) < 0) || (st.st_size <= 0)) {
+		close(fd);
+		return NULL;
+	}
+
+	cache = faux_zmalloc(sizeof(*cache));
+	assert(cache);
+	if (!cache) {
+		close(fd);
+		return NULL;
+	}
+	cache->size = st.st_size;
+	cache->image = mmap(NULL, cache->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (MAP_FAILED == cache->image) {
+		faux_free(cache);
+		return NULL;
+	}
+
+	if (!faux_ini_cache_validate_hdr(cache) ||
+		(src_fn && !faux_ini_cache_validate_src(cache, src_fn)) ||
+		!faux_ini_cache_validate(cache)) {
+		faux_ini_cache_close(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+
+/** @brief Closes snapshot and frees cache object.
+ *
+ * All strings got from cache object become invalid.
+ *
+ * @param [in] cache Cache object.
+ */
+void faux_ini_cache_close(faux_ini_cache_t *cache)
+{
+	if (!cache)
+		return;
+
+	munmap(cache->image, cache->size);
+	faux_free(cache);
+}
+
+
+/** @brief Returns number of pairs within snapshot.
+ *
+ * @param [in] cache Cache object.
+ * @return Number of pairs.
+ */
+size_t faux_ini_cache_len(const faux_ini_cache_t *cache)
+{
+	assert(cache);
+	if (!cache)
+		return 0;
+
+	return cache->hdr->entry_num;
+}
+
+
+/** @brief Searches snapshot for value by section and name.
+ *
+ * The returned string points to mapped image. It's valid until
+ * faux_ini_cache_close() call.
+ *
+ * @param [in] cache Cache object.
+ * @param [in] section Section name. NULL for pairs outside of any section.
+ * @param [in] name Name to search for.
+ * @return Found value or NULL.
+ */
+const char *faux_ini_cache_find(const faux_ini_cache_t *cache,
+	const char *section, const char *name)
+{
+	uint32_t hash = 0;
+	uint32_t mask = 0;
+	uint32_t b = 0;
+	uint32_t probes = 0;
+
+	assert(cache);
+	assert(name);
+	if (!cache || !name)
+		return NULL;
+	if (!section)
+		section = "";
+
+	hash = faux_ini_cache_hash_key(section, name);
+	mask = cache->hdr->bucket_num - 1;
+	// The number of probes is limited by table size too so damaged
+	// table can't loop forever.
+	for (b = hash & mask; (cache->buckets[b] != 0) &&
+		(probes < cache->hdr->bucket_num);
+		b = (b + 1) & mask, probes++) {
+		const faux_ini_cache_entry_t *entry =
+			&cache->entries[cache->buckets[b] - 1];
+		if (entry->hash != hash)
+			continue;
+		if (strcmp(cache->strtab + entry->name, name) != 0)
+			continue;
+		if (strcmp(cache->strtab + entry->section, section) != 0)
+			continue;
+		return cache->strtab + entry->value;
+	}
+
+	return NULL;
+}
+
+
+/** @brief Fills INI object with pairs from snapshot.
+ *
+ * It's an alternative to faux_ini_parse_file() without text parsing.
+ *
+ * @param [in] cache Cache object.
+ * @param [in] ini Allocated and initialized INI object.
+ * @return 0 - success, < 0 - error
+ */
+int faux_ini_cache_load(const faux_ini_cache_t *cache, faux_ini_t *ini)
+{
+	uint32_t i = 0;
+
+	assert(cache);
+	assert(ini);
+	if (!cache || !ini)
+		return -1;
+
+	for (i = 0; i < cache->hdr->entry_num; i++) {
+		const faux_ini_cache_entry_t *entry = &cache->entries[i];
+		const char *section = cache->strtab + entry->section;
+
+		if (!faux_ini_section_set(ini, ('\0' == *section) ? NULL : section,
+			cache->strtab + entry->name, cache->strtab + entry->value))
+			return -1;
+	}
+
+	return 0;
+}
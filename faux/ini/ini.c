@@ -32,6 +32,9 @@ faux_ini_t *faux_ini_new(void)
 	// Init
 	ini->list = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
 		faux_pair_compare, faux_pair_kcompare, faux_pair_free);
+	ini->sections = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
+		faux_ini_section_compare, faux_ini_section_kcompare,
+		faux_ini_section_free);
 
 	return ini;
 }
@@ -47,11 +50,66 @@ void faux_ini_free(faux_ini_t *ini)
 	if (!ini)
 		return;
 
+	faux_list_free(ini->sections);
 	faux_list_free(ini->list);
 	faux_free(ini);
 }
 
 
+/** @brief Gets list of pairs for specified section.
+ *
+ * The NULL section means pairs outside of any section.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] section Section name or NULL.
+ * @return List of pairs or NULL if section doesn't exist.
+ */
+static faux_list_t *faux_ini_pairs(const faux_ini_t *ini, const char *section)
+{
+	faux_ini_section_t *s = NULL;
+
+	if (!section)
+		return ini->list;
+
+	s = faux_list_kfind(ini->sections, section);
+	if (!s)
+		return NULL;
+
+	return s->list;
+}
+
+
+/** @brief Finds section by name or creates new one.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] section Section name.
+ * @return Found or newly created section or NULL on error.
+ */
+static faux_ini_section_t *faux_ini_section_add(faux_ini_t *ini,
+	const char *section)
+{
+	faux_ini_section_t *s = NULL;
+	faux_list_node_t *node = NULL;
+	faux_ini_section_t *found_s = NULL;
+
+	s = faux_ini_section_new(section);
+	assert(s);
+	if (!s)
+		return NULL;
+
+	node = faux_list_add_find(ini->sections, s);
+	if (!node) { // Something went wrong
+		faux_ini_section_free(s);
+		return NULL;
+	}
+	found_s = faux_list_data(node);
+	if (found_s != s) // Section already exists so use existent
+		faux_ini_section_free(s);
+
+	return found_s;
+}
+
+
 /** @brief Adds pair 'name/value' to INI object.
  *
  * The 'name' field is a key. The key must be unique. Each key has its
@@ -62,6 +120,8 @@ void faux_ini_free(faux_ini_t *ini)
  * will be replaced by newer one. If new specified value is NULL then the
  * entry with the correspondent key will be removed from the INI object.
  *
+ * The pair is stored outside of any section. See faux_ini_section_set().
+ *
  * @param [in] ini Allocated and initialized INI object.
  * @param [in] name Name field for pair 'name/value'.
  * @param [in] value Value field for pair 'name/value'.
@@ -72,31 +132,147 @@ void faux_ini_free(faux_ini_t *ini)
  */
 const faux_pair_t *faux_ini_set(
 	faux_ini_t *ini, const char *name, const char *value)
+{
+	return faux_ini_section_set(ini, NULL, name, value);
+}
+
+
+/** @brief Removes pair 'name/value' from INI object.
+ *
+ * Function search for the pair with specified name within INI object and
+ * removes it.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] name Name field to search for the entry.
+ */
+void faux_ini_unset(faux_ini_t *ini, const char *name)
+{
+	faux_ini_set(ini, name, NULL);
+}
+
+
+/** @brief Searches for pair by name.
+ *
+ * The name field is a key to search INI object for pair 'name/value'.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] name Name field to search for.
+ * @return
+ * Found pair 'name/value'.
+ * NULL on errror.
+ */
+const faux_pair_t *faux_ini_find_pair(const faux_ini_t *ini, const char *name)
+{
+	return faux_ini_section_find_pair(ini, NULL, name);
+}
+
+
+/** @brief Searches for pair by name and returns correspondent value.
+ *
+ * The name field is a key to search INI object for pair 'name/value'.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] name Name field to search for.
+ * @return
+ * Found value field.
+ * NULL on errror.
+ */
+const char *faux_ini_find(const faux_ini_t *ini, const char *name)
+{
+	return faux_ini_section_find(ini, NULL, name);
+}
+
+
+/** @brief Initializes iterator to iterate through the entire INI object.
+ *
+ * Before iterating with the faux_ini_each() function the iterator must be
+ * initialized. This function do it. Only pairs outside of any section
+ * are iterated. See faux_ini_section_iter().
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @return Initialized iterator.
+ * @sa faux_ini_each()
+ */
+faux_ini_node_t *faux_ini_iter(const faux_ini_t *ini)
+{
+	return faux_ini_section_iter(ini, NULL);
+}
+
+
+/** @brief Iterate entire INI object for pairs 'name/value'.
+ *
+ * Before iteration the iterator must be initialized by faux_ini_iter()
+ * function. Doesn't use faux_ini_each() with uninitialized iterator.
+ *
+ * On each call function returns pair 'name/value' and modifies iterator.
+ * Stop iteration when function returns NULL.
+ *
+ * @param [in,out] iter Iterator.
+ * @return Pair 'name/value'.
+ * @sa faux_ini_iter()
+ */
+const faux_pair_t *faux_ini_each(faux_ini_node_t **iter)
+{
+	return (const faux_pair_t *)faux_list_each((faux_list_node_t **)iter);
+}
+
+
+/** @brief Adds pair 'name/value' to the specified section of INI object.
+ *
+ * Function acts like a faux_ini_set() but the pair belongs to the
+ * section. Each section has its own index so the same name can be used
+ * within different sections. The section will be created if it doesn't
+ * exist yet. The NULL section means pairs outside of any section.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] section Section name or NULL.
+ * @param [in] name Name field for pair 'name/value'.
+ * @param [in] value Value field for pair 'name/value'.
+ * @return
+ * Newly created pair object.
+ * NULL if entry was removed (value == NULL)
+ * NULL on error
+ * @sa faux_ini_set()
+ */
+const faux_pair_t *faux_ini_section_set(faux_ini_t *ini, const char *section,
+	const char *name, const char *value)
 {
 	faux_pair_t *pair = NULL;
 	faux_list_node_t *node = NULL;
 	faux_pair_t *found_pair = NULL;
+	faux_list_t *list = NULL;
 
 	assert(ini);
 	assert(name);
 	if (!ini || !name)
 		return NULL;
 
+	list = faux_ini_pairs(ini, section);
+
 	// NULL 'value' means: remove entry from list
 	if (!value) {
-		node = faux_list_kfind_node(ini->list, name);
+		if (!list)
+			return NULL;
+		node = faux_list_kfind_node(list, name);
 		if (node)
-			faux_list_del(ini->list, node);
+			faux_list_del(list, node);
 		return NULL;
 	}
 
+	if (!list) {
+		faux_ini_section_t *s = faux_ini_section_add(ini, section);
+		if (!s)
+			return NULL;
+		list = s->list;
+	}
+
 	pair = faux_pair_new(name, value);
 	assert(pair);
 	if (!pair)
 		return NULL;
 
 	// Try to add new entry or find existent entry with the same 'name'
-	node = faux_list_add_find(ini->list, pair);
+	node = faux_list_add_find(list, pair);
 	if (!node) { // Something went wrong
 		faux_pair_free(pair);
 		return NULL;
@@ -114,54 +290,62 @@ const faux_pair_t *faux_ini_set(
 }
 
 
-/** @brief Removes pair 'name/value' from INI object.
- *
- * Function search for the pair with specified name within INI object and
- * removes it.
+/** @brief Removes pair 'name/value' from the section of INI object.
  *
  * @param [in] ini Allocated and initialized INI object.
+ * @param [in] section Section name or NULL.
  * @param [in] name Name field to search for the entry.
  */
-void faux_ini_unset(faux_ini_t *ini, const char *name)
+void faux_ini_section_unset(faux_ini_t *ini, const char *section,
+	const char *name)
 {
-	faux_ini_set(ini, name, NULL);
+	faux_ini_section_set(ini, section, name, NULL);
 }
 
 
-/** @brief Searches for pair by name.
+/** @brief Searches for pair by section and name.
  *
- * The name field is a key to search INI object for pair 'name/value'.
+ * Only the index of specified section is searched so there is no need to
+ * construct composite keys.
  *
  * @param [in] ini Allocated and initialized INI object.
+ * @param [in] section Section name or NULL.
  * @param [in] name Name field to search for.
  * @return
  * Found pair 'name/value'.
  * NULL on errror.
  */
-const faux_pair_t *faux_ini_find_pair(const faux_ini_t *ini, const char *name)
+const faux_pair_t *faux_ini_section_find_pair(const faux_ini_t *ini,
+	const char *section, const char *name)
 {
+	faux_list_t *list = NULL;
+
 	assert(ini);
 	assert(name);
 	if (!ini || !name)
 		return NULL;
 
-	return faux_list_kfind(ini->list, name);
+	list = faux_ini_pairs(ini, section);
+	if (!list)
+		return NULL;
+
+	return faux_list_kfind(list, name);
 }
 
 
-/** @brief Searches for pair by name and returns correspondent value.
- *
- * The name field is a key to search INI object for pair 'name/value'.
+/** @brief Searches for pair by section and name and returns value.
  *
  * @param [in] ini Allocated and initialized INI object.
+ * @param [in] section Section name or NULL.
  * @param [in] name Name field to search for.
  * @return
  * Found value field.
  * NULL on errror.
  */
-const char *faux_ini_find(const faux_ini_t *ini, const char *name)
+const char *faux_ini_section_find(const faux_ini_t *ini,
+	const char *section, const char *name)
 {
-	const faux_pair_t *pair = faux_ini_find_pair(ini, name);
+	const faux_pair_t *pair = faux_ini_section_find_pair(ini, section, name);
 
 	if (!pair)
 		return NULL;
@@ -170,40 +354,60 @@ const char *faux_ini_find(const faux_ini_t *ini, const char *name)
 }
 
 
-/** @brief Initializes iterator to iterate through the entire INI object.
+/** @brief Initializes iterator to iterate through the single section.
  *
- * Before iterating with the faux_ini_each() function the iterator must be
- * initialized. This function do it.
+ * Use faux_ini_each() to get pairs of the section.
  *
  * @param [in] ini Allocated and initialized INI object.
- * @return Initialized iterator.
+ * @param [in] section Section name or NULL.
+ * @return Initialized iterator or NULL if section doesn't exist.
  * @sa faux_ini_each()
  */
-faux_ini_node_t *faux_ini_iter(const faux_ini_t *ini)
+faux_ini_node_t *faux_ini_section_iter(const faux_ini_t *ini,
+	const char *section)
 {
+	faux_list_t *list = NULL;
+
 	assert(ini);
 	if (!ini)
 		return NULL;
 
-	return (faux_ini_node_t *)faux_list_head(ini->list);
+	list = faux_ini_pairs(ini, section);
+	if (!list)
+		return NULL;
+
+	return (faux_ini_node_t *)faux_list_head(list);
 }
 
 
-/** @brief Iterate entire INI object for pairs 'name/value'.
+/** @brief Initializes iterator to iterate through the sections.
  *
- * Before iteration the iterator must be initialized by faux_ini_iter()
- * function. Doesn't use faux_ini_each() with uninitialized iterator.
+ * @param [in] ini Allocated and initialized INI object.
+ * @return Initialized iterator.
+ * @sa faux_ini_sections_each()
+ */
+faux_ini_node_t *faux_ini_sections_iter(const faux_ini_t *ini)
+{
+	assert(ini);
+	if (!ini)
+		return NULL;
+
+	return (faux_ini_node_t *)faux_list_head(ini->sections);
+}
+
+
+/** @brief Iterate through the sections of INI object.
  *
- * On each call function returns pair 'name/value' and modifies iterator.
- * Stop iteration when function returns NULL.
+ * Sections are sorted by name.
  *
  * @param [in,out] iter Iterator.
- * @return Pair 'name/value'.
- * @sa faux_ini_iter()
+ * @return Section.
+ * @sa faux_ini_sections_iter()
  */
-const faux_pair_t *faux_ini_each(faux_ini_node_t **iter)
+const faux_ini_section_t *faux_ini_sections_each(faux_ini_node_t **iter)
 {
-	return (const faux_pair_t *)faux_list_each((faux_list_node_t **)iter);
+	return (const faux_ini_section_t *)faux_list_each(
+		(faux_list_node_t **)iter);
 }
 
 
@@ -275,21 +479,18 @@ static char *faux_ini_purify_word(const char *str)
 }
 
 
-/** @brief Parse string for pairs 'name/value'.
+/** @brief Parse string for pairs 'name/value' and section headers.
  *
- * String can contain an `name/value` pairs in following format:
- * @code
- * var1=value1
- * var2 = "value 2"
- * @endcode
- * Function parses that string and stores 'name/value' pairs to
- * the INI object.
+ * Internal function. The current section is passed by pointer so section
+ * header found within one string affects the following strings.
  *
  * @param [in] ini Allocated and initialized INI object.
  * @param [in] string String to parse.
+ * @param [in,out] section Current section name. Can be changed.
  * @return 0 - succes, < 0 - error
  */
-int faux_ini_parse_str(faux_ini_t *ini, const char *string)
+static int faux_ini_parse_str_section(faux_ini_t *ini, const char *string,
+	char **section)
 {
 	char *buffer = NULL;
 	char *saveptr = NULL;
@@ -320,6 +521,22 @@ int faux_ini_parse_str(faux_ini_t *ini, const char *string)
 			continue;
 		if ('#' == *line) // Comment. Skip it.
 			continue;
+
+		// Section header. The empty header "[]" means pairs outside
+		// of any section.
+		if ('[' == *line) {
+			char *end = strchr(line, ']');
+			if (!end) // Unclosed header. Skip it.
+				continue;
+			str = faux_str_dupn(line + 1, end - line - 1);
+			faux_str_free(*section);
+			*section = faux_ini_purify_word(str);
+			faux_str_free(str);
+			if (*section)
+				faux_ini_section_add(ini, *section);
+			continue;
+		}
+
 		str = faux_str_dup(line);
 
 		// Find out name
@@ -342,7 +559,7 @@ int faux_ini_parse_str(faux_ini_t *ini, const char *string)
 			rvalue = faux_ini_purify_word(value);
 		}
 
-		faux_ini_set(ini, rname, rvalue);
+		faux_ini_section_set(ini, *section, rname, rvalue);
 		faux_str_free(rname);
 		faux_str_free(rvalue);
 		faux_str_free(str);
@@ -353,12 +570,45 @@ int faux_ini_parse_str(faux_ini_t *ini, const char *string)
 }
 
 
+/** @brief Parse string for pairs 'name/value'.
+ *
+ * String can contain an `name/value` pairs and section headers in
+ * following format:
+ * @code
+ * var1=value1
+ * var2 = "value 2"
+ * [section]
+ * var1 = "section value"
+ * @endcode
+ * Function parses that string and stores 'name/value' pairs to
+ * the INI object. Pairs before the first section header are stored
+ * outside of any section.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] string String to parse.
+ * @return 0 - succes, < 0 - error
+ */
+int faux_ini_parse_str(faux_ini_t *ini, const char *string)
+{
+	char *section = NULL;
+	int retval = 0;
+
+	retval = faux_ini_parse_str_section(ini, string, &section);
+	faux_str_free(section);
+
+	return retval;
+}
+
+
 /** @brief Parse file for pairs 'name/value'.
  *
- * File can contain an `name/value` pairs in following format:
+ * File can contain an `name/value` pairs and section headers in
+ * following format:
  * @code
  * var1=value1
  * var2 = "value 2"
+ * [section]
+ * var1 = "section value"
  * @endcode
  * Function parses file and stores 'name/value' pairs to
  * the INI object.
@@ -373,6 +623,7 @@ int faux_ini_parse_file(faux_ini_t *ini, const char *fn)
 	bool_t eof = BOOL_FALSE;
 	faux_file_t *f = NULL;
 	char *buf = NULL;
+	char *section = NULL;
 
 	assert(ini);
 	assert(fn);
@@ -388,9 +639,10 @@ int faux_ini_parse_file(faux_ini_t *ini, const char *fn)
 	while ((buf = faux_file_getline(f))) {
 		// Don't analyze retval because it's not obvious what
 		// to do on error. May be next string will be ok.
-		faux_ini_parse_str(ini, buf);
+		faux_ini_parse_str_section(ini, buf, &section);
 		faux_str_free(buf);
 	}
+	faux_str_free(section);
 
 	eof = faux_file_eof(f);
 	faux_file_close(f);
@@ -401,21 +653,123 @@ int faux_ini_parse_file(faux_ini_t *ini, const char *fn)
 }
 
 
+/** Service function to format word with optional quotes.
+ *
+ * Word with spaces needs quotes. If buffer is NULL then function only
+ * calculates the length of formatted word.
+ *
+ * @param [out] buf Buffer to write formatted word to or NULL.
+ * @param [in] word Word to format.
+ * @return Length of formatted word.
+ */
+static size_t faux_ini_format_word(char *buf, const char *word)
+{
+	const char *spaces = " \t"; // String with spaces needs quotes
+	size_t len = strlen(word);
+	bool_t quoted = faux_str_chars(word, spaces) ? BOOL_TRUE : BOOL_FALSE;
+
+	if (buf) {
+		if (quoted)
+			*buf++ = '"';
+		memcpy(buf, word, len);
+		buf += len;
+		if (quoted)
+			*buf = '"';
+	}
+
+	return len + (quoted ? 2 : 0);
+}
+
+
+/** Service function to format pairs 'name/value' of the list.
+ *
+ * If buffer is NULL then function only calculates the length of
+ * formatted pairs.
+ *
+ * @param [out] buf Buffer to write formatted pairs to or NULL.
+ * @param [in] list List of pairs.
+ * @return Length of formatted pairs.
+ */
+static size_t faux_ini_format_pairs(char *buf, const faux_list_t *list)
+{
+	faux_ini_node_t *iter = NULL;
+	const faux_pair_t *pair = NULL;
+	size_t len = 0;
+
+	iter = (faux_ini_node_t *)faux_list_head(list);
+	while ((pair = faux_ini_each(&iter))) {
+		len += faux_ini_format_word(buf ? buf + len : NULL, pair->name);
+		if (buf)
+			buf[len] = '=';
+		len++;
+		len += faux_ini_format_word(buf ? buf + len : NULL, pair->value);
+		if (buf)
+			buf[len] = '\n';
+		len++;
+	}
+
+	return len;
+}
+
+
+/** Service function to format the whole INI object.
+ *
+ * Pairs outside of any section are formatted first. Then sections follow.
+ * If buffer is NULL then function only calculates the length of
+ * formatted INI object.
+ *
+ * @param [out] buf Buffer to write formatted INI object to or NULL.
+ * @param [in] ini Allocated and initialized INI object.
+ * @return Length of formatted INI object.
+ */
+static size_t faux_ini_format(char *buf, const faux_ini_t *ini)
+{
+	faux_ini_node_t *iter = NULL;
+	const faux_ini_section_t *section = NULL;
+	size_t len = 0;
+
+	len += faux_ini_format_pairs(buf, ini->list);
+
+	iter = faux_ini_sections_iter(ini);
+	while ((section = faux_ini_sections_each(&iter))) {
+		if (buf)
+			buf[len] = '[';
+		len++;
+		len += faux_ini_format_word(buf ? buf + len : NULL,
+			section->name);
+		if (buf) {
+			buf[len] = ']';
+			buf[len + 1] = '\n';
+		}
+		len += 2;
+		len += faux_ini_format_pairs(buf ? buf + len : NULL,
+			section->list);
+	}
+
+	return len;
+}
+
+
 /** Writes INI file using INI object.
  *
  * Write pairs 'name/value' to INI file. The source of pairs is an INI object.
- * It's complementary operation to faux_ini_parse_file().
+ * It's complementary operation to faux_ini_parse_file(). Pairs outside of
+ * any section are written first. Then sections follow.
+ *
+ * The whole INI object is formatted to the single buffer. Then it's written
+ * to the temporary file that replaces the destination file atomically. So
+ * readers never see a half-written file.
  *
  * @param [in] ini Allocated and initialized INI object.
  * @param [in] fn File name to write to.
  * @return 0 - success, < 0 - error
+ * @sa faux_write_whole_file()
  */
 int faux_ini_write_file(const faux_ini_t *ini, const char *fn)
 {
-	faux_file_t *f = NULL;
-	faux_ini_node_t *iter = NULL;
-	const faux_pair_t *pair = NULL;
-	const char *spaces = " \t"; // String with spaces needs quotes
+	char *buf = NULL;
+	size_t len = 0;
+	ssize_t bytes_written = 0;
 
 	assert(ini);
 	assert(fn);
@@ -424,42 +778,182 @@ int faux_ini_write_file(const faux_ini_t *ini, const char *fn)
 	if (!fn || '\0' == *fn)
 		return -1;
 
-	f = faux_file_open(fn, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-	if (!f)
+	len = faux_ini_format(NULL, ini);
+	if (len != 0) {
+		buf = faux_malloc(len);
+		assert(buf);
+		if (!buf)
+			return -1;
+		faux_ini_format(buf, ini);
+	}
+
+	bytes_written = faux_write_whole_file(fn, buf, len, 0644);
+	faux_free(buf);
+	if (bytes_written < 0)
 		return -1;
 
-	iter = faux_ini_iter(ini);
-	while ((pair = faux_ini_each(&iter))) {
-		char *quote_name = NULL;
-		char *quote_value = NULL;
-		const char *name = faux_pair_name(pair);
-		const char *value = faux_pair_value(pair);
-		char *line = NULL;
-		ssize_t bytes_written = 0;
-
-		// Word with spaces needs quotes
-		quote_name = faux_str_chars(name, spaces) ? "\"" : "";
-		quote_value = faux_str_chars(value, spaces) ? "\"" : "";
-
-		// Prepare INI line
-		line = faux_str_sprintf("%s%s%s=%s%s%s\n",
-			quote_name, name, quote_name,
-			quote_value, value, quote_value);
-		if (!line) {
-			faux_file_close(f);
-			return -1;
+	return 0;
+}
+
+
+/** @brief Applies new list of pairs to the existent one.
+ *
+ * Internal function. Both lists are sorted so they are walked
+ * simultaneously. The added pairs are inserted by faux_list_add() that
+ * searches for position from the list tail. So adding of pair costs up to
+ * the list length. Removed and changed pairs cost nothing extra.
+ *
+ * @param [in] list List of pairs to modify.
+ * @param [in] new_list List of pairs to get new values from. Can be NULL.
+ * @param [in] section Section name for callback.
+ * @param [in] change_cb Callback function. Can be NULL.
+ * @param [in] user_data User data for callback.
+ * @return Number of changes or < 0 on error.
+ */
+static int faux_ini_apply_pairs(faux_list_t *list, const faux_list_t *new_list,
+	const char *section, faux_ini_change_f *change_cb, void *user_data)
+{
+	faux_list_node_t *iter = faux_list_head(list);
+	faux_list_node_t *new_iter = new_list ? faux_list_head(new_list) : NULL;
+	int changes = 0;
+
+	while (iter || new_iter) {
+		faux_pair_t *pair = iter ? faux_list_data(iter) : NULL;
+		const faux_pair_t *new_pair =
+			new_iter ? faux_list_data(new_iter) : NULL;
+		int res = 0;
+
+		if (!pair)
+			res = 1;
+		else if (!new_pair)
+			res = -1;
+		else
+			res = strcmp(pair->name, new_pair->name);
+
+		// Removed pair
+		if (res < 0) {
+			faux_list_node_t *next = faux_list_next_node(iter);
+			faux_list_takeaway(list, iter);
+			if (change_cb)
+				change_cb(FAUX_INI_REMOVED, section, pair->name,
+					pair->value, NULL, user_data);
+			faux_pair_free(pair);
+			iter = next;
+			changes++;
+			continue;
 		}
 
-		// Write to file
-		bytes_written = faux_file_write(f, line, strlen(line));
-		faux_str_free(line);
-		if (bytes_written < 0) { // Can't write to file
-			faux_file_close(f);
-			return -1;
+		// Added pair
+		if (res > 0) {
+			faux_pair_t *added = faux_pair_new(new_pair->name,
+				new_pair->value);
+			if (!added)
+				return -1;
+			if (!faux_list_add(list, added)) {
+				faux_pair_free(added);
+				return -1;
+			}
+			if (change_cb)
+				change_cb(FAUX_INI_ADDED, section, added->name,
+					NULL, added->value, user_data);
+			new_iter = faux_list_next_node(new_iter);
+			changes++;
+			continue;
 		}
+
+		// Changed pair
+		if (strcmp(pair->value, new_pair->value) != 0) {
+			char *old_value = pair->value;
+			pair->value = faux_str_dup(new_pair->value);
+			if (change_cb)
+				change_cb(FAUX_INI_CHANGED, section, pair->name,
+					old_value, pair->value, user_data);
+			faux_str_free(old_value);
+			changes++;
+		}
+		iter = faux_list_next_node(iter);
+		new_iter = faux_list_next_node(new_iter);
 	}
 
-	faux_file_close(f);
+	return changes;
+}
 
-	return 0;
+
+/** @brief Applies content of another INI object in place.
+ *
+ * Function makes INI object equal to the new one. Only added, removed and
+ * changed pairs are touched so the unchanged pairs stay the same objects.
+ * The callback function is called for every change after the change is
+ * applied.
+ *
+ * It's used to reload INI file: parse new file to the temporary INI object
+ * and then apply it to the existent one.
+ *
+ * @param [in] ini Allocated and initialized INI object to modify.
+ * @param [in] new_ini INI object with new content.
+ * @param [in] change_cb Callback function. Can be NULL.
+ * @param [in] user_data User data for callback.
+ * @return Number of changes or < 0 on error.
+ */
+int faux_ini_apply(faux_ini_t *ini, const faux_ini_t *new_ini,
+	faux_ini_change_f *change_cb, void *user_data)
+{
+	faux_list_node_t *iter = NULL;
+	faux_list_node_t *new_iter = NULL;
+	int changes = 0;
+	int res = 0;
+
+	assert(ini);
+	assert(new_ini);
+	if (!ini || !new_ini)
+		return -1;
+
+	// Pairs outside of any section
+	res = faux_ini_apply_pairs(ini->list, new_ini->list, NULL,
+		change_cb, user_data);
+	if (res < 0)
+		return -1;
+	changes += res;
+
+	// Sections
+	iter = faux_list_head(ini->sections);
+	new_iter = faux_list_head(new_ini->sections);
+	while (iter || new_iter) {
+		faux_ini_section_t *section = iter ? faux_list_data(iter) : NULL;
+		const faux_ini_section_t *new_section =
+			new_iter ? faux_list_data(new_iter) : NULL;
+		faux_list_t *new_list = NULL;
+		int cmp = 0;
+
+		if (!section)
+			cmp = 1;
+		else if (!new_section)
+			cmp = -1;
+		else
+			cmp = strcmp(section->name, new_section->name);
+
+		if (cmp > 0) { // Added section
+			section = faux_ini_section_add(ini, new_section->name);
+			if (!section)
+				return -1;
+		} else {
+			iter = faux_list_next_node(iter);
+		}
+		if (cmp >= 0) {
+			new_list = new_section->list;
+			new_iter = faux_list_next_node(new_iter);
+		}
+
+		res = faux_ini_apply_pairs(section->list, new_list,
+			section->name, change_cb, user_data);
+		if (res < 0)
+			return -1;
+		changes += res;
+
+		// Remove section that doesn't exist anymore
+		if (cmp < 0)
+			faux_list_kdel(ini->sections, section->name);
+	}
+
+	return changes;
 }
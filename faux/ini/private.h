@@ -1,5 +1,8 @@
+#include <sys/stat.h>
+
 #include "faux/faux.h"
 #include "faux/list.h"
+#include "faux/eloop.h"
 #include "faux/ini.h"
 
 struct faux_pair_s {
@@ -7,8 +10,26 @@ struct faux_pair_s {
 	char *value;
 };
 
+struct faux_ini_section_s {
+	char *name;
+	faux_list_t *list; // Pairs 'name/value' of section
+};
+
 struct faux_ini_s {
-	faux_list_t *list;
+	faux_list_t *list; // Pairs outside of any section
+	faux_list_t *sections; // Named sections
+};
+
+struct faux_ini_watch_s {
+	faux_ini_t *ini; // INI object to update
+	char *fn; // INI file name
+	char *basename; // INI file name without directory
+	int fd; // inotify descriptor
+	struct stat st; // Last seen state of INI file
+	bool_t exists; // Is INI file exists
+	faux_ini_change_f *change_cb;
+	void *user_data;
+	faux_eloop_t *eloop; // Attached event loop
 };
 
 C_DECL_BEGIN
@@ -21,4 +42,9 @@ void faux_pair_free(void *pair);
 void faux_pair_set_name(faux_pair_t *pair, const char *name);
 void faux_pair_set_value(faux_pair_t *pair, const char *value);
 
+int faux_ini_section_compare(const void *first, const void *second);
+int faux_ini_section_kcompare(const void *key, const void *list_item);
+faux_ini_section_t *faux_ini_section_new(const char *name);
+void faux_ini_section_free(void *section);
+
 C_DECL_END
@@ -0,0 +1,68 @@
+/** @file section.c
+ * Ini file sections. Each section has its own list of pairs 'name/value'.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "private.h"
+#include "faux/str.h"
+#include "faux/ini.h"
+
+int faux_ini_section_compare(const void *first, const void *second)
+{
+	const faux_ini_section_t *f = (const faux_ini_section_t *)first;
+	const faux_ini_section_t *s = (const faux_ini_section_t *)second;
+
+	return strcmp(f->name, s->name);
+}
+
+
+int faux_ini_section_kcompare(const void *key, const void *list_item)
+{
+	const char *f = (const char *)key;
+	const faux_ini_section_t *s = (const faux_ini_section_t *)list_item;
+
+	return strcmp(f, s->name);
+}
+
+
+faux_ini_section_t *faux_ini_section_new(const char *name)
+{
+	faux_ini_section_t *section = NULL;
+
+	section = faux_zmalloc(sizeof(*section));
+	assert(section);
+	if (!section)
+		return NULL;
+
+	// Initialize
+	section->name = faux_str_dup(name);
+	section->list = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_UNIQUE,
+		faux_pair_compare, faux_pair_kcompare, faux_pair_free);
+
+	return section;
+}
+
+
+void faux_ini_section_free(void *ptr)
+{
+	faux_ini_section_t *section = (faux_ini_section_t *)ptr;
+
+	if (!section)
+		return;
+	faux_list_free(section->list);
+	faux_str_free(section->name);
+	faux_free(section);
+}
+
+
+const char *faux_ini_section_name(const faux_ini_section_t *section)
+{
+	assert(section);
+	if (!section)
+		return NULL;
+
+	return section->name;
+}
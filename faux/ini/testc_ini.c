@@ -1,5 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "faux/str.h"
 #include "faux/ini.h"
@@ -90,3 +93,323 @@ parse_error:
 
 	return ret;
 }
+
+
+int testc_faux_ini_sections(void)
+{
+	// Source INI file
+	const char *src_file =
+		"# Comment\n"
+		"GLOBAL_VAR=global\n"
+		"[net]\n"
+		"ADDR = 10.0.0.1\n"
+		"PORT=8080\n"
+		"  [ \"log files\" ]  \n"
+		"PATH=/var/log\n"
+		"[]\n"
+		"ANOTHER_GLOBAL=yes\n"
+		"[empty]\n"
+		"[net]\n"
+		"PORT=9090\n"
+	;
+
+	// Etalon file
+	const char *etalon_file =
+		"ANOTHER_GLOBAL=yes\n"
+		"GLOBAL_VAR=global\n"
+		"[empty]\n"
+		"[\"log files\"]\n"
+		"PATH=/var/log\n"
+		"[net]\n"
+		"ADDR=10.0.0.1\n"
+		"PORT=9090\n"
+		"[new]\n"
+		"PORT=1\n"
+	;
+
+	int ret = -1; // Pessimistic return value
+	faux_ini_t *ini = NULL;
+	faux_ini_node_t *iter = NULL;
+	const faux_pair_t *pair = NULL;
+	const char *val = NULL;
+	unsigned int num = 0;
+	char *src_fn = NULL;
+	char *dst_fn = NULL;
+	char *etalon_fn = NULL;
+
+	// Prepare files
+	src_fn = faux_testc_tmpfile_deploy(src_file);
+	etalon_fn = faux_testc_tmpfile_deploy(etalon_file);
+	dst_fn = faux_str_sprintf("%s/dst", getenv(FAUX_TESTC_TMPDIR_ENV));
+
+	ini = faux_ini_new();
+	if (faux_ini_parse_file(ini, src_fn) < 0) {
+		fprintf(stderr, "Can't parse INI file %s\n", src_fn);
+		goto parse_error;
+	}
+
+	// Section's pairs are not visible outside of section
+	if (faux_ini_find(ini, "PORT")) {
+		fprintf(stderr, "Section pair is found outside of section\n");
+		goto parse_error;
+	}
+	val = faux_ini_section_find(ini, "net", "PORT");
+	if (!val || strcmp(val, "9090") != 0) {
+		fprintf(stderr, "Wrong value of [net] PORT\n");
+		goto parse_error;
+	}
+	if (faux_ini_section_find(ini, "unknown", "PORT")) {
+		fprintf(stderr, "Pair is found within unknown section\n");
+		goto parse_error;
+	}
+
+	// Iterate single section
+	iter = faux_ini_section_iter(ini, "net");
+	while ((pair = faux_ini_each(&iter)))
+		num++;
+	if (num != 2) {
+		fprintf(stderr, "Wrong number of [net] pairs: %u\n", num);
+		goto parse_error;
+	}
+
+	faux_ini_section_set(ini, "new", "PORT", "1");
+	faux_ini_section_unset(ini, "net", "UNKNOWN");
+	if (faux_ini_write_file(ini, dst_fn) < 0) {
+		fprintf(stderr, "Can't write INI file %s\n", dst_fn);
+		goto parse_error;
+	}
+
+	if (faux_testc_file_cmp(dst_fn, etalon_fn) != 0) {
+		fprintf(stderr, "Generated file %s is not equal to etalon %s\n",
+		dst_fn, etalon_fn);
+		goto parse_error;
+	}
+
+	ret = 0; // success
+
+parse_error:
+	faux_ini_free(ini);
+	faux_str_free(dst_fn);
+	faux_str_free(src_fn);
+	faux_str_free(etalon_fn);
+
+	return ret;
+}
+
+
+int testc_faux_ini_cache(void)
+{
+	// Source INI file
+	const char *src_file =
+		"GLOBAL_VAR=global\n"
+		"PORT=1\n"
+		"[net]\n"
+		"ADDR = 10.0.0.1\n"
+		"PORT=8080\n"
+		"[log]\n"
+		"PATH=\"/var/log/some file\"\n"
+	;
+
+	int ret = -1; // Pessimistic return value
+	faux_ini_t *ini = NULL;
+	faux_ini_t *loaded_ini = NULL;
+	faux_ini_cache_t *cache = NULL;
+	const char *val = NULL;
+	char *src_fn = NULL;
+	char *cache_fn = NULL;
+	char *new_fn = NULL;
+	struct stat st = {};
+	struct timespec times[2] = {};
+
+	// Prepare files
+	src_fn = faux_testc_tmpfile_deploy(src_file);
+	cache_fn = faux_str_sprintf("%s/cache", getenv(FAUX_TESTC_TMPDIR_ENV));
+
+	ini = faux_ini_new();
+	if (faux_ini_parse_file(ini, src_fn) < 0) {
+		fprintf(stderr, "Can't parse INI file %s\n", src_fn);
+		goto parse_error;
+	}
+	if (faux_ini_cache_write(ini, src_fn, cache_fn) < 0) {
+		fprintf(stderr, "Can't write cache file %s\n", cache_fn);
+		goto parse_error;
+	}
+
+	cache = faux_ini_cache_open(cache_fn, src_fn);
+	if (!cache) {
+		fprintf(stderr, "Can't open cache file %s\n", cache_fn);
+		goto parse_error;
+	}
+	if (faux_ini_cache_len(cache) != 5) {
+		fprintf(stderr, "Wrong number of cached pairs\n");
+		goto parse_error;
+	}
+	val = faux_ini_cache_find(cache, NULL, "PORT");
+	if (!val || strcmp(val, "1") != 0) {
+		fprintf(stderr, "Wrong value of global PORT\n");
+		goto parse_error;
+	}
+	val = faux_ini_cache_find(cache, "net", "PORT");
+	if (!val || strcmp(val, "8080") != 0) {
+		fprintf(stderr, "Wrong value of [net] PORT\n");
+		goto parse_error;
+	}
+	if (faux_ini_cache_find(cache, "log", "PORT")) {
+		fprintf(stderr, "Found [log] PORT but it doesn't exist\n");
+		goto parse_error;
+	}
+
+	// Load INI object from cache
+	loaded_ini = faux_ini_new();
+	if (faux_ini_cache_load(cache, loaded_ini) < 0) {
+		fprintf(stderr, "Can't load INI object from cache\n");
+		goto parse_error;
+	}
+	val = faux_ini_section_find(loaded_ini, "log", "PATH");
+	if (!val || strcmp(val, "/var/log/some file") != 0) {
+		fprintf(stderr, "Wrong value of loaded [log] PATH\n");
+		goto parse_error;
+	}
+	faux_ini_cache_close(cache);
+	cache = NULL;
+
+	// Replaced source file with the same size and mtime makes cache stale
+	new_fn = faux_str_sprintf("%s.new", src_fn);
+	if ((faux_testc_file_deploy(new_fn, src_file) < 0) ||
+		(stat(src_fn, &st) < 0)) {
+		fprintf(stderr, "Can't deploy INI file %s\n", new_fn);
+		goto parse_error;
+	}
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	if ((utimensat(AT_FDCWD, new_fn, times, 0) < 0) ||
+		(rename(new_fn, src_fn) < 0)) {
+		fprintf(stderr, "Can't replace INI file %s\n", src_fn);
+		goto parse_error;
+	}
+	cache = faux_ini_cache_open(cache_fn, src_fn);
+	if (cache) {
+		fprintf(stderr, "Cache of replaced file was opened\n");
+		goto parse_error;
+	}
+
+	// Changed source file makes cache stale
+	if (faux_testc_file_deploy(src_fn, "GLOBAL_VAR=changed\n") < 0) {
+		fprintf(stderr, "Can't change INI file %s\n", src_fn);
+		goto parse_error;
+	}
+	cache = faux_ini_cache_open(cache_fn, src_fn);
+	if (cache) {
+		fprintf(stderr, "Stale cache file was opened\n");
+		goto parse_error;
+	}
+
+	ret = 0; // success
+
+parse_error:
+	faux_ini_cache_close(cache);
+	faux_ini_free(loaded_ini);
+	faux_ini_free(ini);
+	faux_str_free(cache_fn);
+	faux_str_free(new_fn);
+	faux_str_free(src_fn);
+
+	return ret;
+}
+
+
+static void testc_faux_ini_change_cb(faux_ini_change_e change,
+	const char *section, const char *name, const char *old_value,
+	const char *new_value, void *user_data)
+{
+	unsigned int *counters = (unsigned int *)user_data;
+
+	counters[change]++;
+	printf("%d: [%s] %s = %s -> %s\n", change, section ? section : "",
+		name, old_value ? old_value : "", new_value ? new_value : "");
+}
+
+
+int testc_faux_ini_watch(void)
+{
+	// Source INI file
+	const char *src_file =
+		"UNCHANGED=1\n"
+		"CHANGED=1\n"
+		"REMOVED=1\n"
+		"[net]\n"
+		"PORT=8080\n"
+		"[old]\n"
+		"VAR=1\n"
+	;
+
+	// New INI file
+	const char *new_file =
+		"ADDED=1\n"
+		"UNCHANGED=1\n"
+		"CHANGED=2\n"
+		"[net]\n"
+		"PORT=8080\n"
+		"ADDR=10.0.0.1\n"
+		"[new]\n"
+		"VAR=1\n"
+	;
+
+	int ret = -1; // Pessimistic return value
+	faux_ini_t *ini = NULL;
+	faux_ini_watch_t *watch = NULL;
+	unsigned int counters[3] = {};
+	char *src_fn = NULL;
+
+	// Prepare files
+	src_fn = faux_testc_tmpfile_deploy(src_file);
+
+	ini = faux_ini_new();
+	if (faux_ini_parse_file(ini, src_fn) < 0) {
+		fprintf(stderr, "Can't parse INI file %s\n", src_fn);
+		goto parse_error;
+	}
+	watch = faux_ini_watch_new(ini, src_fn,
+		testc_faux_ini_change_cb, counters);
+	if (!watch) {
+		fprintf(stderr, "Can't create watch object\n");
+		goto parse_error;
+	}
+
+	// File is unchanged
+	if (faux_ini_watch_reload(watch) != 0) {
+		fprintf(stderr, "Unchanged file was reloaded\n");
+		goto parse_error;
+	}
+
+	if (faux_testc_file_deploy(src_fn, new_file) < 0) {
+		fprintf(stderr, "Can't change INI file %s\n", src_fn);
+		goto parse_error;
+	}
+	if (faux_ini_watch_reload(watch) != 6) {
+		fprintf(stderr, "Wrong number of changes\n");
+		goto parse_error;
+	}
+	if ((counters[FAUX_INI_ADDED] != 3) ||
+		(counters[FAUX_INI_REMOVED] != 2) ||
+		(counters[FAUX_INI_CHANGED] != 1)) {
+		fprintf(stderr, "Wrong change counters\n");
+		goto parse_error;
+	}
+	if (!faux_ini_section_find(ini, "net", "ADDR") ||
+		faux_ini_find(ini, "REMOVED") ||
+		faux_ini_section_find(ini, "old", "VAR") ||
+		(strcmp(faux_ini_find(ini, "CHANGED"), "2") != 0)) {
+		fprintf(stderr, "INI object doesn't match new file\n");
+		goto parse_error;
+	}
+
+	ret = 0; // success
+
+parse_error:
+	faux_ini_watch_free(watch);
+	faux_ini_free(ini);
+	faux_str_free(src_fn);
+
+	return ret;
+}
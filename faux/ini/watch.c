@@ -0,0 +1,321 @@
+/** @file watch.c
+ * @brief Watch for INI file changes and reload it incrementally.
+ *
+ * The watch object uses inotify to get notifications about INI file
+ * changes. The directory containing the file is watched but not the file
+ * itself because editors and faux_ini_write_file() replace the file by
+ * rename(). So the file's inode is not persistent.
+ *
+ * On change the file is parsed to the temporary INI object and then it's
+ * applied to the existent INI object by faux_ini_apply(). So consumers
+ * get notification about changed pairs only. The file is not reparsed if
+ * its inode, size and modification time are the same as before.
+ *
+ * If inotify is not supported then user can call faux_ini_watch_reload()
+ * periodically.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <poll.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include "private.h"
+#include "faux/faux.h"
+#include "faux/str.h"
+#include "faux/eloop.h"
+#include "faux/ini.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#define FAUX_INI_WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | \
+	IN_DELETE | IN_MOVED_FROM)
+#endif
+
+
+/** @brief Checks if INI file was changed since the last saved state.
+ *
+ * Function doesn't save the new state of file. The caller saves it by
+ * faux_ini_watch_save() when file is processed successfully. So failed
+ * processing will be retried on the next check.
+ *
+ * @param [in] watch Watch object.
+ * @param [out] st Current state of file.
+ * @param [out] exists Is file exists now.
+ * @return BOOL_TRUE if file was changed else BOOL_FALSE.
+ */
+static bool_t faux_ini_watch_is_changed(const faux_ini_watch_t *watch,
+	struct stat *st, bool_t *exists)
+{
+	*exists = BOOL_FALSE;
+	if (stat(watch->fn, st) == 0)
+		*exists = BOOL_TRUE;
+	if (!*exists && !watch->exists)
+		return BOOL_FALSE;
+	if (*exists && watch->exists &&
+		(st->st_ino == watch->st.st_ino) &&
+		(st->st_dev == watch->st.st_dev) &&
+		(st->st_size == watch->st.st_size) &&
+		(st->st_mtim.tv_sec == watch->st.st_mtim.tv_sec) &&
+		(st->st_mtim.tv_nsec == watch->st.st_mtim.tv_nsec))
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Saves state of INI file.
+ *
+ * @param [in] watch Watch object.
+ * @param [in] st State of file.
+ * @param [in] exists Is file exists.
+ */
+static void faux_ini_watch_save(faux_ini_watch_t *watch,
+	const struct stat *st, bool_t exists)
+{
+	watch->exists = exists;
+	watch->st = *st;
+}
+
+
+/** @brief Allocates watch object for INI file.
+ *
+ * The INI object is expected to be already parsed from the file. The
+ * current state of file is remembered so the following
+ * faux_ini_watch_reload() will reparse file only if it's changed.
+ *
+ * @param [in] ini Allocated and initialized INI object.
+ * @param [in] fn INI file name.
+ * @param [in] change_cb Callback function to call on every changed pair.
+ * @param [in] user_data User data for callback function.
+ * @return Allocated watch object or NULL on error.
+ */
+faux_ini_watch_t *faux_ini_watch_new(faux_ini_t *ini, const char *fn,
+	faux_ini_change_f *change_cb, void *user_data)
+{
+	faux_ini_watch_t *watch = NULL;
+	const char *slash = NULL;
+	struct stat st = {};
+	bool_t exists = BOOL_FALSE;
+
+	assert(ini);
+	assert(fn);
+	if (!ini || !fn || ('\0' == *fn))
+		return NULL;
+
+	watch = faux_zmalloc(sizeof(*watch));
+	assert(watch);
+	if (!watch)
+		return NULL;
+
+	// Init
+	watch->ini = ini;
+	watch->fn = faux_str_dup(fn);
+	watch->change_cb = change_cb;
+	watch->user_data = user_data;
+	watch->fd = -1;
+	watch->eloop = NULL;
+	watch->exists = BOOL_FALSE;
+	faux_ini_watch_is_changed(watch, &st, &exists);
+	faux_ini_watch_save(watch, &st, exists);
+
+	slash = strrchr(fn, '/');
+	watch->basename = faux_str_dup(slash ? (slash + 1) : fn);
+
+#ifdef HAVE_SYS_INOTIFY_H
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd >= 0) {
+		char *dir = slash ? faux_str_dupn(fn, slash - fn) :
+			faux_str_dup(".");
+		if ('\0' == *dir) { // File within root directory
+			faux_str_free(dir);
+			dir = faux_str_dup("/");
+		}
+		if (inotify_add_watch(watch->fd, dir, FAUX_INI_WATCH_MASK) < 0) {
+			close(watch->fd);
+			watch->fd = -1;
+		}
+		faux_str_free(dir);
+	}
+#endif
+
+	return watch;
+}
+
+
+/** @brief Frees watch object.
+ *
+ * Detaches object from event loop if it was attached.
+ *
+ * @param [in] watch Watch object.
+ */
+void faux_ini_watch_free(faux_ini_watch_t *watch)
+{
+	if (!watch)
+		return;
+
+	faux_ini_watch_detach(watch);
+	if (watch->fd >= 0)
+		close(watch->fd);
+	faux_str_free(watch->basename);
+	faux_str_free(watch->fn);
+	faux_free(watch);
+}
+
+
+/** @brief Returns notification file descriptor.
+ *
+ * The descriptor becomes readable when directory containing INI file was
+ * changed.
+ *
+ * @param [in] watch Watch object.
+ * @return File descriptor or < 0 if notifications are not supported.
+ */
+int faux_ini_watch_fd(const faux_ini_watch_t *watch)
+{
+	assert(watch);
+	if (!watch)
+		return -1;
+
+	return watch->fd;
+}
+
+
+/** @brief Reloads INI file if it was changed.
+ *
+ * The removed file is considered as empty one.
+ *
+ * @param [in] watch Watch object.
+ * @return Number of changed pairs, 0 if file is unchanged, < 0 on error.
+ */
+int faux_ini_watch_reload(faux_ini_watch_t *watch)
+{
+	faux_ini_t *new_ini = NULL;
+	int changes = 0;
+	struct stat st = {};
+	bool_t exists = BOOL_FALSE;
+
+	assert(watch);
+	if (!watch)
+		return -1;
+
+	if (!faux_ini_watch_is_changed(watch, &st, &exists))
+		return 0;
+
+	new_ini = faux_ini_new();
+	if (!new_ini)
+		return -1;
+	if (exists && (faux_ini_parse_file(new_ini, watch->fn) < 0)) {
+		faux_ini_free(new_ini);
+		return -1;
+	}
+	changes = faux_ini_apply(watch->ini, new_ini,
+		watch->change_cb, watch->user_data);
+	faux_ini_free(new_ini);
+	// The new state is saved only when file is applied. So failed
+	// reload will be retried.
+	if (changes >= 0)
+		faux_ini_watch_save(watch, &st, exists);
+
+	return changes;
+}
+
+
+#ifdef HAVE_SYS_INOTIFY_H
+/** @brief Event loop callback to process inotify events.
+ */
+static bool_t faux_ini_watch_eloop_cb(faux_eloop_t *eloop,
+	faux_eloop_type_e type, void *associated_data, void *user_data)
+{
+	faux_ini_watch_t *watch = (faux_ini_watch_t *)user_data;
+	char buf[4096]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool_t matched = BOOL_FALSE;
+	ssize_t len = 0;
+
+	// Drain all pending events
+	while ((len = read(watch->fd, buf, sizeof(buf))) > 0) {
+		char *ptr = buf;
+		while (ptr < buf + len) {
+			const struct inotify_event *event =
+				(const struct inotify_event *)ptr;
+			// Some events are lost on queue overflow. So
+			// check the file anyway.
+			if (event->mask & IN_Q_OVERFLOW)
+				matched = BOOL_TRUE;
+			else if ((event->len > 0) &&
+				(strcmp(event->name, watch->basename) == 0))
+				matched = BOOL_TRUE;
+			ptr += sizeof(*event) + event->len;
+		}
+	}
+
+	if (matched)
+		faux_ini_watch_reload(watch);
+
+	return BOOL_TRUE;
+}
+#endif
+
+
+/** @brief Attaches watch object to event loop.
+ *
+ * Event loop will reload INI file on changes.
+ *
+ * @param [in] watch Watch object.
+ * @param [in] eloop Event loop.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_ini_watch_attach(faux_ini_watch_t *watch, faux_eloop_t *eloop)
+{
+	assert(watch);
+	assert(eloop);
+	if (!watch || !eloop)
+		return BOOL_FALSE;
+	if (watch->eloop) // Already attached
+		return BOOL_FALSE;
+	if (watch->fd < 0)
+		return BOOL_FALSE;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if (!faux_eloop_add_fd(eloop, watch->fd, POLLIN,
+		faux_ini_watch_eloop_cb, watch))
+		return BOOL_FALSE;
+	watch->eloop = eloop;
+
+	return BOOL_TRUE;
+#else
+	return BOOL_FALSE;
+#endif
+}
+
+
+/** @brief Detaches watch object from event loop.
+ *
+ * @param [in] watch Watch object.
+ * @return BOOL_TRUE - success, BOOL_FALSE on error.
+ */
+bool_t faux_ini_watch_detach(faux_ini_watch_t *watch)
+{
+	assert(watch);
+	if (!watch)
+		return BOOL_FALSE;
+	if (!watch->eloop)
+		return BOOL_FALSE;
+
+	faux_eloop_del_fd(watch->eloop, watch->fd);
+	watch->eloop = NULL;
+
+	return BOOL_TRUE;
+}
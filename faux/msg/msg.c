@@ -651,6 +651,10 @@ ssize_t faux_msg_send(faux_msg_t *msg, faux_net_t *faux_net)
  * - Interrupted by allowed signal (see signal mask).
  * - Timeout.
  *
+ * The message is received by several faux_net_recv() calls. Enable receive
+ * buffer by faux_net_set_recv_buf() to receive small messages by single
+ * syscall.
+ *
  * @param [in] faux_net Preinitialized faux_net_t object.
  * @param [out] status Status while message receiving. Can be NULL.
  * @return Allocated faux_msg_t object. Object contains received message.
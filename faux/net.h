@@ -11,6 +11,9 @@ typedef struct faux_net_s faux_net_t;
 typedef struct faux_pollfd_s faux_pollfd_t;
 typedef int faux_pollfd_iterator_t;
 
+// Defined by <sys/socket.h> with _GNU_SOURCE only
+struct mmsghdr;
+
 
 C_DECL_BEGIN
 
@@ -35,6 +38,27 @@ ssize_t faux_recvv(int fd, struct iovec *iov, int iovcnt,
 ssize_t faux_recvv_block(int fd, struct iovec *iov, int iovcnt,
 	const struct timespec *timeout, const sigset_t *sigmask,
 	int (*isbreak_func)(void));
+ssize_t faux_send_zerocopy(int fd, const void *buf, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	bool_t *copied);
+ssize_t faux_send_zerocopy_block(int fd, const void *buf, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void), bool_t *copied);
+ssize_t faux_sendfile(int fd, int in_fd, off_t *offset, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask);
+ssize_t faux_sendfile_block(int fd, int in_fd, off_t *offset, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void));
+int faux_sendmm(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask);
+int faux_sendmm_block(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void));
+int faux_recvmm(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask);
+int faux_recvmm_block(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void));
 
 // Network class
 faux_net_t *faux_net_new(void);
@@ -55,8 +79,23 @@ ssize_t faux_net_sendv(faux_net_t *faux_net,
 	const struct iovec *iov, int iovcnt);
 ssize_t faux_net_recv(faux_net_t *faux_net, void *buf, size_t n);
 ssize_t faux_net_recvv(faux_net_t *faux_net, struct iovec *iov, int iovcnt);
+bool_t faux_net_set_recv_buf(faux_net_t *faux_net, size_t size);
+size_t faux_net_recv_buffered(const faux_net_t *faux_net);
+bool_t faux_net_set_zerocopy(faux_net_t *faux_net, bool_t enable);
+ssize_t faux_net_sendfile(faux_net_t *faux_net, int in_fd, off_t *offset,
+	size_t n);
+int faux_net_sendmm(faux_net_t *faux_net, struct mmsghdr *msgs,
+	unsigned int vlen);
+int faux_net_recvmm(faux_net_t *faux_net, struct mmsghdr *msgs,
+	unsigned int vlen);
 
 // Pollfd class
+// Items are kept within contiguous vector to pass it to poll() directly.
+// The faux_pollfd_del_by_index() and faux_pollfd_del_by_fd() move the last
+// item to the place of removed one. So the order of items is not preserved
+// and pointers to the last item become invalid. While iterating the current
+// item can be removed but the iterator must be decremented then to visit
+// the moved item.
 faux_pollfd_t *faux_pollfd_new(void);
 void faux_pollfd_free(faux_pollfd_t *faux_pollfd);
 struct pollfd *faux_pollfd_vector(faux_pollfd_t *faux_pollfd);
@@ -6,8 +6,22 @@
  * signals and remove race conditions. It's hard to specify all necessary
  * parameter as a function argument so class hides long functions from user.
  * Parameters of sending or receving can be specified using class methods.
+ *
+ * The optional receive buffer can be enabled by faux_net_set_recv_buf().
+ * The receive functions read as much data as available then and serve the
+ * subsequent calls from memory. It's useful when data is received by small
+ * portions like faux_msg_recv() does. Note the buffered data is not
+ * visible to poll(). So check faux_net_recv_buffered() before waiting for
+ * socket events.
+ *
+ * The large buffers can be sent without copying to kernel. See
+ * faux_net_set_zerocopy() and faux_net_sendfile().
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -46,6 +60,11 @@ faux_net_t *faux_net_new(void)
 
 	faux_net->fd = -1;
 	faux_net->isbreak_func = NULL;
+	faux_net->recv_buf = NULL;
+	faux_net->recv_buf_size = 0;
+	faux_net->recv_buf_pos = 0;
+	faux_net->recv_buf_len = 0;
+	faux_net->zerocopy = BOOL_FALSE;
 	faux_net_sigmask_fill(faux_net);
 	faux_net_set_timeout(faux_net, NULL);
 
@@ -61,6 +80,7 @@ void faux_net_free(faux_net_t *faux_net)
 {
 	if (!faux_net)
 		return;
+	faux_free(faux_net->recv_buf);
 	faux_free(faux_net);
 }
 
@@ -77,6 +97,10 @@ void faux_net_set_fd(faux_net_t *faux_net, int fd)
 	if (!faux_net)
 		return;
 	faux_net->fd = fd;
+	// Buffered data and options belong to previous descriptor
+	faux_net->recv_buf_pos = 0;
+	faux_net->recv_buf_len = 0;
+	faux_net->zerocopy = BOOL_FALSE;
 }
 
 
@@ -89,6 +113,9 @@ void faux_net_unset_fd(faux_net_t *faux_net)
 	if (!faux_net)
 		return;
 	faux_net->fd = -1;
+	faux_net->recv_buf_pos = 0;
+	faux_net->recv_buf_len = 0;
+	faux_net->zerocopy = BOOL_FALSE;
 }
 
 
@@ -230,6 +257,167 @@ void faux_net_sigmask_del(faux_net_t *faux_net, int signum)
 }
 
 
+/** @brief Sets size of receive buffer.
+ *
+ * The receive buffer is used to read ahead data. Then small portions of
+ * data can be received without syscalls. The buffer size can't be less
+ * than number of currently buffered bytes.
+ *
+ * @param [in] faux_net The faux_net_t object.
+ * @param [in] size Size of buffer. 0 - disable buffer.
+ * @return BOOL_TRUE - success, BOOL_FALSE - error.
+ */
+bool_t faux_net_set_recv_buf(faux_net_t *faux_net, size_t size)
+{
+	char *new_buf = NULL;
+
+	assert(faux_net);
+	if (!faux_net)
+		return BOOL_FALSE;
+	if (size < faux_net->recv_buf_len)
+		return BOOL_FALSE;
+
+	if (0 == size) {
+		faux_free(faux_net->recv_buf);
+		faux_net->recv_buf = NULL;
+		faux_net->recv_buf_size = 0;
+		faux_net->recv_buf_pos = 0;
+		return BOOL_TRUE;
+	}
+
+	// Move buffered data to the beginning
+	if ((faux_net->recv_buf_len > 0) && (faux_net->recv_buf_pos > 0))
+		memmove(faux_net->recv_buf,
+			faux_net->recv_buf + faux_net->recv_buf_pos,
+			faux_net->recv_buf_len);
+	faux_net->recv_buf_pos = 0;
+	new_buf = realloc(faux_net->recv_buf, size);
+	if (!new_buf)
+		return BOOL_FALSE;
+	faux_net->recv_buf = new_buf;
+	faux_net->recv_buf_size = size;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Gets number of bytes within receive buffer.
+ *
+ * The buffered data is not visible to poll(). So user must check buffered
+ * data before waiting for socket.
+ *
+ * @param [in] faux_net The faux_net_t object.
+ * @return Number of buffered bytes.
+ */
+size_t faux_net_recv_buffered(const faux_net_t *faux_net)
+{
+	assert(faux_net);
+	if (!faux_net)
+		return 0;
+
+	return faux_net->recv_buf_len;
+}
+
+
+/** @brief Enables zerocopy sending of large buffers.
+ *
+ * The SO_ZEROCOPY option is set on socket. Then faux_net_send() sends
+ * large buffers with MSG_ZEROCOPY flag. It's supported by TCP sockets.
+ * The zerocopy is disabled automatically if kernel reports it copies data
+ * anyway (for example for loopback interface). The descriptor must be set
+ * before. Note the send of large buffer waits until peer acknowledges data.
+ *
+ * @param [in] faux_net The faux_net_t object.
+ * @param [in] enable BOOL_TRUE - enable, BOOL_FALSE - disable.
+ * @return BOOL_TRUE - success, BOOL_FALSE - zerocopy is not supported.
+ */
+bool_t faux_net_set_zerocopy(faux_net_t *faux_net, bool_t enable)
+{
+#ifdef HAVE_MSG_ZEROCOPY
+	int one = 1;
+#endif
+
+	assert(faux_net);
+	if (!faux_net)
+		return BOOL_FALSE;
+	if (!enable) {
+		faux_net->zerocopy = BOOL_FALSE;
+		return BOOL_TRUE;
+	}
+	if (faux_net->fd < 0)
+		return BOOL_FALSE;
+
+#ifdef HAVE_MSG_ZEROCOPY
+	if (setsockopt(faux_net->fd, SOL_SOCKET, SO_ZEROCOPY,
+		&one, sizeof(one)) < 0)
+		return BOOL_FALSE;
+	faux_net->zerocopy = BOOL_TRUE;
+
+	return BOOL_TRUE;
+#else
+	return BOOL_FALSE;
+#endif
+}
+
+
+/** @brief Gets data from receive buffer.
+ *
+ * @param [in] faux_net The faux_net_t object.
+ * @param [out] buf Data buffer for receiving.
+ * @param [in] n Max number of bytes to get.
+ * @return Number of bytes got from buffer.
+ */
+static size_t faux_net_recv_buf_get(faux_net_t *faux_net, void *buf, size_t n)
+{
+	size_t len = faux_net->recv_buf_len;
+
+	if (len > n)
+		len = n;
+	if (0 == len)
+		return 0;
+	memcpy(buf, faux_net->recv_buf + faux_net->recv_buf_pos, len);
+	faux_net->recv_buf_pos += len;
+	faux_net->recv_buf_len -= len;
+	if (0 == faux_net->recv_buf_len)
+		faux_net->recv_buf_pos = 0;
+
+	return len;
+}
+
+
+/** @brief Receives data to iov array and reads ahead to receive buffer.
+ *
+ * The receive buffer must be empty. The last member of iov array is
+ * reserved for the receive buffer.
+ *
+ * @param [in] faux_net The faux_net_t object.
+ * @param [in] iov Array of struct iovec structures.
+ * @param [in] iovcnt Number of iov array members including reserved one.
+ * @param [in] n Number of bytes user wants to receive.
+ * @return Number of bytes was succesfully received or < 0 on error.
+ */
+static ssize_t faux_net_recv_ahead(faux_net_t *faux_net,
+	struct iovec *iov, int iovcnt, size_t n)
+{
+	ssize_t bytes_readed = 0;
+
+	iov[iovcnt - 1].iov_base = faux_net->recv_buf;
+	iov[iovcnt - 1].iov_len = faux_net->recv_buf_size;
+	bytes_readed = faux_recvv_min_block(faux_net->fd, iov, iovcnt, n,
+		faux_net->recv_timeout, &(faux_net->sigmask),
+		faux_net->isbreak_func);
+	if (bytes_readed <= 0)
+		return bytes_readed;
+	if ((size_t)bytes_readed > n) {
+		faux_net->recv_buf_pos = 0;
+		faux_net->recv_buf_len = bytes_readed - n;
+		bytes_readed = n;
+	}
+
+	return bytes_readed;
+}
+
+
 /** @brief Sends data to socket associated with given objects.
  *
  * Function uses previously set parameters such as descriptor, timeout,
@@ -242,6 +430,16 @@ void faux_net_sigmask_del(faux_net_t *faux_net, int signum)
  */
 ssize_t faux_net_send(faux_net_t *faux_net, const void *buf, size_t n)
 {
+	if (faux_net->zerocopy && (n >= FAUX_NET_ZEROCOPY_MIN)) {
+		bool_t copied = BOOL_FALSE;
+		ssize_t bytes_written = faux_send_zerocopy_block(faux_net->fd,
+			buf, n, faux_net->send_timeout, &(faux_net->sigmask),
+			faux_net->isbreak_func, &copied);
+		// Kernel copies data anyway so zerocopy is overhead only
+		if (copied)
+			faux_net->zerocopy = BOOL_FALSE;
+		return bytes_written;
+	}
 
 	return faux_send_block(faux_net->fd, buf, n, faux_net->send_timeout,
 		&(faux_net->sigmask), faux_net->isbreak_func);
@@ -266,6 +464,70 @@ ssize_t faux_net_sendv(faux_net_t *faux_net,
 }
 
 
+/** @brief Sends file range to socket associated with given objects.
+ *
+ * Data is sent by sendfile() so it's not copied to user space. The socket
+ * must be non-blocking for that. The data is copied through intermediate
+ * buffer for blocking socket. Function uses previously set parameters such
+ * as descriptor, timeout, signal mask, callback function.
+ *
+ * @sa faux_sendfile()
+ * @param [in] faux_net The faux_net_t object.
+ * @param [in] in_fd File descriptor to read data from.
+ * @param [in,out] offset Offset within file. NULL - current file position.
+ * @param [in] n Number of bytes to send.
+ * @return Number of bytes was succesfully sent or < 0 on error.
+ */
+ssize_t faux_net_sendfile(faux_net_t *faux_net, int in_fd, off_t *offset,
+	size_t n)
+{
+	return faux_sendfile_block(faux_net->fd, in_fd, offset, n,
+		faux_net->send_timeout, &(faux_net->sigmask),
+		faux_net->isbreak_func);
+}
+
+
+/** @brief Sends a batch of datagrams to socket associated with given objects.
+ *
+ * Function uses previously set parameters such as descriptor, timeout,
+ * signal mask, callback function.
+ *
+ * @sa faux_sendmm()
+ * @param [in] faux_net The faux_net_t object.
+ * @param [in,out] msgs Array of messages.
+ * @param [in] vlen Number of messages.
+ * @return Number of sent datagrams or < 0 on error.
+ */
+int faux_net_sendmm(faux_net_t *faux_net, struct mmsghdr *msgs,
+	unsigned int vlen)
+{
+	return faux_sendmm_block(faux_net->fd, msgs, vlen,
+		faux_net->send_timeout, &(faux_net->sigmask),
+		faux_net->isbreak_func);
+}
+
+
+/** @brief Receives a batch of datagrams from socket associated with given objects.
+ *
+ * Function uses previously set parameters such as descriptor, timeout,
+ * signal mask, callback function. The receive buffer is not used for
+ * datagrams.
+ *
+ * @sa faux_recvmm()
+ * @param [in] faux_net The faux_net_t object.
+ * @param [in,out] msgs Array of messages.
+ * @param [in] vlen Number of messages.
+ * @return Number of received datagrams, 0 on timeout, < 0 on error.
+ */
+int faux_net_recvmm(faux_net_t *faux_net, struct mmsghdr *msgs,
+	unsigned int vlen)
+{
+	return faux_recvmm_block(faux_net->fd, msgs, vlen,
+		faux_net->recv_timeout, &(faux_net->sigmask),
+		faux_net->isbreak_func);
+}
+
+
 /** @brief Receives data from socket associated with given objects.
  *
  * Function uses previously set parameters such as descriptor, timeout,
@@ -278,9 +540,27 @@ ssize_t faux_net_sendv(faux_net_t *faux_net,
  */
 ssize_t faux_net_recv(faux_net_t *faux_net, void *buf, size_t n)
 {
-
-	return faux_recv_block(faux_net->fd, buf, n, faux_net->recv_timeout,
-		&(faux_net->sigmask), faux_net->isbreak_func);
+	struct iovec iov[2] = {};
+	size_t got = 0;
+	ssize_t bytes_readed = 0;
+
+	if (!faux_net->recv_buf)
+		return faux_recv_block(faux_net->fd, buf, n,
+			faux_net->recv_timeout, &(faux_net->sigmask),
+			faux_net->isbreak_func);
+
+	got = faux_net_recv_buf_get(faux_net, buf, n);
+	if (got == n)
+		return n;
+
+	// Buffer is empty now. Receive the rest and read ahead.
+	iov[0].iov_base = (char *)buf + got;
+	iov[0].iov_len = n - got;
+	bytes_readed = faux_net_recv_ahead(faux_net, iov, 2, n - got);
+	if (bytes_readed < 0)
+		return (got > 0) ? (ssize_t)got : bytes_readed;
+
+	return got + bytes_readed;
 }
 
 
@@ -296,6 +576,52 @@ ssize_t faux_net_recv(faux_net_t *faux_net, void *buf, size_t n)
  */
 ssize_t faux_net_recvv(faux_net_t *faux_net, struct iovec *iov, int iovcnt)
 {
-	return faux_recvv_block(faux_net->fd, iov, iovcnt, faux_net->recv_timeout,
-		&(faux_net->sigmask), faux_net->isbreak_func);
+	struct iovec *ahead_iov = NULL;
+	int ahead_iovcnt = 0;
+	size_t got = 0;
+	size_t partial = 0;
+	size_t left = 0;
+	ssize_t bytes_readed = 0;
+	int i = 0;
+
+	if (!faux_net->recv_buf)
+		return faux_recvv_block(faux_net->fd, iov, iovcnt,
+			faux_net->recv_timeout, &(faux_net->sigmask),
+			faux_net->isbreak_func);
+	if (!iov)
+		return -1;
+
+	// Fill iov elements from buffer
+	for (i = 0; i < iovcnt; i++) {
+		partial = faux_net_recv_buf_get(faux_net,
+			iov[i].iov_base, iov[i].iov_len);
+		got += partial;
+		if (partial < iov[i].iov_len)
+			break;
+	}
+	if (i == iovcnt)
+		return got;
+
+	// Buffer is empty now. Receive the rest and read ahead. The last
+	// element of iov copy is reserved for receive buffer.
+	ahead_iov = faux_zmalloc((iovcnt - i + 1) * sizeof(*ahead_iov));
+	assert(ahead_iov);
+	if (!ahead_iov)
+		return (got > 0) ? (ssize_t)got : -1;
+	for (ahead_iovcnt = 0; i < iovcnt; i++, ahead_iovcnt++) {
+		ahead_iov[ahead_iovcnt] = iov[i];
+		left += iov[i].iov_len;
+	}
+	// The first element can be partially filled from buffer
+	ahead_iov[0].iov_base = (char *)ahead_iov[0].iov_base + partial;
+	ahead_iov[0].iov_len -= partial;
+	left -= partial;
+	ahead_iovcnt++;
+	bytes_readed = faux_net_recv_ahead(faux_net, ahead_iov, ahead_iovcnt,
+		left);
+	faux_free(ahead_iov);
+	if (bytes_readed < 0)
+		return (got > 0) ? (ssize_t)got : bytes_readed;
+
+	return got + bytes_readed;
 }
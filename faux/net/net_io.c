@@ -5,27 +5,113 @@
 // For ppol()
 #define _GNU_SOURCE
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <poll.h>
+#ifdef HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+#ifdef HAVE_MSG_ZEROCOPY
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#endif
 
 #include "faux/faux.h"
 #include "faux/time.h"
 #include "faux/net.h"
 
+#include "private.h"
+
 #ifdef HAVE_PTHREAD
 #define setsigmask pthread_sigmask
 #else
 #define setsigmask sigprocmask
 #endif
 
+// Max number of iovec elements per sendmsg()/recvmsg() call
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+
+/** @brief Waits for socket to be ready for sending or receiving.
+ *
+ * The deadline is calculated on the first call only. The deadline_set flag
+ * must be initialized by BOOL_FALSE by caller.
+ *
+ * @param [in] fd Socket.
+ * @param [in] events Events to wait for (POLLIN or POLLOUT).
+ * @param [in] timeout Timeout.
+ * @param [in] sigmask Signal mask to set while ppoll() call.
+ * @param [in,out] deadline Deadline.
+ * @param [in,out] deadline_set Is deadline already calculated.
+ * @param [out] revents Returned events. Can be NULL.
+ * @return BOOL_TRUE - next transfer attempt must be done, BOOL_FALSE -
+ * timeout, error or interrupted by signal.
+ */
+static bool_t faux_wait_fd(int fd, short events,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	faux_nsec_t *deadline, bool_t *deadline_set, short *revents)
+{
+	struct pollfd fds = {};
+	struct timespec *poll_timeout = NULL;
+	struct timespec to = {};
+	int sn = 0;
+
+	// Calculate deadline - the time when timeout must occur.
+	// Use monotonic clock so system time changes don't affect timeout.
+	if (timeout) {
+		faux_nsec_t now = faux_nsec_now_monotonic();
+		if (!*deadline_set) {
+			*deadline = now + faux_timespec_to_nsec(timeout);
+			*deadline_set = BOOL_TRUE;
+		}
+		if (now > *deadline)
+			return BOOL_FALSE; // Timeout already occured
+		faux_nsec_to_timespec(&to, *deadline - now);
+		poll_timeout = &to;
+	}
+
+	// Handlers for poll()
+	faux_bzero(&fds, sizeof(fds));
+	fds.fd = fd;
+	fds.events = events;
+
+	sn = ppoll(&fds, 1, poll_timeout, sigmask);
+	if (revents)
+		*revents = (sn > 0) ? fds.revents : 0;
+	// When kernel can't allocate some internal structures it can
+	// return EAGAIN so retry.
+	if ((sn < 0) && (EAGAIN == errno))
+		return BOOL_TRUE;
+	// All unneded signals are masked so don't process EINTR
+	// in special way. Just break the loop
+	if (sn < 0)
+		return BOOL_FALSE;
+	// Timeout: break the loop. User don't want to wait any more
+	if (0 == sn)
+		return BOOL_FALSE;
+
+	// Any event (including error) means next transfer attempt. The
+	// transfer function will report error if any.
+	return BOOL_TRUE;
+}
+
 
 /** @brief Sends data to socket. Uses timeout and signal mask.
  *
@@ -36,6 +122,10 @@
  * by timeout. Else it will send() all data given. Function can return sent
  * size less than required by user. It can happen due to errors.
  *
+ * The non-blocking send() is tried first. The function waits for socket
+ * only if socket is not ready. So data sending to ready socket costs single
+ * syscall. The deadline is calculated on the first waiting only.
+ *
  * @param [in] fd Socket.
  * @param [in] buf Buffer to write.
  * @param [in] n Number of bytes to write.
@@ -49,8 +139,8 @@ ssize_t faux_send(int fd, const void *buf, size_t n,
 	size_t total_written = 0;
 	size_t left = n;
 	const void *data = buf;
-	struct timespec now = {};
-	struct timespec deadline = {};
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
 
 	assert(fd != -1);
 	assert(buf);
@@ -59,47 +149,8 @@ ssize_t faux_send(int fd, const void *buf, size_t n,
 	if (0 == n)
 		return 0;
 
-	// Calculate deadline - the time when timeout must occur.
-	if (timeout) {
-		faux_timespec_now(&now);
-		faux_timespec_sum(&deadline, &now, timeout);
-	}
-
 	do {
 		ssize_t bytes_written = 0;
-		struct pollfd fds = {};
-		struct timespec *poll_timeout = NULL;
-		struct timespec to = {};
-		int sn = 0;
-
-		if (timeout) {
-			if (faux_timespec_before_now(&deadline))
-				break; // Timeout already occured
-			faux_timespec_now(&now);
-			faux_timespec_diff(&to, &deadline, &now);
-			poll_timeout = &to;
-		}
-
-		// Handlers for poll()
-		faux_bzero(&fds, sizeof(fds));
-		fds.fd = fd;
-		fds.events = POLLOUT;
-
-		sn = ppoll(&fds, 1, poll_timeout, sigmask);
-		// When kernel can't allocate some internal structures it can
-		// return EAGAIN so retry.
-		if ((sn < 0) && (EAGAIN == errno))
-			continue;
-		// All unneded signals are masked so don't process EINTR
-		// in special way. Just break the loop
-		if (sn < 0)
-			break;
-		// Timeout: break the loop. User don't want to wait any more
-		if (0 == sn)
-			break;
-		// Some unknown event (not POLLOUT). So retry polling
-		if (!(fds.revents & POLLOUT))
-			continue;
 
 		// The send() call is non-blocking but it's not obvious that
 		// it can't return EINTR. Probably it can. Due to the fact the
@@ -107,16 +158,22 @@ ssize_t faux_send(int fd, const void *buf, size_t n,
 		do {
 			bytes_written = send(fd, data, left, MSG_DONTWAIT | MSG_NOSIGNAL);
 		} while ((bytes_written < 0) && (EINTR == errno));
-		if (bytes_written < 0)
-			break;
+		if (bytes_written > 0) {
+			data += bytes_written;
+			left = left - bytes_written;
+			total_written += bytes_written;
+			continue;
+		}
 		// Insufficient space
 		if (0 == bytes_written)
 			break;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			break;
 
-		data += bytes_written;
-		left = left - bytes_written;
-		total_written += bytes_written;
-
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLOUT, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
+			break;
 	} while (left > 0);
 
 	return total_written;
@@ -172,8 +229,10 @@ ssize_t faux_send_block(int fd, const void *buf, size_t n,
 
 	// Signal handler can set var to interrupt exchange.
 	// Get value of this var by special callback function.
-	if (isbreak_func && isbreak_func())
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
 		return -1;
+	}
 
 	bytes_num = faux_send(fd, buf, n, timeout, sigmask);
 
@@ -186,6 +245,8 @@ ssize_t faux_send_block(int fd, const void *buf, size_t n,
 /** @brief Sends "struct iovec" data blocks to socket.
  *
  * This function is like a faux_send() function but uses scatter/gather.
+ * The whole iov array (up to IOV_MAX elements) is sent by single sendmsg()
+ * call. The partial sending continues from the position it was stopped at.
  *
  * @see faux_send().
  * @param [in] fd Socket.
@@ -202,9 +263,10 @@ ssize_t faux_sendv(int fd, const struct iovec *iov, int iovcnt,
 	const struct timespec *timeout, const sigset_t *sigmask)
 {
 	size_t total_written = 0;
-	int i = 0;
-	struct timespec now = {};
-	struct timespec deadline = {};
+	int i = 0; // Index of current iov element
+	size_t offset = 0; // Already sent part of current element
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
 
 	assert(fd != -1);
 	if (fd == -1)
@@ -214,36 +276,66 @@ ssize_t faux_sendv(int fd, const struct iovec *iov, int iovcnt,
 	if (iovcnt == 0)
 		return 0;
 
-	// Calculate deadline - the time when timeout must occur.
-	if (timeout) {
-		faux_timespec_now(&now);
-		faux_timespec_sum(&deadline, &now, timeout);
-	}
-
-	for (i = 0; i < iovcnt; i++) {
+	while (1) {
 		ssize_t bytes_written = 0;
-		struct timespec *send_timeout = NULL;
-		struct timespec to = {};
-
-		if (timeout) {
-			if (faux_timespec_before_now(&deadline))
-				break; // Timeout already occured
-			faux_timespec_now(&now);
-			faux_timespec_diff(&to, &deadline, &now);
-			send_timeout = &to;
+		size_t left = 0;
+
+		// Skip completely sent and empty elements
+		while ((i < iovcnt) && (offset == iov[i].iov_len)) {
+			i++;
+			offset = 0;
 		}
-		if (iov[i].iov_len == 0)
+		if (i >= iovcnt)
+			break;
+
+		// Partially sent element is finished by send(). The user's iov
+		// array is constant so it can't be adjusted. Else the rest of
+		// elements is sent by single sendmsg().
+		do {
+			if (offset > 0) {
+				bytes_written = send(fd,
+					(char *)iov[i].iov_base + offset,
+					iov[i].iov_len - offset,
+					MSG_DONTWAIT | MSG_NOSIGNAL);
+			} else {
+				struct msghdr msg = {};
+				msg.msg_iov = (struct iovec *)&iov[i];
+				msg.msg_iovlen = ((iovcnt - i) > IOV_MAX) ?
+					IOV_MAX : (iovcnt - i);
+				bytes_written = sendmsg(fd, &msg,
+					MSG_DONTWAIT | MSG_NOSIGNAL);
+			}
+		} while ((bytes_written < 0) && (EINTR == errno));
+
+		if (bytes_written > 0) {
+			total_written += bytes_written;
+			// Advance iov position
+			left = bytes_written;
+			while (left > 0) {
+				size_t rest = iov[i].iov_len - offset;
+				if (left < rest) {
+					offset += left;
+					break;
+				}
+				left -= rest;
+				i++;
+				offset = 0;
+			}
 			continue;
-		bytes_written = faux_send(fd, iov[i].iov_base, iov[i].iov_len,
-			send_timeout, sigmask);
-		if (bytes_written < 0) { // Error
+		}
+		// Insufficient space
+		if (0 == bytes_written)
+			break;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
 			if (total_written != 0)
 				break;
 			return -1;
 		}
-		if (0 == bytes_written) // Insufficient space or timeout
+
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLOUT, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
 			break;
-		total_written += bytes_written;
 	}
 
 	return total_written;
@@ -290,8 +382,10 @@ ssize_t faux_sendv_block(int fd, const struct iovec *iov, int iovcnt,
 
 	// Signal handler can set var to interrupt exchange.
 	// Get value of this var by special callback function.
-	if (isbreak_func && isbreak_func())
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
 		return -1;
+	}
 
 	bytes_num = faux_sendv(fd, iov, iovcnt, timeout, sigmask);
 
@@ -304,7 +398,7 @@ ssize_t faux_sendv_block(int fd, const struct iovec *iov, int iovcnt,
 /** @brief Receives data from the socket.
  *
  * Function has the same parameters and features like faux_send() function
- * but it receives data.
+ * but it receives data. The non-blocking recv() is tried first too.
  *
  * @sa faux_send()
  */
@@ -314,8 +408,8 @@ ssize_t faux_recv(int fd, void *buf, size_t n,
 	size_t total_readed = 0;
 	size_t left = n;
 	void *data = buf;
-	struct timespec now = {};
-	struct timespec deadline = {};
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
 
 	assert(fd != -1);
 	assert(buf);
@@ -324,64 +418,31 @@ ssize_t faux_recv(int fd, void *buf, size_t n,
 	if (0 == n)
 		return 0;
 
-	// Calculate deadline - the time when timeout must occur.
-	if (timeout) {
-		faux_timespec_now(&now);
-		faux_timespec_sum(&deadline, &now, timeout);
-	}
-
 	do {
 		ssize_t bytes_readed = 0;
-		struct pollfd fds = {};
-		struct timespec *poll_timeout = NULL;
-		struct timespec to = {};
-		int sn = 0;
-
-		if (timeout) {
-			if (faux_timespec_before_now(&deadline))
-				break; // Timeout already occured
-			faux_timespec_now(&now);
-			faux_timespec_diff(&to, &deadline, &now);
-			poll_timeout = &to;
-		}
 
-		// Handlers for poll()
-		faux_bzero(&fds, sizeof(fds));
-		fds.fd = fd;
-		fds.events = POLLIN;
-
-		sn = ppoll(&fds, 1, poll_timeout, sigmask);
-		// When kernel can't allocate some internal structures it can
-		// return EAGAIN so retry.
-		if ((sn < 0) && (EAGAIN == errno))
-			continue;
-		// All unneded signals are masked so don't process EINTR
-		// in special way. Just break the loop
-		if (sn < 0)
-			break;
-		// Timeout: break the loop. User don't want to wait any more
-		if (0 == sn)
-			break;
-		// Some unknown event (not POLLIN). So retry polling
-		if (!(fds.revents & POLLIN))
-			continue;
-
-		// The send() call is non-blocking but it's not obvious that
+		// The recv() call is non-blocking but it's not obvious that
 		// it can't return EINTR. Probably it can. Due to the fact the
-		// call is non-blocking re-send() on any signal i.e. any EINTR.
+		// call is non-blocking re-recv() on any signal i.e. any EINTR.
 		do {
 			bytes_readed = recv(fd, data, left, MSG_DONTWAIT | MSG_NOSIGNAL);
 		} while ((bytes_readed < 0) && (EINTR == errno));
-		if (bytes_readed < 0)
-			break;
+		if (bytes_readed > 0) {
+			data += bytes_readed;
+			left = left - bytes_readed;
+			total_readed += bytes_readed;
+			continue;
+		}
 		// EOF
 		if (0 == bytes_readed)
 			break;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			break;
 
-		data += bytes_readed;
-		left = left - bytes_readed;
-		total_readed += bytes_readed;
-
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLIN, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
+			break;
 	} while (left > 0);
 
 	return total_readed;
@@ -418,8 +479,10 @@ ssize_t faux_recv_block(int fd, void *buf, size_t n,
 
 	// Signal handler can set var to interrupt exchange.
 	// Get value of this var by special callback function.
-	if (isbreak_func && isbreak_func())
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
 		return -1;
+	}
 
 	bytes_num = faux_recv(fd, buf, n, timeout, sigmask);
 
@@ -429,20 +492,29 @@ ssize_t faux_recv_block(int fd, void *buf, size_t n,
 }
 
 
-/** @brief Receives data from the socket. Uses scatter/gather.
+/** @brief Receives at least "min" bytes from the socket. Uses scatter/gather.
  *
- * Function has the same parameters and features like faux_sendv() function
- * but it receives data.
+ * Function receives data to iov array until "min" bytes are received or
+ * the whole iov array is filled. So it can be used to read ahead as much
+ * data as available but to wait for necessary part only.
  *
- * @sa faux_sendv()
+ * @sa faux_recvv()
+ * @param [in] fd Socket.
+ * @param [in] iov Array of "struct iovec" structures.
+ * @param [in] iovcnt Number of iov array members.
+ * @param [in] min Number of bytes to wait for.
+ * @param [in] timeout Receive timeout.
+ * @param [in] sigmask Signal mask to set while pselect() call.
+ * @return Number of bytes received or < 0 on error.
  */
-ssize_t faux_recvv(int fd, struct iovec *iov, int iovcnt,
-	const struct timespec *timeout, const sigset_t *sigmask)
+static ssize_t faux_recvv_min(int fd, struct iovec *iov, int iovcnt,
+	size_t min, const struct timespec *timeout, const sigset_t *sigmask)
 {
 	size_t total_readed = 0;
-	int i = 0;
-	struct timespec now = {};
-	struct timespec deadline = {};
+	int i = 0; // Index of current iov element
+	size_t offset = 0; // Already received part of current element
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
 
 	assert(fd != -1);
 	if (fd == -1)
@@ -452,42 +524,133 @@ ssize_t faux_recvv(int fd, struct iovec *iov, int iovcnt,
 	if (iovcnt == 0)
 		return 0;
 
-	// Calculate deadline - the time when timeout must occur.
-	if (timeout) {
-		faux_timespec_now(&now);
-		faux_timespec_sum(&deadline, &now, timeout);
-	}
-
-	for (i = 0; i < iovcnt; i++) {
+	while (1) {
 		ssize_t bytes_readed = 0;
-		struct timespec *recv_timeout = NULL;
-		struct timespec to = {};
-
-		if (timeout) {
-			if (faux_timespec_before_now(&deadline))
-				break; // Timeout already occured
-			faux_timespec_now(&now);
-			faux_timespec_diff(&to, &deadline, &now);
-			recv_timeout = &to;
+		size_t left = 0;
+
+		// Skip completely filled and empty elements
+		while ((i < iovcnt) && (offset == iov[i].iov_len)) {
+			i++;
+			offset = 0;
 		}
-		if (iov[i].iov_len == 0)
+		if (i >= iovcnt)
+			break;
+
+		// Partially filled element is finished by recv(). The user's
+		// iov array is not changed. Else the rest of elements is
+		// filled by single recvmsg().
+		do {
+			if (offset > 0) {
+				bytes_readed = recv(fd,
+					(char *)iov[i].iov_base + offset,
+					iov[i].iov_len - offset,
+					MSG_DONTWAIT | MSG_NOSIGNAL);
+			} else {
+				struct msghdr msg = {};
+				msg.msg_iov = &iov[i];
+				msg.msg_iovlen = ((iovcnt - i) > IOV_MAX) ?
+					IOV_MAX : (iovcnt - i);
+				bytes_readed = recvmsg(fd, &msg,
+					MSG_DONTWAIT | MSG_NOSIGNAL);
+			}
+		} while ((bytes_readed < 0) && (EINTR == errno));
+
+		if (bytes_readed > 0) {
+			total_readed += bytes_readed;
+			// Advance iov position
+			left = bytes_readed;
+			while (left > 0) {
+				size_t rest = iov[i].iov_len - offset;
+				if (left < rest) {
+					offset += left;
+					break;
+				}
+				left -= rest;
+				i++;
+				offset = 0;
+			}
+			if (total_readed >= min)
+				break;
 			continue;
-		bytes_readed = faux_recv(fd, iov[i].iov_base, iov[i].iov_len,
-			recv_timeout, sigmask);
-		if (bytes_readed < 0) { // Error
+		}
+		// EOF
+		if (0 == bytes_readed)
+			break;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
 			if (total_readed != 0)
 				break;
 			return -1;
 		}
-		if (0 == bytes_readed) // EOF or timeout
+
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLIN, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
 			break;
-		total_readed += bytes_readed;
 	}
 
 	return total_readed;
 }
 
 
+/** @brief Receives data from the socket. Uses scatter/gather.
+ *
+ * Function has the same parameters and features like faux_sendv() function
+ * but it receives data.
+ *
+ * @sa faux_sendv()
+ */
+ssize_t faux_recvv(int fd, struct iovec *iov, int iovcnt,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+	return faux_recvv_min(fd, iov, iovcnt, SIZE_MAX, timeout, sigmask);
+}
+
+
+/** @brief Receives at least "min" bytes from the socket. Removes races.
+ *
+ * Function is like a faux_recvv_block() but it stops when "min" bytes are
+ * received. It's used by faux_net_t object to read ahead to its receive
+ * buffer.
+ *
+ * @sa faux_recvv_block()
+ */
+ssize_t faux_recvv_min_block(int fd, struct iovec *iov, int iovcnt,
+	size_t min, const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void))
+{
+	sigset_t all_sigmask = {}; // All signals mask
+	sigset_t orig_sigmask = {}; // Saved signal mask
+	ssize_t bytes_num = 0;
+
+	assert(fd != -1);
+	if ((-1 == fd))
+		return -1;
+	if (!iov)
+		return -1;
+	if (iovcnt == 0)
+		return 0;
+
+	// Block signals to prevent race conditions right before pselect()
+	// Catch signals while pselect() only
+	// Now blocks all signals
+	sigfillset(&all_sigmask);
+	setsigmask(SIG_SETMASK, &all_sigmask, &orig_sigmask);
+
+	// Signal handler can set var to interrupt exchange.
+	// Get value of this var by special callback function.
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+		return -1;
+	}
+
+	bytes_num = faux_recvv_min(fd, iov, iovcnt, min, timeout, sigmask);
+
+	setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+
+	return bytes_num;
+}
+
+
 /** @brief Receives data from the socket. Uses sactter/gather, removes races.
  *
  * Function has the same parameters and features like faux_sendv_block()
@@ -498,17 +661,401 @@ ssize_t faux_recvv(int fd, struct iovec *iov, int iovcnt,
 ssize_t faux_recvv_block(int fd, struct iovec *iov, int iovcnt,
 	const struct timespec *timeout, const sigset_t *sigmask,
 	int (*isbreak_func)(void))
+{
+	return faux_recvv_min_block(fd, iov, iovcnt, SIZE_MAX, timeout,
+		sigmask, isbreak_func);
+}
+
+
+#ifdef HAVE_MSG_ZEROCOPY
+/** @brief Reads zerocopy completion notifications from socket error queue.
+ *
+ * Each successful send() with MSG_ZEROCOPY flag gets sequential number.
+ * The notification contains range of numbers of completed calls.
+ *
+ * @param [in] fd Socket.
+ * @param [out] copied Set to BOOL_TRUE if kernel copied data. Can be NULL.
+ * @return Number of completed send() calls or < 0 on error.
+ */
+static ssize_t faux_zerocopy_completions(int fd, bool_t *copied)
+{
+	size_t completed = 0;
+
+	while (1) {
+		struct msghdr msg = {};
+		char control[128] = {};
+		struct cmsghdr *cm = NULL;
+		ssize_t r = 0;
+
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		do {
+			r = recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+		} while ((r < 0) && (EINTR == errno));
+		if (r < 0) {
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+				break; // Error queue is empty
+			return -1;
+		}
+
+		for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			struct sock_extended_err *serr = NULL;
+
+			// IPv4 and IPv6 sockets use different levels
+			if (!((SOL_IP == cm->cmsg_level) &&
+				(IP_RECVERR == cm->cmsg_type)) &&
+				!((SOL_IPV6 == cm->cmsg_level) &&
+				(IPV6_RECVERR == cm->cmsg_type)))
+				continue;
+			serr = (struct sock_extended_err *)CMSG_DATA(cm);
+			if ((serr->ee_errno != 0) ||
+				(serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+				continue;
+			completed += serr->ee_data - serr->ee_info + 1;
+			if (copied && (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED))
+				*copied = BOOL_TRUE;
+		}
+	}
+
+	return completed;
+}
+#endif
+
+
+/** @brief Sends data to socket without copying it to kernel.
+ *
+ * The function is like a faux_send() but it uses MSG_ZEROCOPY flag. The
+ * SO_ZEROCOPY option must be set on socket before. Kernel pins user pages
+ * and sends data right from them. So function waits for completion
+ * notifications from socket error queue before return. Then the buffer can
+ * be reused. The zerocopy has some overhead so it's useful for large
+ * buffers only. Note TCP completion is reported when peer acknowledges
+ * data. So each call costs at least one round trip time.
+ *
+ * If SO_ZEROCOPY option is not set then kernel ignores MSG_ZEROCOPY flag
+ * and never reports completions. So the option is checked and faux_send()
+ * is used without it.
+ *
+ * If completion notifications are not received within timeout the function
+ * returns error. The buffer can be still used by kernel then so connection
+ * must be considered as broken.
+ *
+ * Kernel can copy data anyway. For example it does so for loopback
+ * interface. The "copied" flag informs about it. User can stop to use
+ * zerocopy then.
+ *
+ * Without MSG_ZEROCOPY support the function is the same as faux_send().
+ *
+ * @param [in] fd Socket.
+ * @param [in] buf Buffer to write.
+ * @param [in] n Number of bytes to write.
+ * @param [in] timeout Send timeout.
+ * @param [in] sigmask Signal mask to set while pselect() call.
+ * @param [out] copied Set to BOOL_TRUE if kernel copied data. Can be NULL.
+ * @return Number of bytes written or < 0 on error.
+ */
+ssize_t faux_send_zerocopy(int fd, const void *buf, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	bool_t *copied)
+{
+#ifdef HAVE_MSG_ZEROCOPY
+	size_t total_written = 0;
+	size_t left = n;
+	const void *data = buf;
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
+	size_t issued = 0; // Number of zerocopy send() calls
+	size_t completed = 0; // Number of completed zerocopy send() calls
+	int zc_flag = MSG_ZEROCOPY;
+	int zc_opt = 0;
+	socklen_t zc_opt_len = sizeof(zc_opt);
+
+	assert(fd != -1);
+	assert(buf);
+	if ((-1 == fd) || !buf)
+		return -1;
+	if (0 == n)
+		return 0;
+
+	// Completions are not reported without SO_ZEROCOPY
+	if ((getsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &zc_opt, &zc_opt_len) < 0) ||
+		!zc_opt) {
+		if (copied)
+			*copied = BOOL_TRUE;
+		return faux_send(fd, buf, n, timeout, sigmask);
+	}
+
+	do {
+		ssize_t bytes_written = 0;
+		ssize_t c = 0;
+		short events = POLLOUT;
+
+		do {
+			bytes_written = send(fd, data, left,
+				zc_flag | MSG_DONTWAIT | MSG_NOSIGNAL);
+		} while ((bytes_written < 0) && (EINTR == errno));
+		if (bytes_written > 0) {
+			data += bytes_written;
+			left = left - bytes_written;
+			total_written += bytes_written;
+			if (zc_flag)
+				issued++;
+			continue;
+		}
+		// Insufficient space
+		if (0 == bytes_written)
+			break;
+		// Limit of pinned memory is reached. Wait for completions
+		// to release memory or copy data if nothing to wait for.
+		if ((ENOBUFS == errno) && zc_flag && (completed == issued)) {
+			zc_flag = 0;
+			continue;
+		}
+		if (ENOBUFS == errno)
+			events = 0; // Wait for completions only
+		else if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			break;
+
+		// Socket is not ready. Wait for it. Completions are reported
+		// by POLLERR so drain error queue after waiting.
+		if (!faux_wait_fd(fd, events, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
+			break;
+		c = faux_zerocopy_completions(fd, copied);
+		if (c < 0)
+			break;
+		completed += c;
+	} while (left > 0);
+
+	// Wait for all completions. Kernel uses user's buffer till then.
+	while (completed < issued) {
+		short revents = 0;
+		int err = 0;
+		socklen_t err_len = sizeof(err);
+		ssize_t c = faux_zerocopy_completions(fd, copied);
+
+		if (c < 0)
+			return -1;
+		completed += c;
+		if (completed >= issued)
+			break;
+		// POLLERR is reported even if it's not requested
+		if (!faux_wait_fd(fd, 0, timeout, sigmask,
+			&deadline, &deadline_set, &revents))
+			return -1;
+		if (revents & (POLLHUP | POLLNVAL)) {
+			c = faux_zerocopy_completions(fd, copied);
+			if ((c < 0) || ((completed + c) < issued))
+				return -1;
+			break;
+		}
+		// POLLERR without completions means socket error
+		if ((revents & POLLERR) &&
+			(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0) &&
+			(err != 0)) {
+			errno = err;
+			return -1;
+		}
+	}
+
+	return total_written;
+#else
+	if (copied)
+		*copied = BOOL_TRUE;
+
+	return faux_send(fd, buf, n, timeout, sigmask);
+#endif
+}
+
+
+/** @brief Sends data to socket without copying. It removes signal races.
+ *
+ * This function is like a faux_send_block() function but uses zerocopy.
+ *
+ * @sa faux_send_zerocopy()
+ * @sa faux_send_block()
+ */
+ssize_t faux_send_zerocopy_block(int fd, const void *buf, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void), bool_t *copied)
 {
 	sigset_t all_sigmask = {}; // All signals mask
 	sigset_t orig_sigmask = {}; // Saved signal mask
 	ssize_t bytes_num = 0;
 
 	assert(fd != -1);
-	if ((-1 == fd))
+	assert(buf);
+	if ((-1 == fd) || !buf)
 		return -1;
-	if (!iov)
+	if (0 == n)
+		return 0;
+
+	// Block signals to prevent race conditions right before pselect()
+	// Catch signals while pselect() only
+	// Now blocks all signals
+	sigfillset(&all_sigmask);
+	setsigmask(SIG_SETMASK, &all_sigmask, &orig_sigmask);
+
+	// Signal handler can set var to interrupt exchange.
+	// Get value of this var by special callback function.
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
 		return -1;
-	if (iovcnt == 0)
+	}
+
+	bytes_num = faux_send_zerocopy(fd, buf, n, timeout, sigmask, copied);
+
+	setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+
+	return bytes_num;
+}
+
+
+/** @brief Internal function to send file range through intermediate buffer.
+ *
+ * @sa faux_sendfile()
+ */
+static ssize_t faux_sendfile_copy(int fd, int in_fd, off_t *offset, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+	size_t total_written = 0;
+	size_t left = n;
+
+	do {
+		char buf[16384];
+		size_t len = (left < sizeof(buf)) ? left : sizeof(buf);
+		ssize_t bytes_readed = 0;
+		ssize_t bytes_written = 0;
+
+		do {
+			if (offset)
+				bytes_readed = pread(in_fd, buf, len, *offset);
+			else
+				bytes_readed = read(in_fd, buf, len);
+		} while ((bytes_readed < 0) && (EINTR == errno));
+		if (bytes_readed < 0) {
+			if (0 == total_written)
+				return -1;
+			break;
+		}
+		if (0 == bytes_readed) // EOF
+			break;
+		if (offset)
+			*offset += bytes_readed;
+		bytes_written = faux_send(fd, buf, bytes_readed,
+			timeout, sigmask);
+		if (bytes_written > 0)
+			total_written += bytes_written;
+		if (bytes_written != bytes_readed)
+			break;
+		left = left - bytes_written;
+	} while (left > 0);
+
+	return total_written;
+}
+
+
+/** @brief Sends file range to socket.
+ *
+ * The function is like a faux_send() but data is got from file. The
+ * sendfile() is used so data is not copied to user space. The sendfile()
+ * has no flag like MSG_DONTWAIT and it can block on blocking socket
+ * regardless of timeout. So it's used for non-blocking sockets (O_NONBLOCK)
+ * only. The mode of socket is not changed because file description can be
+ * shared with another users.
+ *
+ * For blocking sockets or without sendfile() support data is read to
+ * intermediate buffer and it's sent by faux_send().
+ *
+ * @param [in] fd Socket.
+ * @param [in] in_fd File descriptor to read data from.
+ * @param [in,out] offset Offset within file. It's updated. If NULL then
+ * current file position is used and updated.
+ * @param [in] n Number of bytes to send.
+ * @param [in] timeout Send timeout.
+ * @param [in] sigmask Signal mask to set while pselect() call.
+ * @return Number of bytes written or < 0 on error.
+ * < n then EOF, timeout or error (but some data were already sent).
+ */
+ssize_t faux_sendfile(int fd, int in_fd, off_t *offset, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+#ifdef HAVE_SENDFILE
+	size_t total_written = 0;
+	size_t left = n;
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
+	int flags = 0;
+#endif
+
+	assert(fd != -1);
+	assert(in_fd != -1);
+	if ((-1 == fd) || (-1 == in_fd))
+		return -1;
+	if (0 == n)
+		return 0;
+
+#ifdef HAVE_SENDFILE
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0)
+		return -1;
+	if (!(flags & O_NONBLOCK))
+		return faux_sendfile_copy(fd, in_fd, offset, n,
+			timeout, sigmask);
+
+	do {
+		ssize_t bytes_written = 0;
+
+		do {
+			bytes_written = sendfile(fd, in_fd, offset, left);
+		} while ((bytes_written < 0) && (EINTR == errno));
+		if (bytes_written > 0) {
+			left = left - bytes_written;
+			total_written += bytes_written;
+			continue;
+		}
+		// EOF
+		if (0 == bytes_written)
+			break;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			if (0 == total_written)
+				return -1;
+			break;
+		}
+
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLOUT, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
+			break;
+	} while (left > 0);
+
+	return total_written;
+#else
+	return faux_sendfile_copy(fd, in_fd, offset, n, timeout, sigmask);
+#endif
+}
+
+
+/** @brief Sends file range to socket. It removes signal races.
+ *
+ * This function is like a faux_send_block() function but sends file range.
+ *
+ * @sa faux_sendfile()
+ * @sa faux_send_block()
+ */
+ssize_t faux_sendfile_block(int fd, int in_fd, off_t *offset, size_t n,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void))
+{
+	sigset_t all_sigmask = {}; // All signals mask
+	sigset_t orig_sigmask = {}; // Saved signal mask
+	ssize_t bytes_num = 0;
+
+	assert(fd != -1);
+	assert(in_fd != -1);
+	if ((-1 == fd) || (-1 == in_fd))
+		return -1;
+	if (0 == n)
 		return 0;
 
 	// Block signals to prevent race conditions right before pselect()
@@ -519,12 +1066,294 @@ ssize_t faux_recvv_block(int fd, struct iovec *iov, int iovcnt,
 
 	// Signal handler can set var to interrupt exchange.
 	// Get value of this var by special callback function.
-	if (isbreak_func && isbreak_func())
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
 		return -1;
+	}
 
-	bytes_num = faux_recvv(fd, iov, iovcnt, timeout, sigmask);
+	bytes_num = faux_sendfile(fd, in_fd, offset, n, timeout, sigmask);
 
 	setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
 
 	return bytes_num;
 }
+
+
+/** @brief Sends datagrams one by one without blocking.
+ *
+ * It emulates sendmmsg() when it's not available.
+ *
+ * @return Number of sent datagrams or < 0 on error.
+ */
+int faux_sendmmsg_emul_nb(int fd, struct mmsghdr *msgs, unsigned int vlen)
+{
+	unsigned int i = 0;
+
+	for (i = 0; i < vlen; i++) {
+		ssize_t r = sendmsg(fd, &msgs[i].msg_hdr,
+			MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (r < 0)
+			return (i > 0) ? (int)i : -1;
+		msgs[i].msg_len = r;
+	}
+
+	return vlen;
+}
+
+
+/** @brief Receives datagrams one by one without blocking.
+ *
+ * It emulates recvmmsg() when it's not available.
+ *
+ * @return Number of received datagrams or < 0 on error.
+ */
+int faux_recvmmsg_emul_nb(int fd, struct mmsghdr *msgs, unsigned int vlen)
+{
+	unsigned int i = 0;
+
+	for (i = 0; i < vlen; i++) {
+		ssize_t r = recvmsg(fd, &msgs[i].msg_hdr, MSG_DONTWAIT);
+		if (r < 0)
+			return (i > 0) ? (int)i : -1;
+		msgs[i].msg_len = r;
+	}
+
+	return vlen;
+}
+
+
+/** @brief Sends datagrams by single non-blocking syscall.
+ *
+ * Without sendmmsg() datagrams are sent one by one. The libc can have
+ * sendmmsg() but kernel can lack it. So ENOSYS leads to the same fallback.
+ *
+ * @return Number of sent datagrams or < 0 on error.
+ */
+static int faux_sendmmsg_nb(int fd, struct mmsghdr *msgs, unsigned int vlen)
+{
+#ifdef HAVE_SENDMMSG
+	int r = sendmmsg(fd, msgs, vlen, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	if ((r < 0) && (ENOSYS == errno))
+		return faux_sendmmsg_emul_nb(fd, msgs, vlen);
+
+	return r;
+#else
+	return faux_sendmmsg_emul_nb(fd, msgs, vlen);
+#endif
+}
+
+
+/** @brief Receives datagrams by single non-blocking syscall.
+ *
+ * Without recvmmsg() datagrams are received one by one. The ENOSYS error
+ * leads to the same fallback.
+ *
+ * @return Number of received datagrams or < 0 on error.
+ */
+static int faux_recvmmsg_nb(int fd, struct mmsghdr *msgs, unsigned int vlen)
+{
+#ifdef HAVE_RECVMMSG
+	int r = recvmmsg(fd, msgs, vlen, MSG_DONTWAIT, NULL);
+
+	if ((r < 0) && (ENOSYS == errno))
+		return faux_recvmmsg_emul_nb(fd, msgs, vlen);
+
+	return r;
+#else
+	return faux_recvmmsg_emul_nb(fd, msgs, vlen);
+#endif
+}
+
+
+/** @brief Sends a batch of datagrams to socket.
+ *
+ * The function is like a faux_send() but it sends array of datagrams by
+ * sendmmsg(). So many datagrams are sent by single syscall. The msg_len
+ * field of each sent message is set to number of sent bytes.
+ *
+ * @param [in] fd Socket.
+ * @param [in,out] msgs Array of messages.
+ * @param [in] vlen Number of messages.
+ * @param [in] timeout Send timeout.
+ * @param [in] sigmask Signal mask to set while pselect() call.
+ * @return Number of sent datagrams or < 0 on error.
+ * < vlen then timeout or error (but some datagrams were already sent).
+ */
+int faux_sendmm(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+	unsigned int total_sent = 0;
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
+
+	assert(fd != -1);
+	assert(msgs);
+	if ((-1 == fd) || !msgs)
+		return -1;
+	if (0 == vlen)
+		return 0;
+
+	do {
+		int sent = 0;
+
+		do {
+			sent = faux_sendmmsg_nb(fd, msgs + total_sent,
+				vlen - total_sent);
+		} while ((sent < 0) && (EINTR == errno));
+		if (sent > 0) {
+			total_sent += sent;
+			continue;
+		}
+		if (0 == sent)
+			break;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			if (0 == total_sent)
+				return -1;
+			break;
+		}
+
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLOUT, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
+			break;
+	} while (total_sent < vlen);
+
+	return total_sent;
+}
+
+
+/** @brief Sends a batch of datagrams to socket. It removes signal races.
+ *
+ * This function is like a faux_send_block() function but sends datagrams.
+ *
+ * @sa faux_sendmm()
+ * @sa faux_send_block()
+ */
+int faux_sendmm_block(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void))
+{
+	sigset_t all_sigmask = {}; // All signals mask
+	sigset_t orig_sigmask = {}; // Saved signal mask
+	int num = 0;
+
+	assert(fd != -1);
+	assert(msgs);
+	if ((-1 == fd) || !msgs)
+		return -1;
+	if (0 == vlen)
+		return 0;
+
+	// Block signals to prevent race conditions right before pselect()
+	// Catch signals while pselect() only
+	// Now blocks all signals
+	sigfillset(&all_sigmask);
+	setsigmask(SIG_SETMASK, &all_sigmask, &orig_sigmask);
+
+	// Signal handler can set var to interrupt exchange.
+	// Get value of this var by special callback function.
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+		return -1;
+	}
+
+	num = faux_sendmm(fd, msgs, vlen, timeout, sigmask);
+
+	setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+
+	return num;
+}
+
+
+/** @brief Receives a batch of datagrams from socket.
+ *
+ * The function waits for the first datagram like a faux_recv() does. Then
+ * it receives all available datagrams (up to vlen) by recvmmsg() and
+ * returns. It doesn't wait for the whole batch because it's unknown how
+ * many datagrams will be sent by peer. The msg_len field of each received
+ * message is set to datagram length.
+ *
+ * @param [in] fd Socket.
+ * @param [in,out] msgs Array of messages.
+ * @param [in] vlen Number of messages.
+ * @param [in] timeout Receive timeout.
+ * @param [in] sigmask Signal mask to set while pselect() call.
+ * @return Number of received datagrams, 0 on timeout, < 0 on error.
+ */
+int faux_recvmm(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask)
+{
+	faux_nsec_t deadline = 0;
+	bool_t deadline_set = BOOL_FALSE;
+
+	assert(fd != -1);
+	assert(msgs);
+	if ((-1 == fd) || !msgs)
+		return -1;
+	if (0 == vlen)
+		return 0;
+
+	while (1) {
+		int received = 0;
+
+		do {
+			received = faux_recvmmsg_nb(fd, msgs, vlen);
+		} while ((received < 0) && (EINTR == errno));
+		if (received >= 0)
+			return received;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			return -1;
+
+		// Socket is not ready. Wait for it.
+		if (!faux_wait_fd(fd, POLLIN, timeout, sigmask,
+			&deadline, &deadline_set, NULL))
+			break;
+	}
+
+	return 0;
+}
+
+
+/** @brief Receives a batch of datagrams from socket. It removes signal races.
+ *
+ * This function is like a faux_recv_block() function but receives
+ * datagrams.
+ *
+ * @sa faux_recvmm()
+ * @sa faux_send_block()
+ */
+int faux_recvmm_block(int fd, struct mmsghdr *msgs, unsigned int vlen,
+	const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void))
+{
+	sigset_t all_sigmask = {}; // All signals mask
+	sigset_t orig_sigmask = {}; // Saved signal mask
+	int num = 0;
+
+	assert(fd != -1);
+	assert(msgs);
+	if ((-1 == fd) || !msgs)
+		return -1;
+	if (0 == vlen)
+		return 0;
+
+	// Block signals to prevent race conditions right before pselect()
+	// Catch signals while pselect() only
+	// Now blocks all signals
+	sigfillset(&all_sigmask);
+	setsigmask(SIG_SETMASK, &all_sigmask, &orig_sigmask);
+
+	// Signal handler can set var to interrupt exchange.
+	// Get value of this var by special callback function.
+	if (isbreak_func && isbreak_func()) {
+		setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+		return -1;
+	}
+
+	num = faux_recvmm(fd, msgs, vlen, timeout, sigmask);
+
+	setsigmask(SIG_SETMASK, &orig_sigmask, NULL);
+
+	return num;
+}
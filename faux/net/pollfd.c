@@ -1,4 +1,9 @@
 /** @file pollfd.c
+ *
+ * The vector of "struct pollfd" is accompanied by index i.e. array indexed
+ * by file descriptor. It contains position of item within vector. So
+ * searching, adding and removing of item costs O(1). The order of items is
+ * not preserved while removing.
  */
 
 #include <stdlib.h>
@@ -16,6 +21,9 @@
 #include "faux/vec.h"
 #include "private.h"
 
+/** @brief Minimal size of fd index */
+#define FAUX_POLLFD_INDEX_CHUNK 64
+
 
 /** @brief Callback function to search specified fd within pollfd structures.
  */
@@ -43,6 +51,8 @@ faux_pollfd_t *faux_pollfd_new(void)
 		return NULL;
 
 	faux_pollfd->vec = faux_vec_new(sizeof(struct pollfd), cmp_by_fd);
+	faux_pollfd->index = NULL;
+	faux_pollfd->index_size = 0;
 
 	return faux_pollfd;
 }
@@ -57,6 +67,7 @@ void faux_pollfd_free(faux_pollfd_t *faux_pollfd)
 	if (!faux_pollfd)
 		return;
 	faux_vec_free(faux_pollfd->vec);
+	faux_free(faux_pollfd->index);
 	faux_free(faux_pollfd);
 }
 
@@ -120,8 +131,6 @@ struct pollfd *faux_pollfd_item(faux_pollfd_t *faux_pollfd, unsigned int index)
  */
 struct pollfd *faux_pollfd_find(faux_pollfd_t *faux_pollfd, int fd)
 {
-	int index = 0;
-
 	assert(faux_pollfd);
 	if (!faux_pollfd)
 		return NULL;
@@ -129,11 +138,13 @@ struct pollfd *faux_pollfd_find(faux_pollfd_t *faux_pollfd, int fd)
 	if (fd < 0)
 		return NULL;
 
-	index = faux_vec_find(faux_pollfd->vec, &fd, 0);
-	if (index < 0)
+	if ((size_t)fd >= faux_pollfd->index_size)
+		return NULL;
+	if (faux_pollfd->index[fd] < 0)
 		return NULL;
 
-	return (struct pollfd *)faux_vec_item(faux_pollfd->vec, index);
+	return (struct pollfd *)faux_vec_item(faux_pollfd->vec,
+		faux_pollfd->index[fd]);
 }
 
 
@@ -162,12 +173,33 @@ struct pollfd *faux_pollfd_add(faux_pollfd_t *faux_pollfd, int fd, short events)
 	// Don't add duplicated fd
 	pollfd = faux_pollfd_find(faux_pollfd, fd);
 	if (!pollfd) {
+		// Enlarge index
+		if ((size_t)fd >= faux_pollfd->index_size) {
+			size_t new_size = faux_pollfd->index_size * 2;
+			int *new_index = NULL;
+			size_t i = 0;
+
+			if (new_size < FAUX_POLLFD_INDEX_CHUNK)
+				new_size = FAUX_POLLFD_INDEX_CHUNK;
+			if (new_size <= (size_t)fd)
+				new_size = fd + 1;
+			new_index = realloc(faux_pollfd->index,
+				new_size * sizeof(*new_index));
+			assert(new_index);
+			if (!new_index)
+				return NULL;
+			for (i = faux_pollfd->index_size; i < new_size; i++)
+				new_index[i] = -1;
+			faux_pollfd->index = new_index;
+			faux_pollfd->index_size = new_size;
+		}
 		// Create new item
 		pollfd = faux_vec_add(faux_pollfd->vec);
 		assert(pollfd);
 		if (!pollfd)
 			return NULL;
 		pollfd->fd = fd;
+		faux_pollfd->index[fd] = faux_vec_len(faux_pollfd->vec) - 1;
 	}
 
 	pollfd->events = events;
@@ -185,8 +217,6 @@ struct pollfd *faux_pollfd_add(faux_pollfd_t *faux_pollfd, int fd, short events)
  */
 int faux_pollfd_del_by_fd(faux_pollfd_t *faux_pollfd, int fd)
 {
-	int index = 0;
-
 	assert(faux_pollfd);
 	if (!faux_pollfd)
 		return -1;
@@ -194,15 +224,18 @@ int faux_pollfd_del_by_fd(faux_pollfd_t *faux_pollfd, int fd)
 	if (fd < 0)
 		return -1;
 
-	index = faux_vec_find(faux_pollfd->vec, &fd, 0);
-	if (index < 0) // Not found
+	if (!faux_pollfd_find(faux_pollfd, fd)) // Not found
 		return -1;
 
-	return faux_vec_del(faux_pollfd->vec, index);
+	return faux_pollfd_del_by_index(faux_pollfd, faux_pollfd->index[fd]);
 }
 
 
 /** @brief Removes item specified by index.
+ *
+ * The last item is moved to the place of removed one. So the order of
+ * items is not preserved. If the item is removed while iterating by
+ * faux_pollfd_each() then decrement iterator to visit the moved item.
  *
  * @param [in] faux_pollfd Allocated faux_pollfd_t object.
  * @param [in] index Index of item to remove.
@@ -210,11 +243,26 @@ int faux_pollfd_del_by_fd(faux_pollfd_t *faux_pollfd, int fd)
  */
 int faux_pollfd_del_by_index(faux_pollfd_t *faux_pollfd, unsigned int index)
 {
+	struct pollfd *pollfd = NULL;
+	unsigned int last = 0;
+
 	assert(faux_pollfd);
 	if (!faux_pollfd)
 		return -1;
 
-	return faux_vec_del(faux_pollfd->vec, index);
+	pollfd = faux_pollfd_item(faux_pollfd, index);
+	if (!pollfd)
+		return -1;
+	faux_pollfd->index[pollfd->fd] = -1;
+
+	// Move the last item to the hole
+	last = faux_pollfd_len(faux_pollfd) - 1;
+	if (index != last) {
+		*pollfd = *faux_pollfd_item(faux_pollfd, last);
+		faux_pollfd->index[pollfd->fd] = index;
+	}
+
+	return faux_vec_del(faux_pollfd->vec, last);
 }
 
 
@@ -239,6 +287,8 @@ void faux_pollfd_init_iterator(faux_pollfd_t *faux_pollfd, faux_pollfd_iterator_
 /** @brief Iterate through all the vector.
  *
  * The iterator must be initialized first by faux_pollfd_init_iterator().
+ * Removing of current item moves the last item to its place.
+ * @sa faux_pollfd_del_by_index()
  *
  * @param [in] faux_pollfd Allocated faux_pollfd_t object.
  * @param [out] iterator Initialized iterator.
@@ -3,6 +3,14 @@
 #include "faux/net.h"
 #include "faux/vec.h"
 
+// Min size of buffer to send it by MSG_ZEROCOPY. Zerocopy has overhead of
+// page pinning and completion notifications. So it's useless for small
+// buffers. Note faux_net_send() waits for all completions before return
+// because buffer belongs to caller. TCP reports completion when peer
+// acknowledges data. So each zerocopy send costs round trip time and it
+// can reduce throughput on high latency links.
+#define FAUX_NET_ZEROCOPY_MIN 16384
+
 struct faux_net_s {
 	int fd; // File (socket) descriptor
 	int (*isbreak_func)(void);
@@ -11,8 +19,26 @@ struct faux_net_s {
 	struct timespec recv_timeout_val;
 	struct timespec *send_timeout;
 	struct timespec *recv_timeout;
+	char *recv_buf; // Read-ahead buffer. NULL if it's disabled
+	size_t recv_buf_size; // Allocated size of read-ahead buffer
+	size_t recv_buf_pos; // Position of the first buffered byte
+	size_t recv_buf_len; // Number of buffered bytes
+	bool_t zerocopy; // Use MSG_ZEROCOPY for large buffers
 };
 
 struct faux_pollfd_s {
 	faux_vec_t *vec;
-};
\ No newline at end of file
+	int *index; // Position of item within vector indexed by fd. -1 if none
+	size_t index_size; // Allocated size of index
+};
+
+
+C_DECL_BEGIN
+
+ssize_t faux_recvv_min_block(int fd, struct iovec *iov, int iovcnt,
+	size_t min, const struct timespec *timeout, const sigset_t *sigmask,
+	int (*isbreak_func)(void));
+int faux_sendmmsg_emul_nb(int fd, struct mmsghdr *msgs, unsigned int vlen);
+int faux_recvmmsg_emul_nb(int fd, struct mmsghdr *msgs, unsigned int vlen);
+
+C_DECL_END
@@ -0,0 +1,756 @@
+// For struct mmsghdr
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "faux/faux.h"
+#include "faux/str.h"
+#include "faux/time.h"
+#include "faux/net.h"
+#include "faux/testc_helpers.h"
+#include "private.h"
+
+
+// Data size must exceed socket buffer to get partial sendmsg()
+#define TESTC_NET_DATA_LEN (512 * 1024)
+
+// Number of datagrams must exceed socket queue to get partial sendmmsg()
+#define TESTC_NET_MSG_NUM 1024
+#define TESTC_NET_MSG_LEN 1000
+
+
+static void testc_net_fill(char *buf, size_t len)
+{
+	size_t i = 0;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (char)(i * 7 + i / 251);
+}
+
+
+// Forks child to receive expected data from socket
+static pid_t testc_net_receiver(int fd, const char *expected, size_t len)
+{
+	pid_t pid = fork();
+
+	if (0 == pid) {
+		char *rbuf = faux_zmalloc(len);
+		struct timespec timeout = {5, 0};
+		ssize_t r = faux_recv(fd, rbuf, len, &timeout, NULL);
+		_exit((((size_t)r == len) && (memcmp(expected, rbuf, len) == 0)) ?
+			0 : 1);
+	}
+
+	return pid;
+}
+
+
+// Waits for receiver child. Returns 0 if data is received successfully.
+static int testc_net_receiver_wait(pid_t pid)
+{
+	int status = 0;
+
+	if (pid < 0)
+		return -1;
+	if (waitpid(pid, &status, 0) < 0)
+		return -1;
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+		return -1;
+
+	return 0;
+}
+
+
+int testc_faux_net_iov(void)
+{
+	int sv[2] = {-1, -1};
+	char *sbuf = NULL;
+	char *rbuf = NULL;
+	size_t len = TESTC_NET_DATA_LEN;
+	struct timespec timeout = {5, 0};
+	pid_t pid = -1;
+	int status = 0;
+	ssize_t r = 0;
+	int ret = -1; // Pessimistic
+	// Element boundaries of sender and receiver differ. Zero-length
+	// elements are within vectors too.
+	struct iovec siov[] = {
+		{NULL, 0},
+		{NULL, 1},
+		{NULL, 0},
+		{NULL, 300000 - 1},
+		{NULL, 0},
+		{NULL, TESTC_NET_DATA_LEN - 300000},
+		{NULL, 0},
+	};
+	struct iovec riov[] = {
+		{NULL, 7},
+		{NULL, 0},
+		{NULL, 150000},
+		{NULL, 0},
+		{NULL, 0},
+		{NULL, TESTC_NET_DATA_LEN - 150007},
+	};
+	size_t off = 0;
+	unsigned int i = 0;
+
+	sbuf = faux_zmalloc(len);
+	rbuf = faux_zmalloc(len);
+	testc_net_fill(sbuf, len);
+	for (i = 0, off = 0; i < sizeof(siov) / sizeof(siov[0]); i++) {
+		siov[i].iov_base = sbuf + off;
+		off += siov[i].iov_len;
+	}
+	for (i = 0, off = 0; i < sizeof(riov) / sizeof(riov[0]); i++) {
+		riov[i].iov_base = rbuf + off;
+		off += riov[i].iov_len;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		goto err;
+	}
+
+	// Child sends data
+	pid = fork();
+	if (pid < 0)
+		goto err;
+	if (0 == pid) {
+		close(sv[0]);
+		r = faux_sendv(sv[1], siov, sizeof(siov) / sizeof(siov[0]),
+			&timeout, NULL);
+		_exit(((size_t)r == len) ? 0 : 1);
+	}
+	close(sv[1]);
+	sv[1] = -1;
+
+	r = faux_recvv(sv[0], riov, sizeof(riov) / sizeof(riov[0]),
+		&timeout, NULL);
+	if ((size_t)r != len) {
+		printf("faux_recvv: Received %zd bytes\n", r);
+		goto err;
+	}
+	if (waitpid(pid, &status, 0) < 0)
+		goto err;
+	pid = -1;
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+		printf("faux_sendv: Can't send data\n");
+		goto err;
+	}
+	if (memcmp(sbuf, rbuf, len) != 0) {
+		printf("faux_recvv: Received data is broken\n");
+		goto err;
+	}
+
+	// Only zero-length elements
+	riov[0].iov_len = 0;
+	if (faux_recvv(sv[0], riov, 2, &timeout, NULL) != 0) {
+		printf("faux_recvv: Zero-length elements\n");
+		goto err;
+	}
+
+	ret = 0;
+err:
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+	faux_free(sbuf);
+	faux_free(rbuf);
+
+	return ret;
+}
+
+
+int testc_faux_net_recv_buf(void)
+{
+	int sv[2] = {-1, -1};
+	faux_net_t *net = NULL;
+	char sbuf[200] = {};
+	char rbuf[200] = {};
+	struct timespec timeout = {1, 0};
+	struct iovec iov[3] = {};
+	ssize_t r = 0;
+	int ret = -1; // Pessimistic
+
+	testc_net_fill(sbuf, sizeof(sbuf));
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		return -1;
+	}
+	if (faux_send(sv[1], sbuf, sizeof(sbuf), &timeout, NULL) !=
+		sizeof(sbuf))
+		goto err;
+
+	net = faux_net_new();
+	faux_net_set_fd(net, sv[0]);
+	faux_net_set_recv_timeout(net, &timeout);
+	if (!faux_net_set_recv_buf(net, 32)) {
+		printf("faux_net_set_recv_buf: Can't set buffer\n");
+		goto err;
+	}
+
+	// Small read fills buffer
+	if (faux_net_recv(net, rbuf, 5) != 5)
+		goto err;
+	if ((faux_net_recv_buffered(net) == 0) ||
+		(faux_net_recv_buffered(net) > 32)) {
+		printf("faux_net_recv_buffered: Wrong number of bytes %zu\n",
+			faux_net_recv_buffered(net));
+		goto err;
+	}
+
+	// Vector is served by buffer and socket. Buffered data is split
+	// between elements.
+	iov[0].iov_base = rbuf + 5;
+	iov[0].iov_len = 3;
+	iov[1].iov_base = rbuf + 8;
+	iov[1].iov_len = 0;
+	iov[2].iov_base = rbuf + 8;
+	iov[2].iov_len = 60;
+	if (faux_net_recvv(net, iov, 3) != 63) {
+		printf("faux_net_recvv: Wrong number of bytes\n");
+		goto err;
+	}
+
+	// Read more than buffer size
+	if (faux_net_recv(net, rbuf + 68, 100) != 100)
+		goto err;
+
+	// The rest of data and then EOF
+	close(sv[1]);
+	sv[1] = -1;
+	r = faux_net_recv(net, rbuf + 168, 100);
+	if (r != 32) {
+		printf("faux_net_recv: Received %zd bytes before EOF\n", r);
+		goto err;
+	}
+	if (faux_net_recv_buffered(net) != 0)
+		goto err;
+	if (memcmp(sbuf, rbuf, sizeof(sbuf)) != 0) {
+		printf("faux_net_recv: Received data is broken\n");
+		goto err;
+	}
+
+	ret = 0;
+err:
+	faux_net_free(net);
+	close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+
+	return ret;
+}
+
+
+int testc_faux_net_sendfile(void)
+{
+	int sv[2] = {-1, -1};
+	int in_fd = -1;
+	char *fn = NULL;
+	char *sbuf = NULL;
+	size_t len = TESTC_NET_DATA_LEN;
+	struct timespec timeout = {5, 0};
+	off_t offset = 0;
+	pid_t pid = -1;
+	ssize_t r = 0;
+	int ret = -1; // Pessimistic
+
+	sbuf = faux_zmalloc(len);
+	testc_net_fill(sbuf, len);
+	fn = faux_str_sprintf("%s/sendfile", getenv(FAUX_TESTC_TMPDIR_ENV));
+	if (faux_write_whole_file(fn, sbuf, len, 0600) != (ssize_t)len) {
+		printf("faux_write_whole_file: Can't write %s\n", fn);
+		goto err;
+	}
+	in_fd = open(fn, O_RDONLY);
+	if (in_fd < 0)
+		goto err;
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		goto err;
+	}
+
+	// Blocking socket. Data is copied through intermediate buffer.
+	pid = testc_net_receiver(sv[0], sbuf, len);
+	r = faux_sendfile(sv[1], in_fd, &offset, len, &timeout, NULL);
+	if (testc_net_receiver_wait(pid) < 0) {
+		printf("faux_sendfile: Blocking socket. Data is broken\n");
+		goto err;
+	}
+	pid = -1;
+	if (((size_t)r != len) || ((size_t)offset != len)) {
+		printf("faux_sendfile: Blocking socket. Sent %zd bytes\n", r);
+		goto err;
+	}
+
+	// Non-blocking socket. The sendfile() waits for socket many times
+	// because data exceeds socket buffer. Current file position is used.
+	if (fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK) < 0)
+		goto err;
+	if (lseek(in_fd, 0, SEEK_SET) < 0)
+		goto err;
+	pid = testc_net_receiver(sv[0], sbuf, len);
+	r = faux_sendfile(sv[1], in_fd, NULL, len, &timeout, NULL);
+	if (testc_net_receiver_wait(pid) < 0) {
+		printf("faux_sendfile: Non-blocking socket. Data is broken\n");
+		goto err;
+	}
+	pid = -1;
+	if (((size_t)r != len) || (lseek(in_fd, 0, SEEK_CUR) != (off_t)len)) {
+		printf("faux_sendfile: Non-blocking socket. Sent %zd bytes\n", r);
+		goto err;
+	}
+
+	// Range beyond EOF is truncated
+	offset = len - 100;
+	pid = testc_net_receiver(sv[0], sbuf + offset, 100);
+	r = faux_sendfile(sv[1], in_fd, &offset, 1000, &timeout, NULL);
+	if ((testc_net_receiver_wait(pid) < 0) || (r != 100) ||
+		((size_t)offset != len)) {
+		printf("faux_sendfile: Range beyond EOF. Sent %zd bytes\n", r);
+		goto err;
+	}
+	pid = -1;
+
+	ret = 0;
+err:
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+	if (in_fd >= 0)
+		close(in_fd);
+	faux_str_free(fn);
+	faux_free(sbuf);
+
+	return ret;
+}
+
+
+int testc_faux_net_zerocopy(void)
+{
+	int lfd = -1;
+	int cfd = -1;
+	int afd = -1;
+	struct sockaddr_in addr = {};
+	socklen_t addr_len = sizeof(addr);
+	faux_net_t *net = NULL;
+	char *sbuf = NULL;
+	size_t len = TESTC_NET_DATA_LEN;
+	struct timespec timeout = {5, 0};
+	bool_t copied = BOOL_FALSE;
+	pid_t pid = -1;
+	ssize_t r = 0;
+	int ret = -1; // Pessimistic
+
+	sbuf = faux_zmalloc(len);
+	testc_net_fill(sbuf, len);
+
+	// Zerocopy is supported by TCP sockets only
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	if ((lfd < 0) ||
+		(bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+		(listen(lfd, 1) < 0) ||
+		(getsockname(lfd, (struct sockaddr *)&addr, &addr_len) < 0)) {
+		printf("Can't create listening socket\n");
+		goto err;
+	}
+	cfd = socket(AF_INET, SOCK_STREAM, 0);
+	if ((cfd < 0) ||
+		(connect(cfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+		printf("Can't connect to listening socket\n");
+		goto err;
+	}
+	afd = accept(lfd, NULL, NULL);
+	if (afd < 0)
+		goto err;
+
+	net = faux_net_new();
+	faux_net_set_fd(net, cfd);
+	faux_net_set_send_timeout(net, &timeout);
+	if (!faux_net_set_zerocopy(net, BOOL_TRUE)) {
+		printf("Zerocopy is not supported. Skip\n");
+		ret = 0;
+		goto err;
+	}
+
+	// Kernel copies data for loopback anyway but completions are
+	// reported. So net object falls back to regular sending.
+	pid = testc_net_receiver(afd, sbuf, len);
+	r = faux_send_zerocopy(cfd, sbuf, len, &timeout, NULL, &copied);
+	if ((testc_net_receiver_wait(pid) < 0) || ((size_t)r != len)) {
+		printf("faux_send_zerocopy: Sent %zd bytes\n", r);
+		goto err;
+	}
+	pid = -1;
+	if (!copied) {
+		printf("faux_send_zerocopy: Loopback data is not copied\n");
+		goto err;
+	}
+
+	pid = testc_net_receiver(afd, sbuf, len);
+	r = faux_net_send(net, sbuf, len);
+	if ((testc_net_receiver_wait(pid) < 0) || ((size_t)r != len)) {
+		printf("faux_net_send: Sent %zd bytes with zerocopy\n", r);
+		goto err;
+	}
+	pid = -1;
+	pid = testc_net_receiver(afd, sbuf, len);
+	r = faux_net_send(net, sbuf, len);
+	if ((testc_net_receiver_wait(pid) < 0) || ((size_t)r != len)) {
+		printf("faux_net_send: Sent %zd bytes after fallback\n", r);
+		goto err;
+	}
+	pid = -1;
+
+	ret = 0;
+err:
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+	faux_net_free(net);
+	if (lfd >= 0)
+		close(lfd);
+	if (cfd >= 0)
+		close(cfd);
+	if (afd >= 0)
+		close(afd);
+	faux_free(sbuf);
+
+	return ret;
+}
+
+
+int testc_faux_net_send_recv(void)
+{
+	int sv[2] = {-1, -1};
+	char *sbuf = NULL;
+	char *rbuf = NULL;
+	size_t len = TESTC_NET_DATA_LEN;
+	struct timespec zero = {0, 0};
+	struct timespec timeout = {0, 100000000}; // 100ms
+	struct timespec long_timeout = {5, 0};
+	faux_nsec_t start = 0;
+	faux_nsec_t elapsed = 0;
+	pid_t pid = -1;
+	ssize_t r = 0;
+	int ret = -1; // Pessimistic
+
+	sbuf = faux_zmalloc(len);
+	rbuf = faux_zmalloc(len);
+	testc_net_fill(sbuf, len);
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		goto err;
+	}
+
+	// Socket is ready. Data is transferred without waiting even if
+	// timeout is zero.
+	r = faux_send(sv[1], sbuf, 100, &zero, NULL);
+	if (r != 100) {
+		printf("faux_send: Ready socket. Sent %zd bytes\n", r);
+		goto err;
+	}
+	r = faux_recv(sv[0], rbuf, 100, &zero, NULL);
+	if ((r != 100) || (memcmp(sbuf, rbuf, 100) != 0)) {
+		printf("faux_recv: Available data. Received %zd bytes\n", r);
+		goto err;
+	}
+
+	// Part of data is available. The rest is waited for till timeout.
+	if (faux_send(sv[1], sbuf, 100, &zero, NULL) != 100)
+		goto err;
+	start = faux_nsec_now_monotonic();
+	r = faux_recv(sv[0], rbuf, 200, &timeout, NULL);
+	elapsed = faux_nsec_now_monotonic() - start;
+	if (r != 100) {
+		printf("faux_recv: Timeout. Received %zd bytes\n", r);
+		goto err;
+	}
+	if (elapsed < 90000000) { // 90ms
+		printf("faux_recv: Returned before timeout\n");
+		goto err;
+	}
+
+	// Data arrives while waiting
+	pid = fork();
+	if (pid < 0)
+		goto err;
+	if (0 == pid) {
+		usleep(50000);
+		_exit((faux_send(sv[1], sbuf, 100, &long_timeout, NULL) ==
+			100) ? 0 : 1);
+	}
+	r = faux_recv(sv[0], rbuf, 100, &long_timeout, NULL);
+	waitpid(pid, NULL, 0);
+	pid = -1;
+	if ((r != 100) || (memcmp(sbuf, rbuf, 100) != 0)) {
+		printf("faux_recv: Waited data. Received %zd bytes\n", r);
+		goto err;
+	}
+
+	// Nobody reads so socket buffer becomes full. The rest of data is
+	// waited for till timeout.
+	start = faux_nsec_now_monotonic();
+	r = faux_send(sv[1], sbuf, len, &timeout, NULL);
+	elapsed = faux_nsec_now_monotonic() - start;
+	if ((r <= 0) || ((size_t)r >= len)) {
+		printf("faux_send: Full socket. Sent %zd bytes\n", r);
+		goto err;
+	}
+	if (elapsed < 90000000) { // 90ms
+		printf("faux_send: Returned before timeout\n");
+		goto err;
+	}
+
+	ret = 0;
+err:
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+	faux_free(sbuf);
+	faux_free(rbuf);
+
+	return ret;
+}
+
+
+// Prepares array of messages. Each datagram gets its number within data.
+static void testc_net_mmsg_init(struct mmsghdr *msgs, struct iovec *iov,
+	char *buf, unsigned int num)
+{
+	unsigned int i = 0;
+
+	memset(msgs, 0, num * sizeof(*msgs));
+	for (i = 0; i < num; i++) {
+		iov[i].iov_base = buf + i * TESTC_NET_MSG_LEN;
+		iov[i].iov_len = TESTC_NET_MSG_LEN;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		memset(iov[i].iov_base, (char)i, TESTC_NET_MSG_LEN);
+	}
+}
+
+
+int testc_faux_net_mmsg(void)
+{
+	int sv[2] = {-1, -1};
+	struct mmsghdr *smsgs = NULL;
+	struct mmsghdr *rmsgs = NULL;
+	struct iovec *siov = NULL;
+	struct iovec *riov = NULL;
+	char *sbuf = NULL;
+	char *rbuf = NULL;
+	unsigned int num = TESTC_NET_MSG_NUM;
+	struct timespec timeout = {0, 100000000}; // 100ms
+	int sent = 0;
+	int received = 0;
+	int r = 0;
+	int i = 0;
+	int ret = -1; // Pessimistic
+
+	smsgs = faux_zmalloc(num * sizeof(*smsgs));
+	rmsgs = faux_zmalloc(num * sizeof(*rmsgs));
+	siov = faux_zmalloc(num * sizeof(*siov));
+	riov = faux_zmalloc(num * sizeof(*riov));
+	sbuf = faux_zmalloc(num * TESTC_NET_MSG_LEN);
+	rbuf = faux_zmalloc(num * TESTC_NET_MSG_LEN);
+	testc_net_mmsg_init(smsgs, siov, sbuf, num);
+	testc_net_mmsg_init(rmsgs, riov, rbuf, num);
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0) {
+		printf("socketpair: Can't create sockets\n");
+		goto err;
+	}
+
+	// Nobody reads datagrams so only part of batch is sent before timeout
+	sent = faux_sendmm(sv[1], smsgs, num, &timeout, NULL);
+	if ((sent <= 0) || ((unsigned int)sent >= num)) {
+		printf("faux_sendmm: Sent %d datagrams of %u\n", sent, num);
+		goto err;
+	}
+	if (smsgs[0].msg_len != TESTC_NET_MSG_LEN) {
+		printf("faux_sendmm: Wrong msg_len %u\n", smsgs[0].msg_len);
+		goto err;
+	}
+
+	// Batch is smaller than number of available datagrams
+	r = faux_recvmm(sv[0], rmsgs, 4, &timeout, NULL);
+	if (r != 4) {
+		printf("faux_recvmm: Received %d datagrams of 4\n", r);
+		goto err;
+	}
+	received = r;
+	// Function doesn't wait for the whole batch
+	while (received < sent) {
+		r = faux_recvmm(sv[0], rmsgs + received, num - received,
+			&timeout, NULL);
+		if (r <= 0) {
+			printf("faux_recvmm: Received %d of %d datagrams\n",
+				received, sent);
+			goto err;
+		}
+		received += r;
+	}
+	for (i = 0; i < received; i++) {
+		if ((rmsgs[i].msg_len != TESTC_NET_MSG_LEN) ||
+			(memcmp(riov[i].iov_base, siov[i].iov_base,
+			TESTC_NET_MSG_LEN) != 0)) {
+			printf("faux_recvmm: Datagram %d is broken\n", i);
+			goto err;
+		}
+	}
+
+	// Timeout
+	r = faux_recvmm(sv[0], rmsgs, num, &timeout, NULL);
+	if (r != 0) {
+		printf("faux_recvmm: Timeout returns %d\n", r);
+		goto err;
+	}
+
+	// Fallback for systems without sendmmsg() and recvmmsg()
+	memset(rbuf, 0, num * TESTC_NET_MSG_LEN);
+	r = faux_sendmmsg_emul_nb(sv[1], smsgs, 3);
+	if (r != 3) {
+		printf("faux_sendmmsg_emul_nb: Sent %d datagrams of 3\n", r);
+		goto err;
+	}
+	r = faux_recvmmsg_emul_nb(sv[0], rmsgs, 5);
+	if ((r != 3) || (memcmp(rbuf, sbuf, 3 * TESTC_NET_MSG_LEN) != 0)) {
+		printf("faux_recvmmsg_emul_nb: Received %d datagrams of 3\n", r);
+		goto err;
+	}
+	if (faux_recvmmsg_emul_nb(sv[0], rmsgs, 5) >= 0) {
+		printf("faux_recvmmsg_emul_nb: Received from empty socket\n");
+		goto err;
+	}
+	r = faux_sendmmsg_emul_nb(sv[1], smsgs, num);
+	if ((r <= 0) || ((unsigned int)r >= num)) {
+		printf("faux_sendmmsg_emul_nb: Sent %d datagrams of %u\n", r, num);
+		goto err;
+	}
+
+	ret = 0;
+err:
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+	faux_free(smsgs);
+	faux_free(rmsgs);
+	faux_free(siov);
+	faux_free(riov);
+	faux_free(sbuf);
+	faux_free(rbuf);
+
+	return ret;
+}
+
+
+int testc_faux_pollfd(void)
+{
+	faux_pollfd_t *pollfds = NULL;
+	faux_pollfd_iterator_t iter = 0;
+	struct pollfd *pollfd = NULL;
+	unsigned int seen = 0;
+	int fd = 0;
+	int ret = -1; // Pessimistic
+
+	pollfds = faux_pollfd_new();
+	for (fd = 3; fd < 8; fd++) {
+		if (!faux_pollfd_add(pollfds, fd, POLLIN)) {
+			printf("faux_pollfd_add: Can't add fd %d\n", fd);
+			goto err;
+		}
+	}
+	// Duplicated fd updates existing item
+	pollfd = faux_pollfd_add(pollfds, 5, POLLOUT);
+	if (!pollfd || (pollfd->events != POLLOUT) ||
+		(faux_pollfd_len(pollfds) != 5)) {
+		printf("faux_pollfd_add: Duplicated fd\n");
+		goto err;
+	}
+
+	// Removing moves the last item (fd 7) to the hole
+	if (faux_pollfd_del_by_fd(pollfds, 4) < 0)
+		goto err;
+	pollfd = faux_pollfd_item(pollfds, 1);
+	if (!pollfd || (pollfd->fd != 7) || (faux_pollfd_len(pollfds) != 4) ||
+		(faux_pollfd_find(pollfds, 7) != pollfd) ||
+		faux_pollfd_find(pollfds, 4)) {
+		printf("faux_pollfd_del_by_fd: Wrong swap with the last item\n");
+		goto err;
+	}
+	if (faux_pollfd_del_by_fd(pollfds, 4) == 0) {
+		printf("faux_pollfd_del_by_fd: Removed absent fd\n");
+		goto err;
+	}
+
+	// Reused fd gets new item
+	pollfd = faux_pollfd_add(pollfds, 4, POLLPRI);
+	if (!pollfd || (pollfd->events != POLLPRI) || (pollfd->revents != 0) ||
+		(faux_pollfd_find(pollfds, 4) != pollfd)) {
+		printf("faux_pollfd_add: Reused fd\n");
+		goto err;
+	}
+
+	// Index grows past initial size
+	if (!faux_pollfd_add(pollfds, 64, POLLIN) ||
+		!faux_pollfd_add(pollfds, 1000, POLLIN)) {
+		printf("faux_pollfd_add: Can't grow index\n");
+		goto err;
+	}
+	for (fd = 3; fd < 8; fd++) {
+		pollfd = faux_pollfd_find(pollfds, fd);
+		if (!pollfd || (pollfd->fd != fd)) {
+			printf("faux_pollfd_find: Lost fd %d after growth\n", fd);
+			goto err;
+		}
+	}
+	if (!faux_pollfd_find(pollfds, 1000) || faux_pollfd_find(pollfds, 999) ||
+		faux_pollfd_find(pollfds, 5000)) {
+		printf("faux_pollfd_find: Wrong search after growth\n");
+		goto err;
+	}
+
+	// Remove items while iterating. Decremented iterator visits moved item.
+	faux_pollfd_init_iterator(pollfds, &iter);
+	while ((pollfd = faux_pollfd_each(pollfds, &iter))) {
+		seen++;
+		if (pollfd->fd % 2 == 0) {
+			faux_pollfd_del_by_index(pollfds, iter - 1);
+			iter--;
+		}
+	}
+	if ((seen != 7) || (faux_pollfd_len(pollfds) != 3) ||
+		!faux_pollfd_find(pollfds, 3) || !faux_pollfd_find(pollfds, 5) ||
+		!faux_pollfd_find(pollfds, 7)) {
+		printf("faux_pollfd_each: Wrong removal within iteration\n");
+		goto err;
+	}
+
+	ret = 0;
+err:
+	faux_pollfd_free(pollfds);
+
+	return ret;
+}
@@ -5,6 +5,8 @@
 #ifndef _faux_sched_h
 #define _faux_sched_h
 
+#include <stdint.h>
+
 #include <faux/list.h>
 #include <faux/faux.h>
 #include <faux/time.h>
@@ -27,22 +29,40 @@ C_DECL_BEGIN
 faux_sched_t *faux_sched_new(void);
 void faux_sched_free(faux_sched_t *sched);
 
-int faux_sched_once(
+faux_ev_t *faux_sched_once(
 	faux_sched_t *sched, const struct timespec *time, int ev_id, void *data);
-int faux_sched_once_delayed(faux_sched_t *sched,
+faux_ev_t *faux_sched_once_delayed(faux_sched_t *sched,
 	const struct timespec *interval, int ev_id, void *data);
-int faux_sched_periodic(
+faux_ev_t *faux_sched_periodic(
 	faux_sched_t *sched, const struct timespec *time, int ev_id, void *data,
 	const struct timespec *period, unsigned int cycle_num);
-int faux_sched_periodic_delayed(
+faux_ev_t *faux_sched_periodic_delayed(
 	faux_sched_t *sched, int ev_id, void *data,
 	const struct timespec *period, unsigned int cycle_num);
 int faux_sched_next_interval(faux_sched_t *sched, struct timespec *interval);
+int faux_sched_next_time(faux_sched_t *sched, struct timespec *time);
 void faux_sched_empty(faux_sched_t *sched);
+size_t faux_sched_len(const faux_sched_t *sched);
 int faux_sched_pop(faux_sched_t *sched, int *ev_id, void **data);
+int faux_sched_pop_at(faux_sched_t *sched, faux_nsec_t now,
+	int *ev_id, void **data);
 int faux_sched_remove_by_id(faux_sched_t *sched, int id);
 int faux_sched_remove_by_data(faux_sched_t *sched, void *data);
 const struct timespec *faux_sched_time_by_data(faux_sched_t *sched, void *data);
+int faux_sched_set_slack(faux_sched_t *sched, int id,
+	const struct timespec *slack);
+uint64_t faux_sched_wakeups_saved(const faux_sched_t *sched);
+
+// Operations by event handle
+int faux_sched_del(faux_sched_t *sched, faux_ev_t *ev);
+int faux_sched_reschedule(faux_sched_t *sched, faux_ev_t *ev,
+	const struct timespec *time);
+int faux_sched_reschedule_delayed(faux_sched_t *sched, faux_ev_t *ev,
+	const struct timespec *interval);
+int faux_sched_time_left(const faux_sched_t *sched, const faux_ev_t *ev,
+	struct timespec *left);
+faux_ev_t *faux_sched_hold(faux_ev_t *ev);
+void faux_sched_release(faux_ev_t *ev);
 
 C_DECL_END
 
@@ -14,7 +14,8 @@
 
 /** @brief Callback function to compare two events by time.
  *
- * It's used for ordering within schedule list.
+ * It's used for ordering within schedule heap. Events with equal time are
+ * ordered by sequence number i.e. by the order of scheduling.
  *
  * @param [in] first First event to compare.
  * @param [in] second Second event to compare.
@@ -28,58 +29,27 @@ int faux_ev_compare(const void *first, const void *second)
 	const faux_ev_t *f = (const faux_ev_t *)first;
 	const faux_ev_t *s = (const faux_ev_t *)second;
 
-	return faux_timespec_cmp(&(f->time), &(s->time));
-}
-
-
-/** @brief Callback function to compare key and list item by ID.
- *
- * It's used to search for specified ID within schedule list.
- *
- * @param [in] key Pointer to key value
- * @param [in] list_item Pointer to list item.
- * @return
- * > 0 if key > list_item,
- * 0 - equal,
- * < 0 if key < list_item
- */
-int faux_ev_compare_id(const void *key, const void *list_item)
-{
-	int *f = (int *)key;
-	const faux_ev_t *s = (const faux_ev_t *)list_item;
-
-	return ((*f == s->id) ? 0 : 1);
-}
-
-
-/** @brief Callback function to compare key and list item by data pointer.
- *
- * It's used to search for specified data pointer within schedule list.
- *
- * @param [in] key Pointer to key value
- * @param [in] list_item Pointer to list item.
- * @return
- * > 0 if key > list_item,
- * 0 - equal,
- * < 0 if key < list_item
- */
-int faux_ev_compare_data(const void *key, const void *list_item)
-{
-	void *f = (void *)key;
-	const faux_ev_t *s = (const faux_ev_t *)list_item;
+	if (f->time > s->time)
+		return 1;
+	if (f->time < s->time)
+		return -1;
+	if (f->seq > s->seq)
+		return 1;
+	if (f->seq < s->seq)
+		return -1;
 
-	return ((f == s->data) ? 0 : 1);
+	return 0;
 }
 
 
 /** @brief Allocates and initialize ev object.
  *
- * @param [in] time Time of event.
+ * @param [in] time Time of event (nanoseconds).
  * @param [in] ev_id ID of event.
  * @param [in] data Pointer to arbitrary linked data.
  * @return Allocated and initialized ev object.
  */
-faux_ev_t *faux_ev_new(const struct timespec *time, int ev_id, void *data)
+faux_ev_t *faux_ev_new(faux_nsec_t time, int ev_id, void *data)
 {
 	faux_ev_t *ev = NULL;
 
@@ -93,7 +63,8 @@ faux_ev_t *faux_ev_new(const struct timespec *time, int ev_id, void *data)
 	ev->data = data;
 	ev->periodic = FAUX_SCHED_ONCE; // Not periodic by default
 	ev->cycle_num = 0;
-	faux_nsec_to_timespec(&(ev->period), 0l);
+	ev->period = 0;
+	ev->slack = 0;
 	faux_ev_reschedule(ev, time);
 
 	return ev;
@@ -119,22 +90,21 @@ void faux_ev_free(void *ptr)
  * By default new events are not periodic.
  *
  * @param [in] ev Allocated and initialized ev object.
- * @param [in] period Period of periodic event.
+ * @param [in] period Period of periodic event (nanoseconds).
  * @param [in] cycle_num Number of cycles. FAUX_SHED_INFINITE - infinite.
  * @return 0 - success, < 0 on error.
  */
 int faux_ev_periodic(faux_ev_t *ev,
-	const struct timespec *period, unsigned int cycle_num)
+	faux_nsec_t period, unsigned int cycle_num)
 {
 	assert(ev);
-	assert(period);
 	// When cycle_num == 0 then periodic has no meaning
-	if (!ev || !period || cycle_num == 0)
+	if (!ev || cycle_num == 0)
 		return -1;
 
 	ev->periodic = FAUX_SCHED_PERIODIC;
 	ev->cycle_num = cycle_num;
-	ev->period = *period;
+	ev->period = period;
 
 	return 0;
 }
@@ -185,20 +155,16 @@ int faux_ev_dec_cycles(faux_ev_t *ev, unsigned int *new_cycle_num)
  * Note: faux_ev_new() use it. Be carefull.
  *
  * @param [in] ev Allocated and initialized ev object.
- * @param [in] new_time New time of event (FAUX_SCHED_NOW for now).
+ * @param [in] new_time New time of event (nanoseconds).
  * @return 0 - success, < 0 on error.
  */
-int faux_ev_reschedule(faux_ev_t *ev, const struct timespec *new_time)
+int faux_ev_reschedule(faux_ev_t *ev, faux_nsec_t new_time)
 {
 	assert(ev);
 	if (!ev)
 		return -1;
 
-	if (new_time) {
-		ev->time = *new_time;
-	} else { // Time isn't given so use "NOW"
-		faux_timespec_now(&(ev->time));
-	}
+	ev->time = new_time;
 
 	return 0;
 }
@@ -215,8 +181,6 @@ int faux_ev_reschedule(faux_ev_t *ev, const struct timespec *new_time)
  */
 int faux_ev_reschedule_period(faux_ev_t *ev)
 {
-	struct timespec new_time = {};
-
 	assert(ev);
 	if (!ev)
 		return -1;
@@ -225,8 +189,7 @@ int faux_ev_reschedule_period(faux_ev_t *ev)
 	if (ev->cycle_num <= 1)
 		return -1; // We don't need to reschedule if last cycle left
 
-	faux_timespec_sum(&new_time, &(ev->time), &(ev->period));
-	faux_ev_reschedule(ev, &new_time);
+	faux_ev_reschedule(ev, ev->time + ev->period);
 
 	if (ev->cycle_num != FAUX_SCHED_INFINITE)
 		faux_ev_dec_cycles(ev, NULL);
@@ -235,32 +198,62 @@ int faux_ev_reschedule_period(faux_ev_t *ev)
 }
 
 
-/** @brief Calculates time left from now to the event.
+/** @brief Sets slack of event.
+ *
+ * The slack is allowed delay of event. Scheduler can postpone event within
+ * slack to handle it together with another events. The slack is kept while
+ * periodic event rescheduling.
  *
  * @param [in] ev Allocated and initialized ev object.
- * @param [out] left Calculated time left.
+ * @param [in] slack Slack value (nanoseconds).
  * @return 0 - success, < 0 on error.
  */
-int faux_ev_time_left(faux_ev_t *ev, struct timespec *left)
+int faux_ev_set_slack(faux_ev_t *ev, faux_nsec_t slack)
 {
-	struct timespec now = {};
-
 	assert(ev);
-	assert(left);
-	if (!ev || !left)
+	if (!ev)
 		return -1;
 
-	faux_timespec_now(&now);
-	if (faux_timespec_cmp(&now, &(ev->time)) > 0) { // Already happend
-		faux_nsec_to_timespec(left, 0l);
-		return 0;
-	}
-	faux_timespec_diff(left, &(ev->time), &now);
+	ev->slack = slack;
 
 	return 0;
 }
 
 
+/** Returns slack of event object.
+ *
+ * @param [in] ev Allocated and initialized ev object.
+ * @return Slack in nanoseconds.
+ */
+faux_nsec_t faux_ev_slack(const faux_ev_t *ev)
+{
+	assert(ev);
+	if (!ev)
+		return 0;
+
+	return ev->slack;
+}
+
+
+/** @brief Calculates time left from specified time to the event.
+ *
+ * @param [in] ev Allocated and initialized ev object.
+ * @param [in] now Current time (nanoseconds).
+ * @return Time left in nanoseconds. 0 if event is already happend.
+ */
+faux_nsec_t faux_ev_time_left(const faux_ev_t *ev, faux_nsec_t now)
+{
+	assert(ev);
+	if (!ev)
+		return 0;
+
+	if (now > ev->time) // Already happend
+		return 0;
+
+	return ev->time - now;
+}
+
+
 /** Returns ID of event object.
  *
  * @param [in] ev Allocated and initialized ev object.
@@ -292,15 +285,34 @@ void *faux_ev_data(const faux_ev_t *ev)
 
 
 /** Returns time of event object.
+ *
+ * @param [in] ev Allocated and initialized ev object.
+ * @return Time of event in nanoseconds.
+ */
+faux_nsec_t faux_ev_time(const faux_ev_t *ev)
+{
+	assert(ev);
+	if (!ev)
+		return 0;
+
+	return ev->time;
+}
+
+
+/** Returns time of event object as struct timespec.
+ *
+ * The time is converted on demand. It's for public API only.
  *
  * @param [in] ev Allocated and initialized ev object.
  * @return Pointer to static timespec.
  */
-const struct timespec *faux_ev_time(const faux_ev_t *ev)
+const struct timespec *faux_ev_time_ts(faux_ev_t *ev)
 {
 	assert(ev);
 	if (!ev)
 		return NULL;
 
-	return &(ev->time);
+	faux_nsec_to_timespec(&(ev->time_ts), ev->time);
+
+	return &(ev->time_ts);
 }
@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #include "faux/faux.h"
 #include "faux/list.h"
 #include "faux/time.h"
@@ -5,38 +7,54 @@
 
 
 struct faux_ev_s {
-	struct timespec time; // Planned time of event
-	struct timespec period; // Period for periodic event
+	faux_nsec_t time; // Planned time of event
+	faux_nsec_t period; // Period for periodic event
+	faux_nsec_t slack; // Allowed delay to coalesce with other events
+	struct timespec time_ts; // Planned time in public format
 	unsigned int cycle_num; // Number of cycles for periodic event
 	faux_sched_periodic_t periodic; // Periodic flag
 	int id; // Type of event
 	void *data; // Arbitrary data linked to event
+	size_t index; // Position within sched heap. SIZE_MAX if not scheduled
+	unsigned int refcnt; // Number of handle holders
+	uint64_t seq; // Sequence number to order events with equal time
 };
 
 struct faux_sched_s {
-	faux_list_t *list;
+	faux_ev_t **heap; // Binary min-heap of events ordered by time
+	size_t len; // Number of events within heap
+	size_t size; // Allocated heap size
+	uint64_t seq; // Sequence counter for newly scheduled events
+	faux_nsec_t deadline; // Cached earliest deadline of events
+	bool_t deadline_valid; // Is cached deadline actual
+	faux_nsec_t wakeup; // Last planned wakeup time
+	bool_t wakeup_set; // Is wakeup time planned
+	faux_nsec_t batch_time; // Time of last event popped within wakeup
+	bool_t batch_popped; // Was something popped within planned wakeup
+	uint64_t wakeups_saved; // Number of wakeups saved by slack
 };
 
 
 C_DECL_BEGIN
 
 int faux_ev_compare(const void *first, const void *second);
-int faux_ev_compare_id(const void *key, const void *list_item);
-int faux_ev_compare_data(const void *key, const void *list_item);
 
-faux_ev_t *faux_ev_new(const struct timespec *time, int ev_id, void *data);
+faux_ev_t *faux_ev_new(faux_nsec_t time, int ev_id, void *data);
 void faux_ev_free(void *ptr);
 
 int faux_ev_periodic(faux_ev_t *ev,
-	const struct timespec *interval, unsigned int cycle_num);
+	faux_nsec_t period, unsigned int cycle_num);
 int faux_ev_dec_cycles(faux_ev_t *ev, unsigned int *new_cycle_num);
-int faux_ev_reschedule(faux_ev_t *ev, const struct timespec *new_time);
+int faux_ev_reschedule(faux_ev_t *ev, faux_nsec_t new_time);
 int faux_ev_reschedule_period(faux_ev_t *ev);
-int faux_ev_time_left(faux_ev_t *ev, struct timespec *left);
+int faux_ev_set_slack(faux_ev_t *ev, faux_nsec_t slack);
+faux_nsec_t faux_ev_slack(const faux_ev_t *ev);
+faux_nsec_t faux_ev_time_left(const faux_ev_t *ev, faux_nsec_t now);
 
 int faux_ev_id(const faux_ev_t *ev);
 void *faux_ev_data(const faux_ev_t *ev);
-const struct timespec *faux_ev_time(const faux_ev_t *ev);
+faux_nsec_t faux_ev_time(const faux_ev_t *ev);
+const struct timespec *faux_ev_time_ts(faux_ev_t *ev);
 faux_sched_periodic_t faux_ev_is_periodic(faux_ev_t *ev);
 
 C_DECL_END
@@ -1,7 +1,9 @@
 /** @brief Mechanism to shedule events.
  *
- * It's an ordered list of events. Events are ordered by the time. The earlier
- * events are closer to list head. The events can be one-time ("once") and
+ * It's a binary min-heap of events. Events are ordered by the time. The
+ * earliest event is the heap root. So scheduling and popping of event
+ * costs O(log n). Events with equal time are popped in order of
+ * scheduling. The events can be one-time ("once") and
  * periodic. Periodic events have period and number of cycles (can be infinite).
  * User can schedule events specifying absolute time of future event or interval
  * from now to the moment of event. Periodic events will be rescheduled
@@ -10,9 +12,28 @@
  * User can get interval from now to next event time. User can get upcoming
  * events one-by-one.
  *
+ * The absolute time is CLOCK_MONOTONIC time (see
+ * faux_timespec_now_monotonic()). So scheduling is not affected by system
+ * time changes. Internally time is stored in nanoseconds (faux_nsec_t) and
+ * struct timespec is converted at API boundaries only.
+ *
  * Each scheduled event can has arbitrary ID and pointer to arbitrary data
  * linked to this event. The ID can be used for type of event for
  * example or something else. The linked data can be a service structure.
+ *
+ * Scheduling functions return event handle. The handle can be used to
+ * remove or reschedule event for O(log n) and to get time left for O(1).
+ * Event is freed when it's removed or popped for the last time (once event
+ * is popped for the first time). So handle becomes invalid at this moment
+ * and must not be used. If caller keeps the handle for a longer time then it
+ * must hold it by faux_sched_hold(). Held event is not freed until
+ * faux_sched_release(). The handle functions return error for held event
+ * that is not scheduled anymore.
+ *
+ * Event can have a slack i.e. allowed delay. The planned wakeup time is
+ * the earliest deadline ("time" + "slack") among all events. So events
+ * with overlapping windows are handled by single wakeup. The number of
+ * saved wakeups is counted.
  */
 
 #include <sys/time.h>
@@ -28,6 +49,10 @@
 #include "faux/sched.h"
 
 
+/** @brief Initial size of events heap */
+#define FAUX_SCHED_HEAP_CHUNK 16
+
+
 /** @brief Allocates new sched object.
  *
  * Before working with sched object it must be allocated and initialized.
@@ -43,8 +68,14 @@ faux_sched_t *faux_sched_new(void)
 		return NULL;
 
 	// Init
-	sched->list = faux_list_new(FAUX_LIST_SORTED, FAUX_LIST_NONUNIQUE,
-		faux_ev_compare, NULL, faux_ev_free);
+	sched->heap = NULL;
+	sched->len = 0;
+	sched->size = 0;
+	sched->seq = 0;
+	sched->deadline_valid = BOOL_FALSE;
+	sched->wakeup_set = BOOL_FALSE;
+	sched->batch_popped = BOOL_FALSE;
+	sched->wakeups_saved = 0;
 
 	return sched;
 }
@@ -60,12 +91,134 @@ void faux_sched_free(faux_sched_t *sched)
 	if (!sched)
 		return;
 
-	faux_list_free(sched->list);
+	faux_sched_empty(sched);
+	faux_free(sched->heap);
 	faux_free(sched);
 }
 
 
-/** @brief Internal function to add existent event to scheduling list.
+/** @brief Internal function to invalidate cached deadline.
+ *
+ * It must be called on each change of heap or events within heap.
+ */
+static void _sched_changed(faux_sched_t *sched)
+{
+	sched->deadline_valid = BOOL_FALSE;
+}
+
+
+/** @brief Internal function to place event to the heap position.
+ */
+static void _sched_heap_set(faux_sched_t *sched, size_t index, faux_ev_t *ev)
+{
+	sched->heap[index] = ev;
+	ev->index = index;
+}
+
+
+/** @brief Internal function to move event up to the heap root.
+ */
+static void _sched_sift_up(faux_sched_t *sched, size_t index)
+{
+	faux_ev_t *ev = sched->heap[index];
+
+	while (index > 0) {
+		size_t parent = (index - 1) / 2;
+		if (faux_ev_compare(sched->heap[parent], ev) <= 0)
+			break;
+		_sched_heap_set(sched, index, sched->heap[parent]);
+		index = parent;
+	}
+	_sched_heap_set(sched, index, ev);
+}
+
+
+/** @brief Internal function to move event down to the heap leaves.
+ */
+static void _sched_sift_down(faux_sched_t *sched, size_t index)
+{
+	faux_ev_t *ev = sched->heap[index];
+
+	while (1) {
+		size_t child = index * 2 + 1;
+		if (child >= sched->len)
+			break;
+		if ((child + 1 < sched->len) && (faux_ev_compare(
+			sched->heap[child + 1], sched->heap[child]) < 0))
+			child++;
+		if (faux_ev_compare(ev, sched->heap[child]) <= 0)
+			break;
+		_sched_heap_set(sched, index, sched->heap[child]);
+		index = child;
+	}
+	_sched_heap_set(sched, index, ev);
+}
+
+
+/** @brief Internal function to restore heap order after event change.
+ */
+static void _sched_fix(faux_sched_t *sched, size_t index)
+{
+	if ((index > 0) && (faux_ev_compare(sched->heap[index],
+		sched->heap[(index - 1) / 2]) < 0))
+		_sched_sift_up(sched, index);
+	else
+		_sched_sift_down(sched, index);
+}
+
+
+/** @brief Internal function to free event that is not scheduled anymore.
+ *
+ * Held event is marked as not scheduled and it's freed on last release.
+ */
+static void _sched_ev_drop(faux_ev_t *ev)
+{
+	ev->index = SIZE_MAX;
+	if (0 == ev->refcnt)
+		faux_ev_free(ev);
+}
+
+
+/** @brief Internal function to check if event belongs to the heap.
+ */
+static bool_t _sched_has_ev(const faux_sched_t *sched, const faux_ev_t *ev)
+{
+	if (!ev)
+		return BOOL_FALSE;
+	if (ev->index >= sched->len)
+		return BOOL_FALSE;
+	if (sched->heap[ev->index] != ev)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+
+/** @brief Internal function to remove event from the heap.
+ *
+ * Event is not freed.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] index Heap position of event to remove.
+ * @return Removed event.
+ */
+static faux_ev_t *_sched_takeaway(faux_sched_t *sched, size_t index)
+{
+	faux_ev_t *ev = sched->heap[index];
+
+	_sched_changed(sched);
+	sched->len--;
+	if (index == sched->len) // It was the last one
+		return ev;
+
+	_sched_heap_set(sched, index, sched->heap[sched->len]);
+	_sched_fix(sched, index);
+
+	return ev;
+}
+
+
+/** @brief Internal function to add existent event to scheduling heap.
  *
  * @param [in] sched Allocated and initialized sched object.
  * @param [in] ev Existent ev object.
@@ -73,16 +226,29 @@ void faux_sched_free(faux_sched_t *sched)
  */
 static int _sched_ev(faux_sched_t *sched, faux_ev_t *ev)
 {
-	faux_list_node_t *node = NULL;
-
 	assert(sched);
 	assert(ev);
 	if (!sched || !ev)
 		return -1;
 
-	node = faux_list_add(sched->list, ev);
-	if (!node) // Something went wrong
-		return -1;
+	// Enlarge heap
+	if (sched->len == sched->size) {
+		size_t new_size = sched->size ?
+			(sched->size * 2) : FAUX_SCHED_HEAP_CHUNK;
+		faux_ev_t **new_heap = realloc(sched->heap,
+			new_size * sizeof(*new_heap));
+		assert(new_heap);
+		if (!new_heap)
+			return -1;
+		sched->heap = new_heap;
+		sched->size = new_size;
+	}
+
+	_sched_changed(sched);
+	ev->seq = sched->seq++;
+	_sched_heap_set(sched, sched->len, ev);
+	sched->len++;
+	_sched_sift_up(sched, ev->index);
 
 	return 0;
 }
@@ -90,49 +256,61 @@ static int _sched_ev(faux_sched_t *sched, faux_ev_t *ev)
 /** @brief Internal function to add constructed event to scheduling list.
  *
  * @param [in] sched Allocated and initialized sched object.
- * @param [in] time Absolute time of future event.
+ * @param [in] time Absolute time of future event (nanoseconds).
  * @param [in] ev_id Event ID.
  * @param [in] data Pointer to arbitrary data linked to event.
  * @param [in] periodic Periodic flag.
- * @param [in] period Periodic interval.
+ * @param [in] period Periodic interval (nanoseconds).
  * @param [in] cycle_num Number of cycles (FAUX_SCHED_INFINITE for infinite).
- * @return 0 - success, < 0 on error.
+ * @return Event handle or NULL on error.
  */
-static int _sched(faux_sched_t *sched, const struct timespec *time,
+static faux_ev_t *_sched(faux_sched_t *sched, faux_nsec_t time,
 	int ev_id, void *data, faux_sched_periodic_t periodic,
-	const struct timespec *period, unsigned int cycle_num)
+	faux_nsec_t period, unsigned int cycle_num)
 {
 	faux_ev_t *ev = NULL;
 
+	assert(sched);
+	if (!sched)
+		return NULL;
+
 	ev = faux_ev_new(time, ev_id, data);
 	assert(ev);
 	if (!ev)
-		return -1;
+		return NULL;
 	if (FAUX_SCHED_PERIODIC == periodic)
 		faux_ev_periodic(ev, period, cycle_num);
 
 	if (_sched_ev(sched, ev) < 0) { // Something went wrong
 		faux_ev_free(ev);
-		return -1;
+		return NULL;
 	}
 
-	return 0;
+	return ev;
 }
 
 
 /** @brief Adds non-periodic event to scheduling list using absolute time.
  *
  * @param [in] sched Allocated and initialized sched object.
- * @param [in] time Absolute time of future event (FAUX_SCHED_NOW for now).
+ * @param [in] time Absolute CLOCK_MONOTONIC time of future event
+ *   (FAUX_SCHED_NOW for now).
  * @param [in] ev_id Event ID.
  * @param [in] data Pointer to arbitrary data linked to event.
- * @return 0 - success, < 0 on error.
+ * @return Event handle or NULL on error.
  */
-int faux_sched_once(
+faux_ev_t *faux_sched_once(
 	faux_sched_t *sched, const struct timespec *time, int ev_id, void *data)
 {
-	return _sched(sched, time, ev_id, data,
-		FAUX_SCHED_ONCE, NULL, 0);
+	faux_nsec_t plan = 0;
+
+	if (time)
+		plan = faux_timespec_to_nsec(time);
+	else // Time isn't given so use "NOW"
+		plan = faux_nsec_now_monotonic();
+
+	return _sched(sched, plan, ev_id, data,
+		FAUX_SCHED_ONCE, 0, 0);
 }
 
 
@@ -145,43 +323,49 @@ int faux_sched_once(
  * @param [in] interval Interval (NULL means "now").
  * @param [in] ev_id Event ID.
  * @param [in] data Pointer to arbitrary data linked to event.
- * @return 0 - success, < 0 on error.
+ * @return Event handle or NULL on error.
  */
-int faux_sched_once_delayed(faux_sched_t *sched,
+faux_ev_t *faux_sched_once_delayed(faux_sched_t *sched,
 	const struct timespec *interval, int ev_id, void *data)
 {
-	struct timespec now = {};
-	struct timespec plan = {};
-
-	assert(sched);
-	if (!sched)
-		return -1;
+	faux_nsec_t plan = 0;
 
-	if (!interval)
-		return faux_sched_once(sched, FAUX_SCHED_NOW, ev_id, data);
-	faux_timespec_now(&now);
-	faux_timespec_sum(&plan, &now, interval);
+	plan = faux_nsec_now_monotonic();
+	if (interval)
+		plan += faux_timespec_to_nsec(interval);
 
-	return faux_sched_once(sched, &plan, ev_id, data);
+	return _sched(sched, plan, ev_id, data,
+		FAUX_SCHED_ONCE, 0, 0);
 }
 
 
 /** @brief Adds periodic event to sched list using absolute time for first one.
  *
  * @param [in] sched Allocated and initialized sched object.
- * @param [in] time Absolute time of first event.
+ * @param [in] time Absolute CLOCK_MONOTONIC time of first event.
  * @param [in] ev_id Event ID.
  * @param [in] data Pointer to arbitrary data linked to event.
  * @param [in] period Period of periodic event.
  * @param [in] cycle_num Number of cycles.
- * @return 0 - success, < 0 on error.
+ * @return Event handle or NULL on error.
  */
-int faux_sched_periodic(
+faux_ev_t *faux_sched_periodic(
 	faux_sched_t *sched, const struct timespec *time, int ev_id, void *data,
 	const struct timespec *period, unsigned int cycle_num)
 {
-	return _sched(sched, time, ev_id, data,
-		FAUX_SCHED_PERIODIC, period, cycle_num);
+	faux_nsec_t plan = 0;
+
+	assert(period);
+	if (!period)
+		return NULL;
+
+	if (time)
+		plan = faux_timespec_to_nsec(time);
+	else // Time isn't given so use "NOW"
+		plan = faux_nsec_now_monotonic();
+
+	return _sched(sched, plan, ev_id, data,
+		FAUX_SCHED_PERIODIC, faux_timespec_to_nsec(period), cycle_num);
 }
 
 
@@ -192,52 +376,147 @@ int faux_sched_periodic(
  * @param [in] data Pointer to arbitrary data linked to event.
  * @param [in] period Period of periodic event.
  * @param [in] cycle_num Number of cycles.
- * @return 0 - success, < 0 on error.
+ * @return Event handle or NULL on error.
  */
-int faux_sched_periodic_delayed(
+faux_ev_t *faux_sched_periodic_delayed(
 	faux_sched_t *sched, int ev_id, void *data,
 	const struct timespec *period, unsigned int cycle_num)
 {
-	struct timespec now = {};
-	struct timespec plan = {};
+	faux_nsec_t nsec_period = 0;
 
-	assert(sched);
 	assert(period);
-	if (!sched || !period)
+	if (!period)
+		return NULL;
+
+	nsec_period = faux_timespec_to_nsec(period);
+	return _sched(sched, faux_nsec_now_monotonic() + nsec_period,
+		ev_id, data, FAUX_SCHED_PERIODIC, nsec_period, cycle_num);
+}
+
+
+/** @brief Internal function to find the earliest deadline within subtree.
+ *
+ * Events within subtree are not earlier than subtree root. So subtree
+ * can't contain deadline earlier than root's time and it can be skipped.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] index Heap position of subtree root.
+ * @param [in,out] deadline The earliest deadline found.
+ */
+static void _sched_deadline(const faux_sched_t *sched, size_t index,
+	faux_nsec_t *deadline)
+{
+	faux_ev_t *ev = NULL;
+	faux_nsec_t ev_deadline = 0;
+
+	if (index >= sched->len)
+		return;
+	ev = sched->heap[index];
+	if (faux_ev_time(ev) >= *deadline)
+		return;
+	ev_deadline = faux_ev_time(ev) + faux_ev_slack(ev);
+	if (ev_deadline < *deadline)
+		*deadline = ev_deadline;
+
+	_sched_deadline(sched, index * 2 + 1, deadline);
+	_sched_deadline(sched, index * 2 + 2, deadline);
+}
+
+
+/** @brief Internal function to plan the next wakeup.
+ *
+ * The wakeup time is the earliest deadline ("time" + "slack") of scheduled
+ * events. The search of deadline can visit many events so it's cached and
+ * it's recalculated only when heap is changed.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [out] wakeup Time of next wakeup (nanoseconds).
+ * @return 0 - success, < 0 when there is no scheduled events.
+ */
+static int _sched_wakeup(faux_sched_t *sched, faux_nsec_t *wakeup)
+{
+	faux_ev_t *head = NULL;
+
+	if (0 == sched->len) {
+		sched->wakeup_set = BOOL_FALSE;
+		return -1;
+	}
+	if (!sched->deadline_valid) {
+		head = sched->heap[0];
+		sched->deadline = faux_ev_time(head) + faux_ev_slack(head);
+		_sched_deadline(sched, 1, &sched->deadline);
+		_sched_deadline(sched, 2, &sched->deadline);
+		sched->deadline_valid = BOOL_TRUE;
+	}
+	*wakeup = sched->deadline;
+
+	// Start new wakeup
+	sched->wakeup = *wakeup;
+	sched->wakeup_set = BOOL_TRUE;
+	sched->batch_popped = BOOL_FALSE;
+
+	return 0;
+}
+
+
+/** @brief Returns the absolute time of next wakeup.
+ *
+ * The wakeup time is the earliest deadline ("time" + "slack") of scheduled
+ * events. All the events with time before wakeup can be handled together.
+ * Unlike faux_sched_next_interval() it doesn't get current time.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [out] time Time of next wakeup.
+ * @return 0 - success, < 0 on error or when there is no scheduled events.
+ */
+int faux_sched_next_time(faux_sched_t *sched, struct timespec *time)
+{
+	faux_nsec_t wakeup = 0;
+
+	assert(sched);
+	assert(time);
+	if (!sched || !time)
+		return -1;
+
+	if (_sched_wakeup(sched, &wakeup) < 0)
 		return -1;
+	faux_nsec_to_timespec(time, wakeup);
 
-	faux_timespec_now(&now);
-	faux_timespec_sum(&plan, &now, period);
-	return faux_sched_periodic(sched, &plan, ev_id, data,
-		period, cycle_num);
+	return 0;
 }
 
 
-/** @brief Returns the interval from current time and next scheduled event.
+/** @brief Returns the interval from current time and next wakeup.
  *
- * If event is in the past then return null interval.
+ * If wakeup is in the past then return null interval.
  * If no events was scheduled then return -1.
  *
+ * @sa faux_sched_next_time()
  * @param [in] sched Allocated and initialized sched object.
  * @param [out] interval Calculated interval.
  * @return 0 - success, < 0 on error or when there is no scheduled events.
  */
 int faux_sched_next_interval(faux_sched_t *sched, struct timespec *interval)
 {
-	faux_ev_t *ev = NULL;
-	faux_list_node_t *iter = NULL;
+	faux_nsec_t wakeup = 0;
+	faux_nsec_t now = 0;
 
 	assert(sched);
 	assert(interval);
 	if (!sched || !interval)
 		return -1;
 
-	iter = faux_list_head(sched->list);
-	if (!iter)
+	if (_sched_wakeup(sched, &wakeup) < 0)
 		return -1;
-	ev = (faux_ev_t *)faux_list_data(iter);
 
-	return faux_ev_time_left(ev, interval);
+	now = faux_nsec_now_monotonic();
+	if (now > wakeup) { // Already happend
+		faux_nsec_to_timespec(interval, 0l);
+		return 0;
+	}
+	faux_nsec_to_timespec(interval, wakeup - now);
+
+	return 0;
 }
 
 
@@ -247,11 +526,31 @@ int faux_sched_next_interval(faux_sched_t *sched, struct timespec *interval)
  */
 void faux_sched_empty(faux_sched_t *sched)
 {
+	size_t i = 0;
+
 	assert(sched);
 	if (!sched)
 		return;
 
-	faux_list_empty(sched->list);
+	for (i = 0; i < sched->len; i++)
+		_sched_ev_drop(sched->heap[i]);
+	sched->len = 0;
+	_sched_changed(sched);
+}
+
+
+/** @brief Returns number of scheduled events.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @return Number of events.
+ */
+size_t faux_sched_len(const faux_sched_t *sched)
+{
+	assert(sched);
+	if (!sched)
+		return 0;
+
+	return sched->len;
 }
 
 
@@ -267,20 +566,47 @@ void faux_sched_empty(faux_sched_t *sched)
  */
 int faux_sched_pop(faux_sched_t *sched, int *ev_id, void **data)
 {
-	faux_list_node_t *iter = NULL;
+	return faux_sched_pop_at(sched, faux_nsec_now_monotonic(), ev_id, data);
+}
+
+
+/** @brief Pop events coming before specified time from list.
+ *
+ * It's like a faux_sched_pop() but uses specified time instead of reading
+ * the clock. So caller can read time once and then pop a batch of events.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] now Current CLOCK_MONOTONIC time (nanoseconds).
+ * @param [out] ev_id ID of upcoming event.
+ * @param [out] data Data of upcoming event.
+ * @return 0 - success, < 0 on error.
+ */
+int faux_sched_pop_at(faux_sched_t *sched, faux_nsec_t now,
+	int *ev_id, void **data)
+{
 	faux_ev_t *ev = NULL;
 
 	assert(sched);
 	if (!sched)
 		return -1;
 
-	iter = faux_list_head(sched->list);
-	if (!iter)
+	if (0 == sched->len)
 		return -1;
-	ev = (faux_ev_t *)faux_list_data(iter);
-	if (!faux_timespec_before_now(faux_ev_time(ev)))
+	ev = sched->heap[0];
+	if (now < faux_ev_time(ev))
 		return -1; // No events for this time
-	faux_list_takeaway(sched->list, iter); // Remove entry from list
+	_sched_takeaway(sched, 0); // Remove entry from heap
+
+	// Event is handled by planned wakeup. Each new event time within the
+	// same wakeup would need its own wakeup without slack.
+	if (sched->wakeup_set &&
+		(faux_ev_time(ev) <= sched->wakeup)) {
+		if (sched->batch_popped &&
+			(faux_ev_time(ev) != sched->batch_time))
+			sched->wakeups_saved++;
+		sched->batch_popped = BOOL_TRUE;
+		sched->batch_time = faux_ev_time(ev);
+	}
 
 	if (ev_id)
 		*ev_id = faux_ev_id(ev);
@@ -288,7 +614,7 @@ int faux_sched_pop(faux_sched_t *sched, int *ev_id, void **data)
 		*data = faux_ev_data(ev);
 
 	if (faux_ev_reschedule_period(ev) < 0) {
-		faux_ev_free(ev);
+		_sched_ev_drop(ev);
 	} else {
 		_sched_ev(sched, ev);
 	}
@@ -296,6 +622,48 @@ int faux_sched_pop(faux_sched_t *sched, int *ev_id, void **data)
 	return 0;
 }
 
+
+/** @brief Internal function to remove all matching events.
+ *
+ * Heap is filtered and then rebuilt. So removing of any number of events
+ * costs O(n).
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] by_id Match by ID if BOOL_TRUE else match by data.
+ * @param [in] id ID to remove.
+ * @param [in] data Data to remove.
+ * @return Number of removed entries.
+ */
+static int _sched_remove(faux_sched_t *sched, bool_t by_id,
+	int id, void *data)
+{
+	size_t i = 0;
+	size_t len = 0;
+	int nodes_deleted = 0;
+
+	for (i = 0; i < sched->len; i++) {
+		faux_ev_t *ev = sched->heap[i];
+		if (by_id ? (ev->id == id) : (ev->data == data)) {
+			_sched_ev_drop(ev);
+			nodes_deleted++;
+			continue;
+		}
+		_sched_heap_set(sched, len, ev);
+		len++;
+	}
+	if (0 == nodes_deleted)
+		return 0;
+	_sched_changed(sched);
+
+	// Rebuild heap
+	sched->len = len;
+	for (i = len / 2; i > 0; i--)
+		_sched_sift_down(sched, i - 1);
+
+	return nodes_deleted;
+}
+
+
 /** @brief Removes all events with specified ID from list.
  *
  * @param [in] sched Allocated and initialized sched object.
@@ -304,21 +672,11 @@ int faux_sched_pop(faux_sched_t *sched, int *ev_id, void **data)
  */
 int faux_sched_remove_by_id(faux_sched_t *sched, int id)
 {
-	faux_list_node_t *node = NULL;
-	faux_list_node_t *saved = NULL;
-	int nodes_deleted = 0;
-
 	assert(sched);
 	if (!sched)
 		return -1;
 
-	while ((node = faux_list_match_node(sched->list,
-		faux_ev_compare_id, &id, &saved))) {
-		faux_list_del(sched->list, node);
-		nodes_deleted++;
-	}
-
-	return nodes_deleted;
+	return _sched_remove(sched, BOOL_TRUE, id, NULL);
 }
 
 
@@ -330,21 +688,11 @@ int faux_sched_remove_by_id(faux_sched_t *sched, int id)
  */
 int faux_sched_remove_by_data(faux_sched_t *sched, void *data)
 {
-	faux_list_node_t *node = NULL;
-	faux_list_node_t *saved = NULL;
-	int nodes_deleted = 0;
-
 	assert(sched);
 	if (!sched)
 		return -1;
 
-	while ((node = faux_list_match_node(sched->list,
-		faux_ev_compare_data, data, &saved))) {
-		faux_list_del(sched->list, node);
-		nodes_deleted++;
-	}
-
-	return nodes_deleted;
+	return _sched_remove(sched, BOOL_FALSE, 0, data);
 }
 
 
@@ -356,20 +704,239 @@ int faux_sched_remove_by_data(faux_sched_t *sched, void *data)
  */
 const struct timespec *faux_sched_time_by_data(faux_sched_t *sched, void *data)
 {
-	faux_list_node_t *node = NULL;
-	faux_ev_t *ev = NULL;
+	faux_ev_t *found = NULL;
+	size_t i = 0;
 
 	assert(sched);
 	if (!sched)
 		return NULL;
 
-	node = faux_list_match_node(sched->list, faux_ev_compare_data, data, NULL);
-	if (!node)
+	// Heap is not sorted so find the earliest matching event
+	for (i = 0; i < sched->len; i++) {
+		faux_ev_t *ev = sched->heap[i];
+		if (ev->data != data)
+			continue;
+		if (!found || (faux_ev_compare(ev, found) < 0))
+			found = ev;
+	}
+	if (!found)
 		return NULL;
 
-	ev = faux_list_data(node);
+	return faux_ev_time_ts(found);
+}
+
+
+/** @brief Sets slack for all events with specified ID.
+ *
+ * The slack is allowed delay of event. The events with overlapping windows
+ * ("time" ... "time" + "slack") are handled by single wakeup. The order
+ * of events is not changed.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] id ID of events.
+ * @param [in] slack Slack value (NULL for no slack).
+ * @return Number of changed events or < 0 on error.
+ */
+int faux_sched_set_slack(faux_sched_t *sched, int id,
+	const struct timespec *slack)
+{
+	size_t i = 0;
+	int nodes_changed = 0;
+	faux_nsec_t nsec_slack = 0;
+
+	assert(sched);
+	if (!sched)
+		return -1;
+
+	if (slack)
+		nsec_slack = faux_timespec_to_nsec(slack);
+
+	for (i = 0; i < sched->len; i++) {
+		faux_ev_t *ev = sched->heap[i];
+		if (ev->id != id)
+			continue;
+		faux_ev_set_slack(ev, nsec_slack);
+		nodes_changed++;
+	}
+	if (nodes_changed > 0)
+		_sched_changed(sched);
+
+	return nodes_changed;
+}
+
+
+/** @brief Returns number of wakeups saved by events slack.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @return Number of saved wakeups.
+ */
+uint64_t faux_sched_wakeups_saved(const faux_sched_t *sched)
+{
+	assert(sched);
+	if (!sched)
+		return 0;
+
+	return sched->wakeups_saved;
+}
+
+
+/** @brief Removes event by handle.
+ *
+ * It costs O(log n). The handle becomes invalid if it's not held.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] ev Event handle.
+ * @return 0 - success, < 0 on error.
+ */
+int faux_sched_del(faux_sched_t *sched, faux_ev_t *ev)
+{
+	assert(sched);
+	assert(ev);
+	if (!sched || !ev)
+		return -1;
+	if (!_sched_has_ev(sched, ev))
+		return -1;
+
+	_sched_takeaway(sched, ev->index);
+	_sched_ev_drop(ev);
+
+	return 0;
+}
+
+
+/** @brief Internal function to reschedule event within heap.
+ */
+static int _sched_reschedule(faux_sched_t *sched, faux_ev_t *ev,
+	faux_nsec_t time)
+{
+	assert(sched);
+	assert(ev);
+	if (!sched || !ev)
+		return -1;
+	if (!_sched_has_ev(sched, ev))
+		return -1;
+
+	_sched_changed(sched);
+	faux_ev_reschedule(ev, time);
+	ev->seq = sched->seq++;
+	_sched_fix(sched, ev->index);
+
+	return 0;
+}
+
+
+/** @brief Reschedules event to specified absolute time by handle.
+ *
+ * It costs O(log n). Periodic event keeps its period and number of cycles.
+ * So it can be used to reset per-connection timer cheaply.
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] ev Event handle.
+ * @param [in] time Absolute CLOCK_MONOTONIC time of event
+ *   (FAUX_SCHED_NOW for now).
+ * @return 0 - success, < 0 on error.
+ */
+int faux_sched_reschedule(faux_sched_t *sched, faux_ev_t *ev,
+	const struct timespec *time)
+{
+	faux_nsec_t plan = 0;
+
+	if (time)
+		plan = faux_timespec_to_nsec(time);
+	else // Time isn't given so use "NOW"
+		plan = faux_nsec_now_monotonic();
+
+	return _sched_reschedule(sched, ev, plan);
+}
+
+
+/** @brief Reschedules event using interval from now by handle.
+ *
+ * @sa faux_sched_reschedule()
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] ev Event handle.
+ * @param [in] interval Interval (NULL means "now").
+ * @return 0 - success, < 0 on error.
+ */
+int faux_sched_reschedule_delayed(faux_sched_t *sched, faux_ev_t *ev,
+	const struct timespec *interval)
+{
+	faux_nsec_t plan = 0;
+
+	plan = faux_nsec_now_monotonic();
+	if (interval)
+		plan += faux_timespec_to_nsec(interval);
+
+	return _sched_reschedule(sched, ev, plan);
+}
+
+
+/** @brief Calculates time left from now to the event by handle.
+ *
+ * It costs O(1).
+ *
+ * @param [in] sched Allocated and initialized sched object.
+ * @param [in] ev Event handle.
+ * @param [out] left Calculated time left. Null interval if event is
+ *   already coming.
+ * @return 0 - success, < 0 on error.
+ */
+int faux_sched_time_left(const faux_sched_t *sched, const faux_ev_t *ev,
+	struct timespec *left)
+{
+	assert(sched);
+	assert(ev);
+	assert(left);
+	if (!sched || !ev || !left)
+		return -1;
+	if (!_sched_has_ev(sched, ev))
+		return -1;
+
+	faux_nsec_to_timespec(left,
+		faux_ev_time_left(ev, faux_nsec_now_monotonic()));
+
+	return 0;
+}
+
+
+/** @brief Holds event handle.
+ *
+ * Held event is not freed when it's removed or popped for the last time. So
+ * handle stays valid and handle functions return error for it. Each hold
+ * must be paired with faux_sched_release().
+ *
+ * @param [in] ev Event handle.
+ * @return Event handle or NULL on error.
+ */
+faux_ev_t *faux_sched_hold(faux_ev_t *ev)
+{
+	assert(ev);
 	if (!ev)
 		return NULL;
 
-	return faux_ev_time(ev);
+	ev->refcnt++;
+
+	return ev;
+}
+
+
+/** @brief Releases event handle held by faux_sched_hold().
+ *
+ * Event is freed if it's not scheduled anymore and it's the last hold. The
+ * handle must not be used after release. It can be called after
+ * faux_sched_free().
+ *
+ * @param [in] ev Event handle.
+ */
+void faux_sched_release(faux_ev_t *ev)
+{
+	if (!ev)
+		return;
+	assert(ev->refcnt > 0);
+	if (0 == ev->refcnt)
+		return;
+
+	ev->refcnt--;
+	if ((0 == ev->refcnt) && (SIZE_MAX == ev->index))
+		faux_ev_free(ev);
 }
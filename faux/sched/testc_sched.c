@@ -21,7 +21,7 @@ int testc_faux_sched_once(void)
 	struct timespec twait = {};
 
 	faux_nsec_to_timespec(&pol_s, nsec);
-	faux_timespec_now(&now);
+	faux_timespec_now_monotonic(&now);
 	faux_timespec_sum(&t, &now, &pol_s);
 
 	sched = faux_sched_new();
@@ -82,7 +82,7 @@ int testc_faux_sched_periodic(void)
 	void *e_str = NULL;
 
 	faux_nsec_to_timespec(&pol_s, nsec);
-	faux_timespec_now(&now);
+	faux_timespec_now_monotonic(&now);
 	faux_timespec_sum(&t, &now, &pol_s);
 
 	sched = faux_sched_new();
@@ -140,7 +140,7 @@ int testc_faux_sched_infinite(void)
 	void *e_str = NULL;
 
 	faux_nsec_to_timespec(&pol_s, nsec);
-	faux_timespec_now(&now);
+	faux_timespec_now_monotonic(&now);
 	faux_timespec_sum(&t, &now, &pol_s);
 
 	sched = faux_sched_new();
@@ -185,3 +185,211 @@ int testc_faux_sched_infinite(void)
 
 	return 0;
 }
+
+
+int testc_faux_sched_heap(void)
+{
+	faux_sched_t *sched = NULL;
+	const int num = 1000;
+	int i = 0;
+	int popped = 0;
+	int e_id = 0;
+	void *e_data = NULL;
+	struct timespec prev = {};
+	struct timespec twait = {};
+
+	sched = faux_sched_new();
+	if (!sched)
+		return -1;
+
+	// Schedule events with shuffled times in the past. The ID is odd or
+	// even to remove half of events later.
+	for (i = 0; i < num; i++) {
+		struct timespec t = {};
+		t.tv_nsec = 1 + (i * 7919) % num;
+		if (!faux_sched_once(sched, &t, i % 2, (void *)t.tv_nsec)) {
+			printf("faux_sched_once: Can't schedule event %d\n", i);
+			return -1;
+		}
+	}
+	if (faux_sched_remove_by_id(sched, 1) != num / 2) {
+		printf("faux_sched_remove_by_id: Wrong number of removed\n");
+		return -1;
+	}
+	if (faux_sched_remove_by_data(sched, (void *)1l) != 1) {
+		printf("faux_sched_remove_by_data: Wrong number of removed\n");
+		return -1;
+	}
+	if (faux_sched_next_interval(sched, &twait) < 0)
+		return -1;
+
+	// Events must be popped in time order
+	while (faux_sched_pop(sched, &e_id, &e_data) == 0) {
+		struct timespec t = {};
+		t.tv_nsec = (long)e_data;
+		if (e_id != 0) {
+			printf("faux_sched_pop: Removed event was popped\n");
+			return -1;
+		}
+		if (faux_timespec_cmp(&prev, &t) > 0) {
+			printf("faux_sched_pop: Wrong order of events\n");
+			return -1;
+		}
+		prev = t;
+		popped++;
+	}
+	if (popped != num / 2 - 1) {
+		printf("faux_sched_pop: Wrong number of popped events %d\n",
+			popped);
+		return -1;
+	}
+
+	faux_sched_free(sched);
+
+	return 0;
+}
+
+
+int testc_faux_sched_slack(void)
+{
+	faux_sched_t *sched = NULL;
+	struct timespec now = {};
+	struct timespec base = {};
+	struct timespec t = {};
+	struct timespec wakeup = {};
+	struct timespec expected = {};
+	struct timespec slack = {0, 5000000}; // 5 ms
+	int e_id = 0;
+	int popped = 0;
+	int i = 0;
+
+	// Use past times so all events can be popped
+	faux_timespec_now_monotonic(&now);
+	faux_timespec_diff(&base, &now, &(struct timespec){0, 100000000});
+
+	sched = faux_sched_new();
+	if (!sched)
+		return -1;
+
+	// Events 1 have overlapping windows. Event 2 has no slack.
+	for (i = 0; i < 3; i++) {
+		faux_timespec_sum(&t, &base, &(struct timespec){0, i * 2000000});
+		faux_sched_once(sched, &t, 1, NULL);
+	}
+	faux_timespec_sum(&t, &base, &(struct timespec){0, 20000000});
+	faux_sched_once(sched, &t, 2, NULL);
+	if (faux_sched_set_slack(sched, 1, &slack) != 3) {
+		printf("faux_sched_set_slack: Wrong number of changed events\n");
+		return -1;
+	}
+
+	// Wakeup is the earliest deadline
+	if (faux_sched_next_time(sched, &wakeup) < 0)
+		return -1;
+	faux_timespec_sum(&expected, &base, &slack);
+	if (faux_timespec_cmp(&wakeup, &expected) != 0) {
+		printf("faux_sched_next_time: Wrong wakeup time\n");
+		return -1;
+	}
+
+	while (faux_sched_pop(sched, &e_id, NULL) == 0)
+		popped++;
+	if (popped != 4) {
+		printf("faux_sched_pop: Wrong number of popped events %d\n",
+			popped);
+		return -1;
+	}
+	// Two events are coalesced with the first one. The event without
+	// slack is out of wakeup.
+	if (faux_sched_wakeups_saved(sched) != 2) {
+		printf("faux_sched_wakeups_saved: Wrong number %llu\n",
+			(unsigned long long)faux_sched_wakeups_saved(sched));
+		return -1;
+	}
+
+	faux_sched_free(sched);
+
+	return 0;
+}
+
+
+int testc_faux_sched_handle(void)
+{
+	faux_sched_t *sched = NULL;
+	faux_ev_t *ev1 = NULL;
+	faux_ev_t *ev2 = NULL;
+	faux_ev_t *ev3 = NULL;
+	struct timespec hour = {3600, 0};
+	struct timespec left = {};
+	int e_id = 0;
+
+	sched = faux_sched_new();
+	if (!sched)
+		return -1;
+
+	ev1 = faux_sched_once_delayed(sched, &hour, 1, NULL);
+	ev2 = faux_sched_once_delayed(sched, &hour, 2, NULL);
+	ev3 = faux_sched_periodic_delayed(sched, 3, NULL, &hour, 2);
+	if (!ev1 || !ev2 || !ev3) {
+		printf("faux_sched_once_delayed: Can't get event handle\n");
+		return -1;
+	}
+
+	// Time left
+	if (faux_sched_time_left(sched, ev1, &left) < 0)
+		return -1;
+	if ((faux_timespec_cmp(&left, &hour) > 0) || (left.tv_sec < 3500)) {
+		printf("faux_sched_time_left: Wrong time left\n");
+		return -1;
+	}
+
+	// Reschedule to now
+	if (faux_sched_reschedule_delayed(sched, ev2, NULL) < 0)
+		return -1;
+	if (faux_sched_pop(sched, &e_id, NULL) < 0)
+		return -1;
+	if (e_id != 2) {
+		printf("faux_sched_reschedule_delayed: Wrong event %d\n", e_id);
+		return -1;
+	}
+	if (faux_sched_pop(sched, &e_id, NULL) == 0) {
+		printf("faux_sched_pop: Unexpected event %d\n", e_id);
+		return -1;
+	}
+
+	// Delete by handle
+	if (faux_sched_del(sched, ev1) < 0)
+		return -1;
+	if (faux_sched_len(sched) != 1) {
+		printf("faux_sched_del: Wrong number of events\n");
+		return -1;
+	}
+
+	// Periodic event is rescheduled after pop so handle is still valid
+	if (faux_sched_reschedule(sched, ev3, FAUX_SCHED_NOW) < 0)
+		return -1;
+	if ((faux_sched_pop(sched, &e_id, NULL) < 0) || (e_id != 3))
+		return -1;
+	if (faux_sched_time_left(sched, ev3, &left) < 0) {
+		printf("faux_sched_time_left: Periodic event lost\n");
+		return -1;
+	}
+
+	// Held event survives the last pop but it's not scheduled anymore
+	faux_sched_hold(ev3);
+	if (faux_sched_reschedule(sched, ev3, FAUX_SCHED_NOW) < 0)
+		return -1;
+	if ((faux_sched_pop(sched, &e_id, NULL) < 0) || (e_id != 3))
+		return -1;
+	if ((faux_sched_time_left(sched, ev3, &left) == 0) ||
+		(faux_sched_del(sched, ev3) == 0) ||
+		(faux_sched_reschedule(sched, ev3, FAUX_SCHED_NOW) == 0)) {
+		printf("faux_sched_hold: Popped event is still scheduled\n");
+		return -1;
+	}
+	faux_sched_release(ev3);
+
+	faux_sched_free(sched);
+
+	return 0;
+}
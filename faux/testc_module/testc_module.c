@@ -12,12 +12,16 @@ const char *testc_module[][2] = {
 
 	// base
 	{"testc_faux_filesize", "Get size of filesystem object"},
+	{"testc_faux_write_whole_file", "Write whole file atomically"},
 
 	// str
 	{"testc_faux_str_nextword", "Find next word (quotation)"},
 
 	// ini
 	{"testc_faux_ini_parse_file", "Complex test of INI file parsing"},
+	{"testc_faux_ini_sections", "INI file sections"},
+	{"testc_faux_ini_cache", "Binary snapshot of INI object"},
+	{"testc_faux_ini_watch", "Incremental reload of INI file"},
 
 	// argv
 	{"testc_faux_argv_parse", "Parse string to arguments"},
@@ -28,11 +32,36 @@ const char *testc_module[][2] = {
 	{"testc_faux_timespec_diff", "Diff beetween timespec structures"},
 	{"testc_faux_timespec_sum", "Sum of timespec structures"},
 	{"testc_faux_timespec_now", "Timespec now and before now functions"},
+	{"testc_faux_nsec_now_monotonic", "Nanoseconds monotonic now function"},
 
 	// sched
 	{"testc_faux_sched_once", "Schedule once event. Simple and delayed ones."},
 	{"testc_faux_sched_periodic", "Schedule periodic event."},
 	{"testc_faux_sched_infinite", "Schedule infinite number of events."},
+	{"testc_faux_sched_heap", "Order and removing of many events."},
+	{"testc_faux_sched_slack", "Coalescing of events with slack."},
+	{"testc_faux_sched_handle", "Operations by event handle."},
+
+	// net
+	{"testc_faux_net_iov", "Partial scatter/gather transfers"},
+	{"testc_faux_net_recv_buf", "Buffered receiving"},
+	{"testc_faux_net_sendfile", "Sending of file range"},
+	{"testc_faux_net_zerocopy", "Zerocopy sending"},
+	{"testc_faux_net_send_recv", "Sending and receiving with timeout"},
+	{"testc_faux_net_mmsg", "Batches of datagrams"},
+	{"testc_faux_pollfd", "Pollfd add, remove and search"},
+
+	// eloop
+	{"testc_faux_eloop_backends", "Event loop with all backends"},
+	{"testc_faux_eloop_post", "Tasks posted from another thread"},
+	{"testc_faux_eloop_hooks", "Deletion of hooks within dispatching"},
+	{"testc_faux_eloop_budget", "Dispatch budget and rotation"},
+	{"testc_faux_eloop_group", "Group of loops within threads"},
+	{"testc_faux_eloop_stats", "Loop statistics and export"},
+
+	// async
+	{"testc_faux_async_watermarks", "Output queue watermarks and drain"},
+	{"testc_faux_async_pause", "Pause and resume of reading"},
 
 	// log
 	{"testc_faux_log_facility_id", "Converts syslog facility string to id"},
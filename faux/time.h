@@ -11,6 +11,12 @@
 
 #include <faux/faux.h>
 
+// Time in nanoseconds. It's used internally instead of struct timespec to
+// avoid normalization on each operation. Plain integer arithmetic is used.
+typedef int64_t faux_nsec_t;
+
+#define FAUX_NSEC_PER_SEC 1000000000ll
+
 C_DECL_BEGIN
 
 // Operations for struct timespec
@@ -27,6 +33,9 @@ bool_t faux_timespec_before_now(const struct timespec *ts);
 uint64_t faux_timespec_to_nsec(const struct timespec *ts);
 void faux_nsec_to_timespec(struct timespec *ts, uint64_t nsec);
 
+// Nanoseconds time
+faux_nsec_t faux_nsec_now_monotonic(void);
+
 C_DECL_END
 
 #endif /* _faux_time_h */
@@ -170,3 +170,22 @@ int testc_faux_timespec_now(void)
 
 	return ret;
 }
+
+
+int testc_faux_nsec_now_monotonic(void)
+{
+	struct timespec before = {};
+	struct timespec after = {};
+	faux_nsec_t now = 0;
+
+	faux_timespec_now_monotonic(&before);
+	now = faux_nsec_now_monotonic();
+	faux_timespec_now_monotonic(&after);
+
+	if (now < (faux_nsec_t)faux_timespec_to_nsec(&before))
+		return -1;
+	if (now > (faux_nsec_t)faux_timespec_to_nsec(&after))
+		return -1;
+
+	return 0;
+}
@@ -197,3 +197,17 @@ bool_t faux_timespec_before_now(const struct timespec *ts)
 
 	return BOOL_FALSE;
 }
+
+
+/** @brief Returns current CLOCK_MONOTONIC time in nanoseconds.
+ *
+ * @return Current time in nanoseconds.
+ */
+faux_nsec_t faux_nsec_now_monotonic(void)
+{
+	struct timespec now = {};
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((faux_nsec_t)now.tv_sec * FAUX_NSEC_PER_SEC) + now.tv_nsec;
+}
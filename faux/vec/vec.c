@@ -187,6 +187,12 @@ ssize_t faux_vec_del(faux_vec_t *faux_vec, unsigned int index)
 	// Re-allocate space to hold new vector
 	faux_vec->len--;
 	new_data_len = faux_vec_len(faux_vec) * faux_vec_item_size(faux_vec);
+	// The realloc() with zero size frees memory and can return NULL
+	if (0 == new_data_len) {
+		faux_free(faux_vec->data);
+		faux_vec->data = NULL;
+		return 0;
+	}
 	new_vector = realloc(faux_vec->data, new_data_len);
 	assert(new_vector);
 	if (!new_vector)